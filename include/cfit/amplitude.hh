@@ -103,6 +103,7 @@ public:
   void useTwoBW   ( const bool twoBW    = true );
 
   const std::map< std::string, Parameter >& getPars() const { return _parMap; };
+  const std::vector< Resonance* >&          resonances() const { return _resos; }
   void setPars( const std::map< std::string, Parameter >& pars );
 
   std::complex< double > evaluate( const PhaseSpace& ps,
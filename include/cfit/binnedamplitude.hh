@@ -30,8 +30,16 @@ private:
   std::vector< ParameterExpr > _nmb;
   std::vector< CoefExpr      > _xb;
 
+  // Values of T_{+b}, T_{-b} and sqrt( T_{+b} T_{-b} ) X_b of every positive bin b,
+  //    evaluated whenever the parameters are set.
+  std::vector< double                 > _tpb;
+  std::vector< double                 > _tmb;
+  std::vector< std::complex< double > > _txb;
+
+  void fill();
+
 public:
-  BinnedAmplitude() = default;
+  BinnedAmplitude() : _nbins( 0 ) {}
 
   BinnedAmplitude( const std::vector< Parameter >& npb,
                    const std::vector< Parameter >& nmb,
@@ -54,29 +62,38 @@ public:
   const std::vector< ParameterExpr >& nmb() const { return _nmb; }
   const std::vector< CoefExpr      >& xb()  const { return _xb;  }
 
+  // Dense arrays of T_{+b}, T_{-b} and sqrt( T_{+b} T_{-b} ) X_b, for b = 1, ..., nBins().
+  const std::vector< double                 >& tpb() const { return _tpb; }
+  const std::vector< double                 >& tmb() const { return _tmb; }
+  const std::vector< std::complex< double > >& txb() const { return _txb; }
+
   const double                 getN( const int& bin ) const
   {
-    if ( std::abs( bin ) > (int) _nbins )
+    if ( ( bin == 0 ) || ( std::abs( bin ) > (int) _nbins ) )
       throw PdfException( "BinnedAmplitude: requesting invalid bin" );
 
-    return ( ( bin > 0 ) ? _npb[ bin - 1 ] : _nmb[ std::abs( bin ) - 1 ] ).evaluate();
+    return ( bin > 0 ) ? _tpb[ bin - 1 ] : _tmb[ - bin - 1 ];
   }
 
   const std::complex< double > getX( const int& bin ) const
   {
-    if ( std::abs( bin ) > (int) _nbins )
+    if ( ( bin == 0 ) || ( std::abs( bin ) > (int) _nbins ) )
       throw PdfException( "BinnedAmplitude: requesting invalid bin" );
 
-    return ( bin > 0 ) ? _xb[ bin - 1 ].evaluate() : std::conj( _xb[ std::abs( bin ) - 1 ].evaluate() );
+    return ( bin > 0 ) ? _xb[ bin - 1 ].evaluate() : std::conj( _xb[ - bin - 1 ].evaluate() );
   }
 
 
+  // Values of T_{bin}, T_{-bin} and sqrt( T_{bin} T_{-bin} ) X_{bin}.
   const std::tuple< double, double, std::complex< double > > evaluate( const int& bin ) const
   {
-    const double&&                 tpb = getN(   bin );
-    const double&&                 tmb = getN( - bin );
-    const std::complex< double >&& txb = std::sqrt( tpb * tmb ) * getX( bin );
-    return std::tuple< double, double, std::complex< double > >( tpb, tmb, txb );
+    if ( ( bin == 0 ) || ( std::abs( bin ) > (int) _nbins ) )
+      throw PdfException( "BinnedAmplitude: requesting invalid bin" );
+
+    if ( bin > 0 )
+      return std::tuple< double, double, std::complex< double > >( _tpb[ bin - 1 ], _tmb[ bin - 1 ], _txb[ bin - 1 ] );
+
+    return std::tuple< double, double, std::complex< double > >( _tmb[ - bin - 1 ], _tpb[ - bin - 1 ], std::conj( _txb[ - bin - 1 ] ) );
   }
 
 
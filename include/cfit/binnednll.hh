@@ -0,0 +1,49 @@
+#ifndef __BINNEDNLL_HH__
+#define __BINNEDNLL_HH__
+
+#include <vector>
+
+#include <cfit/minimizer.hh>
+#include <cfit/pdfbase.hh>
+#include <cfit/histogram.hh>
+#include <cfit/exceptions.hh>
+
+// Binned maximum likelihood with Poisson-distributed bin contents. The expected content
+//    of each bin is the integral of the pdf within it. If the fit is extended, the pdf
+//    must be normalized to the expected number of events. Otherwise, the integrals are
+//    scaled to the total content of the histogram.
+class BinnedNll : public Minimizer
+{
+private:
+  const Histogram _hist;
+  bool            _extended;
+
+  // Integrate with the area of the pdf if it is available. Otherwise use Gauss-Legendre
+  //    quadrature with points and weights (including the volume of the bin) computed
+  //    only once for all the bins.
+  bool                  _useArea;
+  std::size_t           _nNodes;
+  std::vector< double > _points;
+  std::vector< double > _weights;
+
+  void init() throw( PdfException );
+
+  const double integral( const std::size_t& bin ) const throw( PdfException );
+
+public:
+  BinnedNll( const PdfModel& pdf, const Histogram& hist, const bool& extended = false ) throw( PdfException );
+  BinnedNll( const PdfExpr&  pdf, const Histogram& hist, const bool& extended = false ) throw( PdfException );
+
+  BinnedNll( const BinnedNll& nll );
+
+  BinnedNll* copy() const { return new BinnedNll( *this ); }
+
+  const Histogram& histogram() const { return _hist; }
+
+  double operator()( const std::vector<double>& par ) const throw( PdfException );
+
+  // Every process holds the whole histogram, so only one of them contributes.
+  double local     ( const std::vector<double>& par ) const throw( PdfException );
+};
+
+#endif
@@ -4,6 +4,10 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cmath>
+
+#include <cfit/exceptions.hh>
 
 class Binning
 {
@@ -92,18 +96,50 @@ private:
   Data _xybinx;
   Data _xybiny;
 
+  // Raster of the bounding box of the reference points, in _cells x _cells cells. Every
+  //    cell holds the index in _xybiny of the reference point closest to all its points
+  //    or, if it straddles a boundary between reference points, -1 minus the index of
+  //    the point closest to one of its corners, to start the exact search from.
+  unsigned                    _cells;
+  float                       _xmin;
+  float                       _ymin;
+  float                       _xscale;
+  float                       _yscale;
+  std::vector< std::int32_t > _raster;
+
   static float distance( const std::pair< float, float >& a, const std::pair< float, float >& b );
   static float distance( const std::pair< float, float >& a, const float& bx, const float& by );
 
+  // Exact search of the reference point in _xybiny closest to position (x,y), optionally
+  //    given the distance to some reference point.
+  Data::const_iterator nearest( const float& x, const float& y ) const;
+  Data::const_iterator nearest( const float& x, const float& y, const float& bound ) const;
+
+  void rasterize( const unsigned& cells );
+
 public:
-  Binning() = default;
-  // Binning( const std::string& binsfile );
-  Binning( const Data& xybin );
+  Binning() : _cells( 0 ), _xmin( 0.0 ), _ymin( 0.0 ), _xscale( 0.0 ), _yscale( 0.0 ) {}
+  // Read a binning scheme, together with its raster, from a file written by write().
+  Binning( const std::string& filename ) throw( PdfException );
+  // Build the raster with a given number of cells per dimension, or none if 0.
+  Binning( const Data& xybin, const unsigned& cells = 512 );
 
   std::size_t size() const { return _xybinx.size(); }
 
   // Find the bin corresponding to position (x,y) over the phase space.
   int bin( const float& x, const float& y ) const;
+
+  // Write the binning scheme and its raster to a binary file, with native byte order:
+  //
+  //    char[ 8 ]  magic "CFITBINS"
+  //    uint32     version (1)
+  //    uint32     byte order mark (0x01020304)
+  //    uint64     number of reference points, n
+  //    n times    float x, float y, uint32 bin, sorted by y and then x
+  //    uint32     number of cells per dimension, c
+  //    float[ 4 ] lower x, lower y, and inverse sizes of the cells in x and y
+  //    c * c      int32 cells, row by row in y
+  void write( const std::string& filename ) const throw( PdfException );
 };
 
 #endif
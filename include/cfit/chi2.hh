@@ -14,6 +14,8 @@ class Chi2 : public Minimizer
 private:
   const Variable _y;
 
+  double terms( const std::size_t& first, const std::size_t& last ) const throw( PdfException );
+
 public:
   Chi2( const PdfModel& pdf, const Variable& y, const Dataset& data );
   Chi2( const PdfExpr&  pdf, const Variable& y, const Dataset& data );
@@ -23,6 +25,7 @@ public:
   Chi2* copy() const { return new Chi2( *this ); }
 
   double operator()( const std::vector<double>& par ) const throw( PdfException );
+  double local     ( const std::vector<double>& par ) const throw( PdfException );
 };
 
 #endif
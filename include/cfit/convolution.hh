@@ -0,0 +1,103 @@
+#ifndef __CONVOLUTION_HH__
+#define __CONVOLUTION_HH__
+
+#include <string>
+#include <vector>
+#include <complex>
+
+#include <cfit/exceptions.hh>
+#include <cfit/pdfmodel.hh>
+#include <cfit/pdfexpr.hh>
+
+
+// Convolution of two pdfs of the same single variable,
+//
+//    ( f ^ g )( x ) = Int f( x - u ) g( u ) du,
+//
+//    normalized between two limits. The left operand is sampled on a grid that covers
+//    the limits and a buffer on each side of them, the right one on the differences
+//    between the points of the grid, and both are convolved with a fast Fourier
+//    transform. Operands with an analytical area are averaged over the cells of the
+//    grid, which keeps the error quadratic in the step even if they are discontinuous,
+//    and the others are sampled at the points. The pdf is interpolated linearly between
+//    the points of the grid. The grid is only recomputed when the parameters of an
+//    operand change, so every call costs O( N log N ) for N points, independently of
+//    the number of events.
+//
+// The left operand is usually the physical pdf and the right one the resolution, that
+//    must be narrow compared to the buffer.
+class Convolution : public PdfModel
+{
+private:
+  PdfExpr     _left;
+  PdfExpr     _right;
+  std::string _var;
+
+  double   _lower;
+  double   _upper;
+  unsigned _size;   // Number of points of the grid between the limits.
+  double   _buffer; // Fraction of the range added on each side of the limits.
+
+  // Whether the operands are sampled with their analytical areas.
+  bool                  _leftArea;
+  bool                  _rightArea;
+
+  // Parameters the operands were last sampled with, and their samples.
+  bool                  _sampled;
+  std::vector< double > _leftPars;
+  std::vector< double > _rightPars;
+  std::vector< double > _leftSamples;
+  std::vector< double > _rightSamples;
+
+  // Roots of unity for the transform of the current size.
+  std::vector< std::complex< double > > _roots;
+
+  // Normalized pdf at the points of the grid, and its integral up to every point.
+  double                _step;
+  std::vector< double > _grid;
+  std::vector< double > _cumulative;
+
+  const std::vector< double > parValues( const PdfExpr& pdf ) const;
+
+  // Sample an operand at n points x0 + i step, with i from first.
+  static void sample( PdfExpr& pdf, const bool& useArea, const double& x0, const double& step,
+                      const int& first, const std::size_t& n, std::vector< double >& samples );
+
+  // In-place transform of a sequence with a power of two size.
+  void fft( std::vector< std::complex< double > >& data, const bool& inverse ) const;
+
+  void setParExpr();
+
+public:
+  Convolution( const PdfExpr& left , const PdfExpr& right,
+               const double&  lower, const double&  upper, const unsigned& size = 1024 ) throw( PdfException );
+
+  Convolution* copy() const;
+
+  // Getters.
+  const PdfExpr&     left () const { return _left;  }
+  const PdfExpr&     right() const { return _right; }
+  const double&      lower() const { return _lower; }
+  const double&      upper() const { return _upper; }
+  const unsigned&    size () const { return _size;  }
+
+  // Grid of the convolution. The buffer is the fraction of the range between the limits
+  //    that is added on each side of them, 0.1 by default.
+  void setLimits  ( const double& lower, const double& upper ) throw( PdfException );
+  void setGridSize( const unsigned& size                      ) throw( PdfException );
+  void setBuffer  ( const double& buffer                      ) throw( PdfException );
+
+  void cache();
+
+  const double evaluate( const double& x                   ) const throw( PdfException );
+  const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
+
+  const double area( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
+
+  // Generate the sum of a value of each operand within the limits.
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef __DALITZSAMPLER_HH__
+#define __DALITZSAMPLER_HH__
+
+#include <vector>
+#include <functional>
+#include <mutex>
+
+#include <cfit/phasespace.hh>
+#include <cfit/random.hh>
+
+class Amplitude;
+
+// Proposal distribution for accept-reject generation over a Dalitz plot, and envelope
+//    of the ratio of a target to it. The proposal mixes a flat distribution over the
+//    bounding rectangle of ( mSq12, mSq13 ) with a relativistic Breit-Wigner in the
+//    squared invariant mass of the resonant pair of every resonance of an amplitude,
+//    flat in the other invariant mass within its kinematic limits.
+//
+// Unless a bound of the target is given by hand, the fractions of the components are
+//    estimated from a first scan of the target and the envelope from a second one,
+//    times a safety factor. They are computed the first time they are needed after
+//    the amplitude is updated, with a fixed random stream, so they do not depend on
+//    the streams used for generation.
+class DalitzSampler
+{
+public:
+  // Target of the accept-reject, at a point of the Dalitz plot. It may draw other
+  //    variables from the stream.
+  typedef std::function< double ( RandomStream&, const double&, const double& ) > target_type;
+
+private:
+  struct Channel
+  {
+    unsigned pair;    // Resonant pair: 0 for 12, 1 for 13 and 2 for 23.
+    double   mSq;     // Squared mass of the resonance.
+    double   mGamma;  // Mass times width.
+    double   atanMin; // Arc tangent of the limits of the pair, in units of mGamma.
+    double   atanMax; //
+  };
+
+  PhaseSpace             _ps;
+  std::vector< Channel > _channels;
+
+  // Bound of the target given by hand, or 0 to estimate the envelope.
+  double                 _maxPdf;
+
+  mutable std::mutex              _mutex;
+  mutable bool                    _ready;
+  mutable std::vector< double >   _fractions; // Flat component first.
+  mutable double                  _envelope;
+
+  // Limits of the squared mass of the pair of the first particle of a pair with the
+  //    third particle, for a given squared mass of the pair.
+  void limits( const unsigned& pair, const double& mSqPair, double& min, double& max ) const;
+
+  const double rectangle() const;
+
+  // Density of a component of the proposal, with the flat one first.
+  const double component( const std::size_t& index, const double& mSq12, const double& mSq13 ) const;
+
+  // Estimate the fractions and the envelope.
+  void scan( const target_type& target ) const;
+
+public:
+  DalitzSampler( const PhaseSpace& ps );
+  DalitzSampler( const DalitzSampler& sampler );
+  DalitzSampler& operator=( const DalitzSampler& sampler );
+
+  // Take the resonances of an amplitude, and drop the current envelope.
+  void update( const Amplitude& amp );
+
+  // Use the flat proposal with a bound of the target, or estimate the envelope if the
+  //    bound is not positive.
+  void setMaxPdf( const double& max );
+
+  // Upper bound of target / density, computed if needed. It must be called before
+  //    drawing any point.
+  const double envelope( const target_type& target ) const;
+
+  // Draw a point from the proposal, and return its density.
+  const double propose( RandomStream& stream, double& mSq12, double& mSq13 ) const;
+  const double density( const double& mSq12, const double& mSq13 ) const;
+
+  // Raise the envelope after the ratio of the target to the density exceeded it, for
+  //    all the blocks generated from now on, and return it.
+  const double raise( const double& ratio ) const;
+};
+
+#endif
@@ -5,25 +5,107 @@
 #include <map>
 #include <vector>
 #include <utility>
+#include <memory>
 
 #include <cfit/exceptions.hh>
+#include <cfit/variable.hh>
 #include <cfit/region.hh>
 
+class MappedFile;
+
+// Datasets can be written to and read from a binary columnar file, with native byte order:
+//
+//    char[ 8 ]  magic "CFITDATA"
+//    uint32     version (1)
+//    uint32     byte order mark (0x01020304)
+//    uint64     number of entries, n
+//    uint32     number of fields
+//    uint32     flags (bit 0: the file contains a weight column)
+//    For every field:
+//      uint32   length of the name, followed by the characters of the name
+//      uint32   1 if the field has an error column, 0 otherwise
+//    Padding up to the next multiple of 64 bytes.
+//    For every field, n doubles with its values, followed by n doubles with
+//       its errors if it has an error column.
+//    n doubles with the weights, if the file contains them.
+//
+// When opened, the file is mapped in memory and the columns are read in place.
+//    The data is only copied if the dataset is modified.
+//
+// Slices and ranges of a dataset are views: they share the columns of the dataset
+//    they are taken from, and only store the rows of the entries they contain.
 class Dataset
 {
 private:
   typedef std::map< std::string, std::vector< std::pair< double, double > > > data_type;
   typedef std::map< std::string, std::pair< double, double > >                datum_type;
-  data_type _data;
+
+  // Columns and weights owned by the dataset. They are shared by its copies and views,
+  //    and only copied when a dataset that shares them is modified.
+  std::shared_ptr< data_type >             _data;
+
+  // Weights of the entries. If empty, all the entries have unit weight.
+  std::shared_ptr< std::vector< double > > _weights;
+
+  void pushWeight( const double& weight );
+
+  // Columns of values and errors of a mapped file, and its weights. Errors and
+  //    weights are null if the file does not contain them.
+  std::shared_ptr< const MappedFile >                                 _file;
+  std::map< std::string, std::pair< const double*, const double* > > _columns;
+  const double*                                                       _mappedWeights;
+  std::size_t                                                         _mappedSize;
+
+  // Rows of the owned or mapped columns seen by a view, or null if the dataset
+  //    sees all of them.
+  std::shared_ptr< const std::vector< std::size_t > > _index;
+
+  std::size_t row( const std::size_t& entry ) const { return _index ? ( *_index )[ entry ] : entry; }
+
+  // Copy the entries seen by the dataset to columns of its own, such that it can
+  //    be modified, or drop all of them.
+  void detach();
+  void reset ();
+
+  // Read a text file, either assigning its columns to fields by position or
+  //    renaming the columns of its header.
+  void readText( const std::string&                         filename,
+                 const std::vector< std::string >&          fields  ,
+                 const std::map< std::string, std::string >& renames ,
+                 const unsigned&                            nThreads  ) throw( DataException );
 
 public:
-  Dataset()  {};
+  Dataset() : _data( new data_type ), _weights( new std::vector< double > ), _mappedWeights( 0 ), _mappedSize( 0 ) {};
   ~Dataset() {};
 
+  // Write the dataset to a binary file, or map the content of a binary file.
+  void write( const std::string& filename ) const throw( DataException );
+  void open ( const std::string& filename )       throw( DataException );
+
+  // Read a text file with columns separated by whitespace or commas, replacing the
+  //    content of the dataset. Lines starting with '#' are ignored. The file is parsed
+  //    in parallel by nThreads threads (as many as cores if 0).
+  //    Files without header: the columns are assigned to the given variables in order.
+  //    Files with a header: the named columns are assigned to the given variables. If
+  //       no variables are given, every column is read as a field with its own name.
+  void read( const std::string& filename, const std::vector< Variable >&              columns,
+             const unsigned& nThreads = 0 ) throw( DataException );
+  void read( const std::string& filename, const std::map< std::string, Variable >& columns,
+             const unsigned& nThreads = 0 ) throw( DataException );
+
   void push( const std::string& field, const double& value, const double& error = 0. );
   void push( const std::map< std::string, double >& event ); // Map of fields and values.
   void push( const std::map< std::string, std::pair< double, double > >& event );
 
+  // Add a column of values (with no errors) to a field.
+  void push( const std::string& field, const std::vector< double >& values );
+
+  // Add weighted events.
+  void push( const std::map< std::string, double >& event, const double& weight );
+  void push( const std::map< std::string, std::pair< double, double > >& event, const double& weight );
+
+  void setWeights( const std::vector< double >& weights ) throw( DataException );
+
   // Getters.
   bool                       empty ()                                      const;
   std::size_t                size  ()                                      const;
@@ -33,12 +115,33 @@ public:
   std::vector< double >      values( const std::string& field )            const throw( DataException );
   std::vector< double >      errors( const std::string& field )            const throw( DataException );
   std::vector< std::string > fields()                                      const;
+  bool                       weighted()                                    const { return _mappedWeights || ! _weights->empty(); }
+  double                     weight( const std::size_t& entry )            const
+  {
+    if ( _mappedWeights )
+      return _mappedWeights[ row( entry ) ];
+
+    return _weights->empty() ? 1.0 : ( *_weights )[ row( entry ) ];
+  }
+  std::vector< double >      weights()                                     const;
+  double                     sumWeights()                                  const;
+  double                     sumWeights2()                                 const;
 //void                       dump  ()                                      const;
-  const Dataset              slice( const Region& region )                 const;
+  // Views of the entries within a region, or of the entries [ first, last ).
+  const Dataset              slice( const Region& region )                 const throw( DataException );
+  const Dataset              range( const std::size_t& first, const std::size_t& last ) const;
+
+  // Hints for datasets mapped from files: read the entries [ first, last ) ahead
+  //    of their use, or drop them from memory once they have been used.
+  void prefetch( const std::size_t& first, const std::size_t& last ) const;
+  void release ( const std::size_t& first, const std::size_t& last ) const;
 
 #ifdef MPI_ON
-  // Scatter the data through all the processes in an MPI communicator.
+  // Scatter the data through all the processes in an MPI communicator. Every process
+  //    gets a contiguous range of entries, with the same number of entries or, if the
+  //    cost of evaluating every entry is given, with the same accumulated cost.
   void scatter();
+  void scatter( const std::vector< double >& costs ) throw( DataException );
 #endif
 };
 
@@ -0,0 +1,52 @@
+#ifndef __HISTOGRAM_HH__
+#define __HISTOGRAM_HH__
+
+#include <string>
+#include <vector>
+
+#include <cfit/exceptions.hh>
+#include <cfit/variable.hh>
+#include <cfit/dataset.hh>
+
+// Histogram of the entries of a dataset in one or two variables, with uniform
+//    bins in each of them. Entries outside the range of the histogram are dropped.
+class Histogram
+{
+private:
+  std::vector< Variable > _vars;
+  std::vector< unsigned > _nBins;
+  std::vector< double   > _lower;
+  std::vector< double   > _upper;
+
+  // Contents of the bins. The bins of the first variable run fastest.
+  std::vector< double   > _counts;
+
+  void init();
+
+public:
+  Histogram( const Variable& x, const unsigned& nbins, const double& min, const double& max ) throw( DataException );
+  Histogram( const Variable& x, const unsigned& nbinsx, const double& minx, const double& maxx,
+             const Variable& y, const unsigned& nbinsy, const double& miny, const double& maxy ) throw( DataException );
+
+  // Fill the histogram with the weighted entries of a dataset, or with a single entry.
+  void fill( const Dataset& data )                                         throw( DataException );
+  void fill( const std::vector< double >& values, const double& weight = 1.0 );
+
+  // Getters.
+  const unsigned                 dim     ()                                              const { return _vars.size();     }
+  const std::size_t              size    ()                                              const { return _counts.size();   }
+  const std::vector< Variable >& vars    ()                                              const { return _vars;            }
+  const unsigned&                nBins   ( const unsigned&    dim )                      const { return _nBins.at( dim ); }
+  const double&                  lower   ( const unsigned&    dim )                      const { return _lower.at( dim ); }
+  const double&                  upper   ( const unsigned&    dim )                      const { return _upper.at( dim ); }
+  const double                   width   ( const unsigned&    dim )                      const;
+  const double                   binLower( const std::size_t& bin, const unsigned& dim ) const;
+  const double                   binUpper( const std::size_t& bin, const unsigned& dim ) const;
+  const double&                  count   ( const std::size_t& bin )                      const { return _counts[ bin ];   }
+  const double                   total   ()                                              const;
+
+  // Index of the bin that contains the given values, or size() if they are out of range.
+  const std::size_t              bin     ( const std::vector< double >& values )         const;
+};
+
+#endif
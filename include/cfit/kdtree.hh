@@ -0,0 +1,57 @@
+#ifndef __KDTREE_HH__
+#define __KDTREE_HH__
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <cfit/exceptions.hh>
+#include <cfit/dataset.hh>
+
+// Compression of a dataset with a k-d tree over some of its fields. Cells are split
+//    at the middle of their widest side (relative to its tolerance) until their extent
+//    along every field is below the tolerance. The entries in each cell are then merged
+//    into a single entry at their centroid, weighted by the sum of their weights.
+//    Only entries with the same values of the fields that are not used to build the
+//    tree, and with the same errors of all the fields, are merged, so every cell may
+//    give several entries. The centroid is weighted by the absolute values of the
+//    weights, and entries whose weights are all null are dropped.
+//
+// Since the centroid cancels the first order terms, the change of the log-likelihood
+//    of each cell is of second order in the distances to the centroid. Given bounds
+//    K_v of | d^2 log p / dv^2 | along every field v (and neglecting cross terms),
+//    the change of -2 log L is bounded by
+//                     Sum_v K_v deviation2( v ),
+//    where deviation2( v ) is the weighted sum of squared distances to the centroids.
+//    With weights of both signs in a cell the first order terms do not cancel
+//    exactly, and deviation2 sums the absolute values of the weights.
+class KdTree
+{
+private:
+  std::vector< std::string > _fields;
+  std::vector< double      > _tolerances;
+
+  // Approximation errors of the last compression, for every field of the dataset.
+  //    They vanish for the fields that are not used to build the tree.
+  std::map< std::string, double > _maxDeviation;
+  std::map< std::string, double > _deviation2;
+  std::size_t                     _nCells;
+
+  void split( const std::vector< std::vector< double > >& columns,
+              std::vector< std::size_t >::iterator        begin  ,
+              std::vector< std::size_t >::iterator        end    ,
+              std::vector< std::vector< std::size_t > >&  cells    ) const;
+
+public:
+  KdTree( const std::map< std::string, double >& tolerances ) throw( DataException );
+
+  const Dataset compress( const Dataset& data ) throw( DataException );
+
+  // Getters. The number of cells is that of the tree, which may differ from the number
+  //    of entries of the compressed dataset.
+  const std::size_t& nCells      ()                          const { return _nCells; }
+  const double       maxDeviation( const std::string& field ) const throw( DataException );
+  const double       deviation2  ( const std::string& field ) const throw( DataException );
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __MAPPEDFILE_HH__
+#define __MAPPEDFILE_HH__
+
+#include <string>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cfit/exceptions.hh>
+
+// Read-only memory map of a whole file, unmapped when the object is destroyed. It is
+//    meant to be shared by the objects that read it, so it cannot be copied.
+class MappedFile
+{
+private:
+  void*       _address;
+  std::size_t _length;
+
+  MappedFile( const MappedFile& );
+  MappedFile& operator=( const MappedFile& );
+
+  // Apply an advice to the pages that overlap a range of the mapped file.
+  void advise( const void* begin, const std::size_t& bytes, const int& advice ) const
+  {
+    if ( ! bytes )
+      return;
+
+    const std::size_t& page  = ::sysconf( _SC_PAGESIZE );
+    const std::size_t& start = static_cast< const char* >( begin ) - data();
+    const std::size_t& first = start - start % page;
+    const std::size_t  last  = std::min( start + bytes, _length );
+
+    if ( first < last )
+      ::madvise( static_cast< char* >( _address ) + first, last - first, advice );
+  }
+
+public:
+  MappedFile( const std::string& filename ) throw( DataException )
+    : _address( MAP_FAILED ), _length( 0 )
+  {
+    const int fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 )
+      throw DataException( "MappedFile: cannot open file " + filename + "." );
+
+    struct stat info;
+    if ( ::fstat( fd, &info ) == 0 )
+    {
+      _length = info.st_size;
+      if ( _length )
+        _address = ::mmap( 0, _length, PROT_READ, MAP_PRIVATE, fd, 0 );
+    }
+    ::close( fd );
+
+    if ( _address == MAP_FAILED )
+      throw DataException( "MappedFile: cannot map file " + filename + " in memory." );
+  }
+
+  ~MappedFile()
+  {
+    ::munmap( _address, _length );
+  }
+
+  const char*        data  () const { return static_cast< const char* >( _address ); }
+  const std::size_t& length() const { return _length;                               }
+
+  // Ask the kernel to read a range of the file ahead of its use, or to drop its pages
+  //    once it has been used. Both calls return immediately.
+  void prefetch( const void* begin, const std::size_t& bytes ) const { advise( begin, bytes, MADV_WILLNEED ); }
+  void release ( const void* begin, const std::size_t& bytes ) const { advise( begin, bytes, MADV_DONTNEED ); }
+};
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef __MATH_HH__
 #define __MATH_HH__
 
+#include <complex>
+#include <cstddef>
+
 class Math
 {
 private:
@@ -8,6 +11,9 @@ private:
   static const double gammastirf( const double& x  );
   static const double invnormal ( const double& y0 );
 
+  // Batch version of the inverse normal distribution, used by the batch inverf.
+  static void invnormal( const double* y0, double* result, const std::size_t& n );
+
 public:
   static const double erf       ( const double& x );
   static const double erfc      ( const double& x );
@@ -16,6 +22,20 @@ public:
   static const double gamma_q   ( const double& a, const double& x );
   static const double invgamma_q( const double& a, const double& y0 );
   static const double inverf    ( const double& x );
+
+  // Faddeeva function w(z) = exp( -z^2 ) erfc( -i z ).
+  static const std::complex< double > faddeeva( const std::complex< double >& z );
+
+  // Batch versions, that evaluate a function at n points. The kernels of erf, erfc and
+  //    faddeeva have no branches, such that the compiler can vectorize them. They agree
+  //    with the scalar versions within a few units in the last place. The points and the
+  //    results may be the same array.
+  static void erf     ( const double* x, double* result, const std::size_t& n );
+  static void erfc    ( const double* x, double* result, const std::size_t& n );
+  static void inverf  ( const double* x, double* result, const std::size_t& n );
+  static void gamma_p ( const double& a, const double* x, double* result, const std::size_t& n );
+  static void gamma_q ( const double& a, const double* x, double* result, const std::size_t& n );
+  static void faddeeva( const std::complex< double >* z, std::complex< double >* result, const std::size_t& n );
 };
 
 
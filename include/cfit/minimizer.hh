@@ -2,6 +2,10 @@
 #define __MINIMIZER_HH__
 
 #include <vector>
+#include <complex>
+#include <string>
+#include <memory>
+#include <functional>
 
 #include <Minuit/FCNBase.h>
 #include <Minuit/FunctionMinimum.h>
@@ -9,12 +13,15 @@
 #include <cfit/variable.hh>
 #include <cfit/dataset.hh>
 #include <cfit/pdfbase.hh>
+#include <cfit/mappedfile.hh>
+#include <cfit/threadpool.hh>
 
 
 class Minimizer : public FCNBase
 {
 private:
   void cache();
+  void cacheToFile();
 
 protected:
   PdfBase*      _pdf;
@@ -26,29 +33,115 @@ protected:
 
   bool   _verbose;
 
-  // Maps of cached expressions.
-  std::map< unsigned, std::vector< double >                 > _cacheR;
-  std::map< unsigned, std::vector< std::complex< double > > > _cacheC;
+  // Contiguous blocks of cached expressions, stored event after event. The cached
+  //    values of event n start at position n * stride, and each pdf reads them at
+  //    the index it was assigned when caching.
+  std::size_t                           _strideR;
+  std::size_t                           _strideC;
+  std::vector< double                 > _cacheR;
+  std::vector< std::complex< double > > _cacheC;
+
+  // Streaming mode: the data is evaluated in chunks of a given number of entries, and the
+  //    cached values are spilled to a scratch file that is mapped in memory instead of
+  //    being kept in the vectors above. The chunk size is 0 if the mode is not used.
+  std::size_t                           _chunkSize;
+  std::string                           _scratch;
+  std::shared_ptr< const MappedFile >   _cacheFile;
+
+  // Beginning of the blocks of cached values, either in memory or in the scratch file.
+  const double*                         _blockR;
+  const std::complex< double >*         _blockC;
+
+  // Pointers to the cached values of a given event. They are null if nothing has been cached.
+  const double* cachedReal( const std::size_t& event ) const
+  {
+    return _strideR ? _blockR + event * _strideR : 0;
+  }
+
+  const std::complex< double >* cachedComplex( const std::size_t& event ) const
+  {
+    return _strideC ? _blockC + event * _strideC : 0;
+  }
+
+  // Let the pdf compute the values of the entries [ first, last ) that depend on the
+  //    parameters from their cached ones, before evaluating them.
+  void cacheBlock( const std::size_t& first, const std::size_t& last ) const
+  {
+    _pdf->cacheBlock( cachedReal( first ), _strideR, last - first );
+  }
+
+  // Hints for mapped data and caches: read the entries [ first, last ) ahead
+  //    of their use, or drop them from memory once they have been used.
+  void prefetch( const std::size_t& first, const std::size_t& last ) const;
+  void release ( const std::size_t& first, const std::size_t& last ) const;
+
+  // Threads that evaluate the entries of the dataset, or null to use only the calling one.
+  std::unique_ptr< ThreadPool >         _pool;
+
+  // Sum of the terms of the entries [ first, last ), given by a function of a range of
+  //    entries. The range is split among the threads, and their partial sums are added
+  //    up in a fixed order, so the result does not depend on their scheduling.
+  double sum( const std::function< double ( const std::size_t&, const std::size_t& ) >& terms,
+              const std::size_t& first, const std::size_t& last ) const throw( PdfException );
 
 public:
   Minimizer( const PdfBase& pdf, const Dataset& data )
-    : _pdf    ( pdf.copy() ),
-      _data   ( data       ),
-      _up     ( -1.0       ),
-      _verbose( false      )
+    : _pdf      ( pdf.copy() ),
+      _data     ( data       ),
+      _up       ( -1.0       ),
+      _verbose  ( false      ),
+      _strideR  ( 0          ),
+      _strideC  ( 0          ),
+      _chunkSize( 0          ),
+      _blockR   ( 0          ),
+      _blockC   ( 0          )
   {
     cache();
   }
 
+  // Streaming constructor. The scratch file is removed once it has been mapped.
+  Minimizer( const PdfBase& pdf, const Dataset& data, const std::size_t& chunkSize, const std::string& scratch )
+    : _pdf      ( pdf.copy() ),
+      _data     ( data       ),
+      _up       ( -1.0       ),
+      _verbose  ( false      ),
+      _strideR  ( 0          ),
+      _strideC  ( 0          ),
+      _chunkSize( chunkSize  ),
+      _scratch  ( scratch    ),
+      _blockR   ( 0          ),
+      _blockC   ( 0          )
+  {
+    if ( _chunkSize )
+      cacheToFile();
+    else
+      cache();
+  }
+
   // Copy constructor.
   Minimizer( const Minimizer& minimizer )
-    : _pdf    ( minimizer._pdf->copy() ),
-      _data   ( minimizer._data        ),
-      _up     ( minimizer._up          ),
-      _verbose( minimizer._verbose     ),
-      _cacheR ( minimizer._cacheR      ),
-      _cacheC ( minimizer._cacheC      )
-    {}
+    : _pdf      ( minimizer._pdf->copy() ),
+      _data     ( minimizer._data        ),
+      _up       ( minimizer._up          ),
+      _verbose  ( minimizer._verbose     ),
+      _strideR  ( minimizer._strideR     ),
+      _strideC  ( minimizer._strideC     ),
+      _cacheR   ( minimizer._cacheR      ),
+      _cacheC   ( minimizer._cacheC      ),
+      _chunkSize( minimizer._chunkSize   ),
+      _scratch  ( minimizer._scratch     ),
+      _cacheFile( minimizer._cacheFile   ),
+      _blockR   ( minimizer._blockR      ),
+      _blockC   ( minimizer._blockC      ),
+      _pool     ( minimizer._pool ? new ThreadPool( minimizer._pool->size() ) : 0 )
+    {
+      // Cached values in memory belong to each minimizer.
+      if ( ! _cacheFile )
+      {
+        _blockR = _cacheR.data();
+        _blockC = _cacheC.data();
+      }
+    }
 
   virtual Minimizer* copy() const = 0;
 
@@ -64,10 +157,19 @@ public:
   double up() const throw( MinimizerException );
   double operator()( const std::vector<double>& par ) const throw( PdfException ) = 0;
 
+  // Contribution of this process to the value of the minimizer. Running with MPI, the
+  //    contributions of all the processes add up to the value of operator().
+  virtual double local( const std::vector<double>& par ) const throw( PdfException ) = 0;
+
   // Setters.
   void setUp  ( const double& up         ) { _up      = up;  }
   void verbose( const bool&   val = true ) { _verbose = val; }
 
+  // Evaluate the entries of the dataset with a number of threads (as many as cores if 0).
+  //    The pdf is evaluated concurrently, so its evaluation must not modify it. With MPI,
+  //    run one process per node, such that the threads share its copy of the model.
+  void setThreads( const unsigned& nThreads = 0 );
+
   FunctionMinimum minimize() const;
 };
 
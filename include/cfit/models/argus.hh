@@ -21,6 +21,7 @@ private:
   double _upper;
 
   double _norm;
+  double _logNorm;
 
   void setParExpr();
 
@@ -46,7 +47,12 @@ public:
   const double evaluate( const double& x                   ) const throw( PdfException );
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
 
+  const bool   hasLog() const { return true; }
+  const double evaluateLog( const double& x                   ) const throw( PdfException );
+  const double evaluateLog( const std::vector< double >& vars ) const throw( PdfException );
+
   const double area( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 };
 
 #endif
@@ -8,6 +8,7 @@
 #include <cfit/amplitude.hh>
 #include <cfit/phasespace.hh>
 #include <cfit/function.hh>
+#include <cfit/dalitzsampler.hh>
 
 #include <Minuit/FunctionMinimum.h>
 
@@ -17,8 +18,8 @@ class Decay3Body : public DecayModel< Amplitude >
 private:
   double _norm;
 
-  // Maximum value of the pdf.
-  double _maxPdf;
+  // Proposal and envelope of the accept-reject generation.
+  DalitzSampler _sampler;
 
   const double evaluateFuncs( const double& mSq12, const double& mSq13, const double& mSq23 ) const;
 
@@ -28,6 +29,10 @@ private:
     return ( max - min ) / double( nbins ) * ( bin + 0.5 ) + min;
   }
 
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
+
   void setParExpr() {}
 
 public:
@@ -46,8 +51,11 @@ public:
 
   const double project ( const std::string& varName, const double& value ) const throw( PdfException );
 
-  void setMaxPdf( const double& max ) { _maxPdf = max; }
-  const std::map< std::string, double > generate() const throw( PdfException );
+  // Generate from a flat proposal with a given maximum of the pdf. By default, the
+  //    proposal follows the resonances and its envelope is estimated automatically.
+  void setMaxPdf( const double& max ) { _sampler.setMaxPdf( max ); }
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 
   friend const Decay3Body  operator* (       Decay3Body left, const Function&  right );
   friend const Decay3Body  operator* ( const Function&  left,       Decay3Body right );
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <complex>
 
 #include <cfit/decaymodel.hh>
 #include <cfit/variable.hh>
@@ -25,19 +26,33 @@ private:
   CoefExpr      _phi;
 
   // Constants to speed up norm calculation.
-  double _nDir;
-  double _nXed;
-  double _norm;
+  double                 _nDir;
+  double                 _nCnj;
+  std::complex< double > _nXed;
+  double                 _norm;
 
   bool   _fixedAmp;
 
   // // Maximum value of the pdf.
   // double _maxPdf;
 
-  // Index of the cached bins.
+  // Efficiency-weighted phase space areas of the bins b and -b, for b = 1, ..., nBins.
+  //    They are only computed once if the efficiency is fixed.
+  std::vector< double > _apb;
+  std::vector< double > _amb;
+  bool                  _fixedAreas;
+
+  // Index of the cached bins, and of the cached efficiency if it is fixed.
+  bool     _cacheBins;
   unsigned _binIndex;
+  bool     _cacheEff;
+  unsigned _effIndex;
+
+  // Bins of the points of the grid that the areas are computed with, kept while the
+  //    efficiency is not fixed.
+  std::vector< int > _binCache;
 
-  std::vector< unsigned > _binCache;
+  void cacheAreas();
 
   // const double evaluateUnnorm( const int& bin ) const throw( PdfException );
   const double evaluateUnnorm( const double& mSq12, const double& mSq13 ) const throw( PdfException );
@@ -84,32 +99,52 @@ public:
   const double                 kappa() const { return _hasKappa ? _kappa.evaluate() : 1.0; }
 
   // Norm components getters.
-  const double& nDir() const { return _nDir; }
-  const double& nXed() const { return _nXed; }
+  const double&                 nDir() const { return _nDir; }
+  const double&                 nCnj() const { return _nCnj; }
+  const std::complex< double >& nXed() const { return _nXed; }
 
   // Norm components setters.
-  void setNormComponents( const double& nDir, const double& nXed )
+  void setNormComponents( const double& nDir, const double& nCnj, const std::complex< double >& nXed )
   {
     _fixedAmp = true; //_amp.isFixed();
 
     if ( _fixedAmp )
     {
       _nDir = nDir;
+      _nCnj = nCnj;
       _nXed = nXed;
     }
   }
 
+  void setNormComponents( const double& nDir, const std::complex< double >& nXed )
+  {
+    setNormComponents( nDir, nDir, nXed );
+  }
+
   // Caching functions.
   void cacheNormComponents();
   void cache();
 
+  // Counting mode. The pdf only depends on the bin of an event, so the nll is a
+  //    multinomial sum over the bins weighted by their contents. Histogram a dataset
+  //    into one entry per populated bin, at its first event and weighted by the sum
+  //    of the weights of its events. An Nll of the result has the same value as the
+  //    Nll of the whole dataset, up to a constant if there is an efficiency, at a cost
+  //    per call proportional to the number of bins. Throws if the efficiency floats,
+  //    or if the dataset has fields other than the variables of the pdf.
+  const Dataset counts( const Dataset& data ) const throw( PdfException );
+
   const double evaluate( const double& mSq12, const double& mSq13, const double& ) const throw( PdfException );
   const double evaluate( const double& mSq12, const double& mSq13                ) const throw( PdfException );
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
 
   const double evaluate( const std::vector< double >&                 vars  ,
-                         const std::vector< double >&                 cacheR,
-                         const std::vector< std::complex< double > >& cacheC ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC ) const throw( PdfException );
+
+  friend const Decay3BodyBin  operator* (       Decay3BodyBin left, const Function&     right );
+  friend const Decay3BodyBin  operator* ( const Function&     left,       Decay3BodyBin right );
+  const        Decay3BodyBin& operator*=( const Function& right ) throw( PdfException );
 };
 
 #endif
@@ -9,6 +9,7 @@
 #include <cfit/amplitude.hh>
 #include <cfit/phasespace.hh>
 #include <cfit/function.hh>
+#include <cfit/dalitzsampler.hh>
 
 #include <Minuit/FunctionMinimum.h>
 
@@ -31,8 +32,8 @@ private:
   // Keep track of whether the amplitudes and functions are all fixed.
   bool                   _fixed;
 
-  // Maximum value of the pdf.
-  double _maxPdf;
+  // Proposal and envelope of the accept-reject generation.
+  DalitzSampler _sampler;
 
   // Indices of the cached direct and conjugated amplitudes.
   bool     _cacheAmps;
@@ -55,6 +56,10 @@ private:
 
   const std::map< unsigned, std::vector< std::complex< double > > > cacheComplex( const Dataset& data );
 
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
+
   void setParExpr();
 
 public:
@@ -142,8 +147,8 @@ public:
   const double evaluate( const std::vector< double >& vars                             ) const throw( PdfException );
 
   const double evaluate( const std::vector< double >&                 vars  ,
-                         const std::vector< double >&                 cacheR,
-                         const std::vector< std::complex< double > >& cacheC           ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC           ) const throw( PdfException );
 
   virtual const double project ( const std::string& varName, const double& value                ) const throw( PdfException );
   virtual const double project ( const std::string& varName, const double& value, const Region& ) const throw( PdfException )
@@ -155,8 +160,11 @@ public:
   // Do not override other project members defined in PdfModel.
   using PdfModel::project;
 
-  void setMaxPdf( const double& max ) { _maxPdf = max; }
-  const std::map< std::string, double > generate() const throw( PdfException );
+  // Generate from a flat proposal with a given maximum of the pdf. By default, the
+  //    proposal follows the resonances and its envelope is estimated automatically.
+  void setMaxPdf( const double& max ) { _sampler.setMaxPdf( max ); }
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 
   friend const Decay3BodyCP  operator* (       Decay3BodyCP left, const Function&    right );
   friend const Decay3BodyCP  operator* ( const Function&    left,       Decay3BodyCP right );
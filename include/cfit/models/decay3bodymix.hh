@@ -10,6 +10,7 @@
 #include <cfit/amplitude.hh>
 #include <cfit/phasespace.hh>
 #include <cfit/function.hh>
+#include <cfit/dalitzsampler.hh>
 
 #include <Minuit/FunctionMinimum.h>
 
@@ -42,14 +43,57 @@ private:
 
   bool                   _fixedAmp;
 
-  // Maximum value of the pdf.
-  double _maxPdf;
+  // Limits of the decay time. Without a lower limit, the time starts at zero, or at
+  //    minus infinity if it has a resolution.
+  bool   _hasLower;
+  bool   _hasUpper;
+  double _lower;
+  double _upper;
+
+  // Gaussian resolution of the decay time: either its width, or the scale factor of the
+  //    error of the decay time of every event.
+  bool          _hasResolution;
+  bool          _perEventRes;
+  ParameterExpr _resolution;
+
+  // Values of the width, the mixing and the CP violation parameters at the last call to cache.
+  double                 _gammaVal;
+  double                 _xVal;
+  double                 _yVal;
+  std::complex< double > _qoverpVal;
+  double                 _resVal;
+
+  // Integrals over the Dalitz plot of the coefficients of the time evolution functions.
+  double                 _normp;
+  double                 _normm;
+  std::complex< double > _normi;
+
+  // Proposal and envelope of the accept-reject generation.
+  DalitzSampler _sampler;
 
   // Indices of the cached direct and conjugated amplitudes.
   bool     _cacheAmps;
   unsigned _ampDirCache;
   unsigned _ampCnjCache;
 
+  // Index of the first cached value of every event: its decay time and its error or, if
+  //    the width, the mixing parameters and the resolution are fixed, its time evolution
+  //    functions and, with a per-event resolution, their integrals between the limits.
+  bool     _cacheTimes;
+  bool     _cacheFuncs;
+  unsigned _timeCache;
+
+  // Time evolution functions of the entries of the last block given to cacheBlock, laid
+  //    out as the cached ones, when they depend on floating parameters. They are computed
+  //    with the time parameters in _blockPars, and only used while these are the values
+  //    of the last call to cache. Entries are found by the position of their cached values.
+  const double*         _block;
+  std::size_t           _blockStride;
+  std::size_t           _blockSize;
+  std::vector< double > _blockPars;
+  std::vector< double > _blockFuncs;
+  bool                  _blockValid;
+
   // const double evaluateFuncs() const;
   const double evaluateFuncs( const double& mSq12, const double& mSq13, const double& mSq23 ) const;
   const double evaluateFuncs( const double& mSq12, const double& mSq13                      ) const;
@@ -60,15 +104,66 @@ private:
     return ( max - min ) / double( nbins ) * ( bin + 0.5 ) + min;
   }
 
-  const double evaluateUnnorm( const double& mSq12, const double& mSq13, const double& mSq23, const double& t ) const;
+  // Unnormalized pdf for a given width of the resolution, regardless of the time limits.
+  const double evaluateUnnorm( const double& mSq12, const double& mSq13, const double& mSq23,
+                               const double& t    , const double& sigma                       ) const;
+
+  const double lowerLimit() const;
+  const double upperLimit() const;
 
   void cacheNormComponents();
 
+  const std::map< unsigned, std::vector<               double   > > cacheReal   ( const Dataset& data );
   const std::map< unsigned, std::vector< std::complex< double > > > cacheComplex( const Dataset& data );
 
-  const double                 psip( const double& t ) const;
-  const double                 psim( const double& t ) const;
-  const std::complex< double > psii( const double& t ) const;
+  void cacheBlock( const double* cacheR, const std::size_t& stride, const std::size_t& size );
+
+  // Whether the width, the mixing parameters and the resolution are all fixed.
+  const bool timeFixed() const;
+
+  // Values at the last call to cache of everything the time evolution functions depend on.
+  const std::vector< double > timePars() const;
+
+  // Number of time evolution values of every event: psi_+, psi_-, and the real and
+  //    imaginary parts of psi_i, followed by their integrals between the limits if the
+  //    resolution is per event.
+  const std::size_t nTimeFuncs() const { return ( _hasResolution && _perEventRes ) ? 8 : 4; }
+
+  // Time evolution functions for a decay time and its error, and the norm of the pdf
+  //    for them.
+  void timeFuncs( const double& t, const double& error,
+                  double& psip, double& psim, std::complex< double >& psii, double& norm ) const;
+
+  // The same for n events and given time parameters, with the Faddeeva function of all
+  //    of them evaluated at once. The values of every event are stored after those of
+  //    the previous one.
+  void timeFuncs( const double& gamma, const double& x, const double& y, const double& res,
+                  const double* t, const double* error, const std::size_t& n, double* funcs ) const;
+
+  // Squared amplitude, given the direct and conjugated amplitudes and the time evolution functions.
+  const double ampSq( const std::complex< double >& ampDir, const std::complex< double >& ampCnj,
+                      const double& psip, const double& psim, const std::complex< double >& psii ) const;
+
+  const double                 psip( const double& t, const double& sigma ) const;
+  const double                 psim( const double& t, const double& sigma ) const;
+  const std::complex< double > psii( const double& t, const double& sigma ) const;
+
+  // Decay e^[ - k t ] for positive times convolved with a Gaussian of width sigma, and
+  //    its integral between two limits, that may be infinite.
+  static const std::complex< double > decay   ( const std::complex< double >& k, const double& t, const double& sigma );
+  static const std::complex< double > integral( const std::complex< double >& k,
+                                                const double& lower, const double& upper, const double& sigma );
+
+  // The same for n times and widths, with the Faddeeva function of all of them evaluated
+  //    at once by the batch kernels of Math.
+  static void decay   ( const std::complex< double >& k, const double* t, const double* sigma,
+                        std::complex< double >* result, const std::size_t& n );
+  static void integral( const std::complex< double >& k, const double& lower, const double& upper,
+                        const double* sigma, std::complex< double >* result, const std::size_t& n );
+
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
 
   void setParExpr();
 
@@ -97,12 +192,13 @@ public:
   Decay3BodyMix* copy() const;
 
   // Getters.
-  const double                 gamma()  const { return _width.evaluate();          }
-  const double                 tau()    const { return 1.0 / gamma();              }
-  const double                 x()      const { return std::real( _z.evaluate() ); }
-  const double                 y()      const { return std::imag( _z.evaluate() ); }
-  const std::complex< double > z()      const { return _z     .evaluate();         }
-  const std::complex< double > qoverp() const { return _qoverp.evaluate();         }
+  const double                 gamma()      const { return _width.evaluate();          }
+  const double                 tau()        const { return 1.0 / gamma();              }
+  const double                 x()          const { return std::real( _z.evaluate() ); }
+  const double                 y()          const { return std::imag( _z.evaluate() ); }
+  const std::complex< double > z()          const { return _z     .evaluate();         }
+  const std::complex< double > qoverp()     const { return _qoverp.evaluate();         }
+  const double                 resolution() const { return _resolution.evaluate();     }
 
   // Getters for the norm components.
   const double&                 nDir() const { return _nDir; }
@@ -114,6 +210,23 @@ public:
   void setCPV          ( const CoefExpr& qoverp );
   inline void setqoverp( const CoefExpr& qoverp ) { setCPV( qoverp ); }
 
+  // Limits of the decay time.
+  void setLowerLimit  ( const double& lower );
+  void setUpperLimit  ( const double& upper );
+  void setLimits      ( const double& lower, const double& upper );
+  void unsetLowerLimit();
+  void unsetUpperLimit();
+  void unsetLimits    ();
+
+  // Gaussian resolution of the decay time, either with a given width or with the error
+  //    of the decay time of every event times a scale factor. The per-event resolution
+  //    can only be used to evaluate cached datasets, and the pdf is normalized for the
+  //    resolution of every event. The convolved functions and, with a per-event
+  //    resolution, their integrals are computed for all the events in one pass when
+  //    the time parameters change, so evaluating an event only reads them.
+  void setResolution        ( const ParameterExpr& sigma       );
+  void setPerEventResolution( const ParameterExpr& scale = 1.0 );
+
   // Norm components setters.
   void setNormComponents( const double& nDir, const double& nCnj, const std::complex< double >& nXed )
   {
@@ -150,13 +263,16 @@ public:
 
   const double evaluate( const std::vector< double >&                 vars    ) const throw( PdfException );
   const double evaluate( const std::vector< double >&                 vars  ,
-                         const std::vector< double >&                 cacheR,
-                         const std::vector< std::complex< double > >& cacheC  ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC  ) const throw( PdfException );
 
   const double project ( const std::string& varName, const double& value ) const throw( PdfException );
 
-  void setMaxPdf( const double& max ) { _maxPdf = max; }
-  const std::map< std::string, double > generate() const throw( PdfException );
+  // Generate from a flat proposal with a given maximum of the pdf. By default, the
+  //    proposal follows the resonances and its envelope is estimated automatically.
+  void setMaxPdf( const double& max ) { _sampler.setMaxPdf( max ); }
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 
   friend const Decay3BodyMix  operator* (       Decay3BodyMix left, const Function&     right );
   friend const Decay3BodyMix  operator* ( const Function&     left,       Decay3BodyMix right );
@@ -36,6 +36,10 @@ private:
   bool     _doCache;
   unsigned _cacheIdx;
 
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
+
   void setParExpr();
 
 public:
@@ -71,12 +75,14 @@ public:
   const double evaluate( const double& x                   ) const throw( PdfException );
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
   const double evaluate( const std::vector< double >&                 vars  ,
-                         const std::vector< double >&                 cacheR,
-                         const std::vector< std::complex< double > >& cacheC ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC ) const throw( PdfException );
 
   const double area    ( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 
-  const std::map< std::string, double > generate()              const throw( PdfException );
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 };
 
 #endif
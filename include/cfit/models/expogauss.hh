@@ -26,8 +26,21 @@ private:
 
   double _norm;
 
+  // Values of the parameters at the last call to cache.
+  double _gammaVal;
+  double _muVal;
+  double _sigmaVal;
+
   const double expogauss( const double& x ) const;
 
+  // Unnormalized pdf regardless of the limits, and its integral from minus infinity.
+  const double tail      ( const double& x ) const;
+  const double cumulative( const double& x ) const;
+
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
+
   void setParExpr();
 
 public:
@@ -57,8 +70,10 @@ public:
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
 
   const double area    ( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 
-  const std::map< std::string, double > generate()              const throw( PdfException );
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 };
 
 #endif
@@ -20,6 +20,11 @@ private:
   double _upper;
 
   double _norm;
+  double _logNorm;
+
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
 
   void setParExpr();
 
@@ -44,9 +49,15 @@ public:
   const double evaluate( const double& x                   ) const throw( PdfException );
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
 
+  const bool   hasLog() const { return true; }
+  const double evaluateLog( const double& x                   ) const throw( PdfException );
+  const double evaluateLog( const std::vector< double >& vars ) const throw( PdfException );
+
   const double area    ( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 
-  const std::map< std::string, double > generate()              const throw( PdfException );
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 };
 
 #endif
@@ -21,11 +21,16 @@ private:
   double _upper;
 
   double _norm;
+  double _logNorm;
 
   // Index of the cached pdf.
   bool     _doCache;
   unsigned _cacheIdx;
 
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
+
   void setParExpr();
 
 public:
@@ -52,12 +57,21 @@ public:
   const double evaluate( const double& x                   ) const throw( PdfException );
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
   const double evaluate( const std::vector< double >&                 vars  ,
-                         const std::vector< double >&                 cacheR,
-                         const std::vector< std::complex< double > >& cacheC ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC ) const throw( PdfException );
+
+  const bool   hasLog() const { return true; }
+  const double evaluateLog( const double& x                   ) const throw( PdfException );
+  const double evaluateLog( const std::vector< double >& vars ) const throw( PdfException );
+  const double evaluateLog( const std::vector< double >&                 vars  ,
+                            const double*                                cacheR,
+                            const std::complex< double >*                cacheC ) const throw( PdfException );
 
-  const std::map< std::string, double > generate() const throw( PdfException );
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 
   const double area    ( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 };
 
 #endif
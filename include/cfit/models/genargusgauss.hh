@@ -28,20 +28,53 @@ private:
 
   double _norm;
 
+  // Values of the parameters at the last call to cache.
+  double _cVal;
+  double _muVal;
+  double _sigmaVal;
+
+  // Roots and weights of the Gauss-Chebyshev quadrature of the convolution, that only
+  //    change with its degree, and the weights times the Argus core and the norm of the
+  //    Gaussian for the current parameters.
+  unsigned              _degree;
+  std::vector< double > _roots;
+  std::vector< double > _weights;
+  std::vector< double > _terms;
+
+  // Values and derivatives of the unnormalized convolution on a grid over the range of
+  //    the fit, interpolated to evaluate the events when the parameters float, and the
+  //    parameters and range they were last computed for.
+  bool                  _useGrid;
+  double                _gridMin;
+  double                _gridStep;
+  std::vector< double > _gridValues;
+  std::vector< double > _gridDerivs;
+  std::vector< double > _gridPars;
+
   // Index of the cached pdf.
   bool     _doCache;
   unsigned _cacheIdx;
 
-  // Intented to cache areas within a range.
-  mutable std::map< std::pair< double, double >, double > _areas;
-
   const double genargus     ( const double& x ) const;
-  const double gauss        ( const double& x ) const;
   const double genargusgauss( const double& x ) const;
 
   const double genarguscore ( const double& x ) const;
 
-  const double generateArgus() const;
+  // Convolution and its derivative at a point.
+  void genargusgauss( const double& x, double& value, double& deriv ) const;
+
+  void cacheQuadrature();
+
+  // Range and number of points of the grid for the current parameters.
+  void gridRange( double& min, double& max, unsigned& size ) const;
+  void cacheGrid();
+
+  // Cubic Hermite interpolation of the convolution on the grid.
+  const double interpolate( const double& x ) const;
+
+  void generateBlock( RandomStream&                            stream ,
+                      const std::size_t&                       count  ,
+                      const std::map< std::string, double* >& columns ) const throw( PdfException );
 
   void setParExpr();
 
@@ -77,12 +110,14 @@ public:
   const double evaluate( const double& x                   ) const throw( PdfException );
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
   const double evaluate( const std::vector< double >&                 vars  ,
-                         const std::vector< double >&                 cacheR,
-                         const std::vector< std::complex< double > >& cacheC ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC ) const throw( PdfException );
 
   const double area    ( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 
-  const std::map< std::string, double > generate()              const throw( PdfException );
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfModel::generate;
 };
 
 #endif
@@ -47,6 +47,7 @@ public:
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
 
   const double area    ( const double& min, const double& max ) const throw( PdfException );
+  using PdfModel::area;
 };
 
 #endif
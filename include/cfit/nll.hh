@@ -2,6 +2,7 @@
 #define __NLL_HH__
 
 #include <vector>
+#include <string>
 
 #include <cfit/minimizer.hh>
 #include <cfit/pdfbase.hh>
@@ -10,15 +11,31 @@
 
 class Nll : public Minimizer
 {
+private:
+  // Factor sum( w ) / sum( w^2 ) that scales the nll of weighted datasets, so that
+  //    uncertainties correspond to the effective number of entries.
+  double _weightScale;
+
+  double terms( const std::size_t& first, const std::size_t& last ) const throw( PdfException );
+
 public:
   Nll( const PdfModel& pdf, const Dataset& data );
   Nll( const PdfExpr&  pdf, const Dataset& data );
 
+  // Streaming mode: evaluate the data in chunks of a given number of entries, with the
+  //    cached values spilled to a scratch file. Meant for datasets mapped from files.
+  Nll( const PdfModel& pdf, const Dataset& data, const std::size_t& chunkSize, const std::string& scratch );
+  Nll( const PdfExpr&  pdf, const Dataset& data, const std::size_t& chunkSize, const std::string& scratch );
+
   Nll( const Nll& nll );
 
   Nll* copy() const { return new Nll( *this ); }
 
+  // Enable or disable the sum of weights correction for weighted datasets.
+  void sumW2Correction( const bool& val = true );
+
   double operator()( const std::vector<double>& par ) const throw( PdfException );
+  double local     ( const std::vector<double>& par ) const throw( PdfException );
 };
 
 #endif
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <sstream>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 #include <cfit/exceptions.hh>
 
@@ -38,6 +41,14 @@ public:
   template < class T >
   static T operate( const T& x,             const Operation::Op& oper ) throw( PdfException );
 
+  // Operations on values represented by the logarithm of their absolute value and their sign.
+  typedef std::pair< double, double > LogValue;
+
+  static LogValue toLog  ( const double&   x );
+  static double   fromLog( const LogValue& x );
+
+  static LogValue operateLog( const LogValue& x, const LogValue& y, const Operation::Op& oper ) throw( PdfException );
+  static LogValue operateLog( const LogValue& x,                    const Operation::Op& oper ) throw( PdfException );
 };
 
 
@@ -85,4 +96,70 @@ inline T Operation::operate( const T& x, const Operation::Op& oper ) throw( PdfE
 }
 
 
+inline Operation::LogValue Operation::toLog( const double& x )
+{
+  return LogValue( std::log( std::fabs( x ) ), ( x < 0.0 ) ? -1.0 : 1.0 );
+}
+
+
+inline double Operation::fromLog( const LogValue& x )
+{
+  return x.second * std::exp( x.first );
+}
+
+
+// Binary operations in logarithmic scale. Sums and differences are computed with
+//    the log-sum-exp trick, products and quotients as sums and differences of logarithms.
+inline Operation::LogValue Operation::operateLog( const LogValue& x, const LogValue& y, const Operation::Op& oper ) throw( PdfException )
+{
+  if ( ( oper == Operation::plus ) || ( oper == Operation::minus ) )
+  {
+    const double& ysign = ( oper == Operation::plus ) ? y.second : - y.second;
+
+    if ( x.first == - std::numeric_limits< double >::infinity() )
+      return LogValue( y.first, ysign );
+    if ( y.first == - std::numeric_limits< double >::infinity() )
+      return x;
+
+    const bool&   xMax = x.first >= y.first;
+    const double& hi   = xMax ? x.first  : y.first;
+    const double& lo   = xMax ? y.first  : x.first;
+    const double& sign = xMax ? x.second : ysign;
+
+    if ( x.second == ysign )
+      return LogValue( hi + std::log1p(   std::exp( lo - hi ) ), sign );
+
+    if ( hi == lo )
+      return LogValue( - std::numeric_limits< double >::infinity(), 1.0 );
+
+    return LogValue( hi + std::log1p( - std::exp( lo - hi ) ), sign );
+  }
+  if ( oper == Operation::mult )
+    return LogValue( x.first + y.first, x.second * y.second );
+  if ( oper == Operation::div )
+    return LogValue( x.first - y.first, x.second * y.second );
+  if ( oper == Operation::pow )
+  {
+    if ( x.second > 0.0 )
+      return LogValue( fromLog( y ) * x.first, 1.0 );
+    return toLog( std::pow( fromLog( x ), fromLog( y ) ) );
+  }
+
+  throw PdfException( std::string( "Parse error: unknown binary operation " ) + Operation::tostring( oper ) + "." );
+}
+
+
+// Unary operations in logarithmic scale. Only the sign change and the exponential can
+//    be computed without leaving the logarithmic scale.
+inline Operation::LogValue Operation::operateLog( const LogValue& x, const Operation::Op& oper ) throw( PdfException )
+{
+  if ( oper == Operation::minus )
+    return LogValue( x.first, - x.second );
+  if ( oper == Operation::exp )
+    return LogValue( fromLog( x ), 1.0 );
+
+  return toLog( operate( fromLog( x ), oper ) );
+}
+
+
 #endif
@@ -0,0 +1,97 @@
+#ifndef __PARALLEL_HH__
+#define __PARALLEL_HH__
+
+#include <complex>
+#include <vector>
+
+#ifdef MPI_ON
+#include <mpi.h>
+#endif
+
+// Split of loops among the processes of an MPI job, and sums of their partial results.
+//    Without MPI, or before it is initialized, there is a single process and the sums
+//    leave the values untouched.
+//
+// Loops over the rows of a grid are interleaved, i.e. process r takes rows r, r + size,
+//    r + 2 size, ..., which balances triangular loops and the Dalitz plot boundaries.
+class Parallel
+{
+public:
+#ifdef MPI_ON
+  typedef MPI_Request Request;
+#else
+  typedef int         Request;
+#endif
+
+private:
+#ifdef MPI_ON
+  static bool initialized()
+  {
+    int flag = 0;
+    MPI_Initialized( &flag );
+    return flag;
+  }
+#endif
+
+public:
+  static int rank()
+  {
+    int rank = 0;
+#ifdef MPI_ON
+    if ( initialized() )
+      MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+#endif
+    return rank;
+  }
+
+  static int size()
+  {
+    int size = 1;
+#ifdef MPI_ON
+    if ( initialized() )
+      MPI_Comm_size( MPI_COMM_WORLD, &size );
+#endif
+    return size;
+  }
+
+  // Add up values over all the processes, leaving the result in all of them.
+  static void sum( double* values, const int& n )
+  {
+#ifdef MPI_ON
+    if ( initialized() && ( size() > 1 ) )
+      MPI_Allreduce( MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
+#endif
+  }
+
+  static void sum( std::complex< double >* values, const int& n )
+  {
+    sum( reinterpret_cast< double* >( values ), 2 * n );
+  }
+
+  static void sum( double&                 value ) { sum( &value, 1 ); }
+  static void sum( std::complex< double >& value ) { sum( &value, 1 ); }
+
+  // Start adding up values over all the processes without waiting for the result, such
+  //    that other work can be done meanwhile. The values must not be used until the
+  //    returned request has been waited for.
+  static Request startSum( double* values, const int& n )
+  {
+    Request request = Request();
+#ifdef MPI_ON
+    request = MPI_REQUEST_NULL;
+    if ( initialized() && ( size() > 1 ) )
+      MPI_Iallreduce( MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &request );
+#endif
+    return request;
+  }
+
+  static void wait( std::vector< Request >& requests )
+  {
+#ifdef MPI_ON
+    if ( ! requests.empty() )
+      MPI_Waitall( requests.size(), requests.data(), MPI_STATUSES_IGNORE );
+#endif
+  }
+};
+
+#endif
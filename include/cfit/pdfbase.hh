@@ -6,11 +6,13 @@
 #include <map>
 #include <complex>
 #include <algorithm>
+#include <cmath>
 
 #include <cfit/variable.hh>
 #include <cfit/parameter.hh>
 #include <cfit/exceptions.hh>
 #include <cfit/functors.hh>
+#include <cfit/random.hh>
 
 
 class Dataset;
@@ -35,6 +37,21 @@ protected:
     return std::map< unsigned, std::vector< std::complex< double > > >();
   }
 
+  // Before evaluating the pdf at a block of consecutive entries, compute anything that
+  //    depends both on the parameters and on the cached values of every entry. The real
+  //    values of the entries start at cacheR, one entry every stride values.
+  virtual void cacheBlock( const double* cacheR, const std::size_t& stride, const std::size_t& size ) {}
+
+  // Generate count events, storing the values of every variable in its column. By
+  //    default the events are generated one at a time; models override it with
+  //    loops over the whole block.
+  virtual void generateBlock( RandomStream&                            stream ,
+                              const std::size_t&                       count  ,
+                              const std::map< std::string, double* >& columns ) const throw( PdfException );
+
+  // Generate a single event through generateBlock.
+  const std::map< std::string, double > generateEvent( RandomStream& stream ) const throw( PdfException );
+
   std::map< std::string, Variable  > _varMap;
   std::map< std::string, Parameter > _parMap;
 
@@ -86,10 +103,34 @@ public:
   }
 
   virtual const double evaluate( const std::vector< double                 >& vars,
-                                 const std::vector< double                 >&     ,
-                                 const std::vector< std::complex< double > >&       ) const throw( PdfException ) = 0;
+                                 const double*                                    ,
+                                 const std::complex< double >*                      ) const throw( PdfException ) = 0;
+
+  // Logarithm of the pdf. Pdfs that can compute it analytically should override these functions
+  //    and declare it through hasLog(), so that minimizers avoid computing log( exp( ... ) ) and
+  //    keep the tails of the distribution from underflowing.
+  virtual const bool   hasLog() const { return false; }
+
+  virtual const double evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+  {
+    return std::log( evaluate( vars ) );
+  }
 
-  virtual const std::map< std::string, double > generate()           const throw( PdfException ) = 0;
+  virtual const double evaluateLog( const std::vector< double >&  vars  ,
+                                    const double*                 cacheR,
+                                    const std::complex< double >* cacheC ) const throw( PdfException )
+  {
+    return std::log( evaluate( vars, cacheR, cacheC ) );
+  }
+
+  // Generate an event with the given random stream. Parallel generation should give
+  //    every thread or task its own stream, so that the result is reproducible.
+  virtual const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException ) = 0;
+
+  // Generate a dataset of n events, split in blocks among nThreads threads (as many as
+  //    cores if 0). Every block uses its own stream, derived from a number drawn from
+  //    the given one, so the dataset only depends on the state of the stream.
+  const Dataset generate( const std::size_t& n, RandomStream& stream, const unsigned& nThreads = 0 ) const throw( PdfException );
 
   virtual const double project( const std::string& varName,
                                 const double&      value    ) const throw( PdfException ) = 0;
@@ -109,6 +150,12 @@ public:
 
   virtual const double yield() const = 0;
 
+  // Area of the pdf between two values of one of its variables, for pdfs that can be integrated analytically.
+  virtual double area( const std::string& var, const double& min, const double& max ) const throw( PdfException )
+  {
+    throw PdfException( "PdfBase::area: the pdf cannot be integrated analytically." );
+  }
+
   const bool dependsOn( const std::string& var ) const
   {
     const std::vector< std::string >& vars = varNames();
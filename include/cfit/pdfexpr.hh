@@ -20,6 +20,8 @@ class Region;
 
 class PdfExpr : public PdfBase
 {
+  friend class Convolution;
+
 private:
   std::string                  _expression;
   std::vector< Operation::Op > _opers;
@@ -49,7 +51,7 @@ private:
     append( oper  );
   }
 
-  const std::map< std::string, double > generateFull() const throw( PdfException );
+  const std::map< std::string, double > generateFull( RandomStream& stream ) const throw( PdfException );
 
 
   template < class T >
@@ -62,6 +64,8 @@ private:
   const std::map< unsigned, std::vector<               double   > > cacheReal   ( const Dataset& data );
   const std::map< unsigned, std::vector< std::complex< double > > > cacheComplex( const Dataset& data );
 
+  void cacheBlock( const double* cacheR, const std::size_t& stride, const std::size_t& size );
+
 public:
   PdfExpr() : _scale( 1.0 ) {};
   PdfExpr( const PdfModel& model )
@@ -91,10 +95,18 @@ public:
   void         cache();
   const double evaluate( const std::vector< double >& vars ) const throw( PdfException );
 
-  const std::map< std::string, double > generate() const throw( PdfException );
+  const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException );
+  using PdfBase::generate;
   const double evaluate( const std::vector< double                 >& vars  ,
-                         const std::vector< double                 >& cacheR,
-                         const std::vector< std::complex< double > >& cacheC  ) const throw( PdfException );
+                         const double*                                cacheR,
+                         const std::complex< double >*                cacheC  ) const throw( PdfException );
+
+  // Logarithm of the pdf, computed in logarithmic scale when all the models in the expression support it.
+  const bool   hasLog() const;
+  const double evaluateLog( const std::vector< double >& vars ) const throw( PdfException );
+  const double evaluateLog( const std::vector< double                 >& vars  ,
+                            const double*                                cacheR,
+                            const std::complex< double >*                cacheC  ) const throw( PdfException );
 
   const double project( const std::string& varName,
                         const double&      value    ) const throw( PdfException );
@@ -155,6 +167,10 @@ public:
   friend const PdfExpr operator+( const PdfExpr&       left, const PdfExpr&       right );
   friend const PdfExpr operator*( const PdfExpr&       left, const PdfExpr&       right );
 
+  // Convolution over the common variable of both pdfs.
+  friend const PdfExpr operator^( const PdfModel&      left, const PdfModel&      right ) throw( PdfException );
+  friend const PdfExpr operator^( const PdfModel&      left, const PdfExpr&       right ) throw( PdfException );
+  friend const PdfExpr operator^( const PdfExpr&       left, const PdfModel&      right ) throw( PdfException );
   friend const PdfExpr operator^( const PdfExpr&       left, const PdfExpr&       right ) throw( PdfException );
 
   friend const PdfExpr operator*( const Parameter&     left, const PdfModel&      right );
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include <cfit/exceptions.hh>
 #include <cfit/variable.hh>
@@ -22,10 +23,39 @@ class PdfModel : public PdfBase
 {
   friend class PdfExpr;
 
+private:
+  // Areas already computed, in a table indexed by a hash of their range, that keeps the
+  //    last one for every index. Every area is stamped with the version of the model it
+  //    was computed with, that changes whenever the value of a parameter or a limit
+  //    changes, so the areas of previous versions are never used. The table is guarded
+  //    by a mutex, since areas may be requested from several threads at once, as in
+  //    threaded evaluation and generation.
+  struct CachedArea
+  {
+    double        min;
+    double        max;
+    unsigned long version;
+    double        value;
+  };
+
+  unsigned long                     _version;
+  mutable std::vector< CachedArea > _areas;
+  mutable std::mutex                _areasMutex;
+
 protected:
   std::vector< std::string > _varOrder;
   std::vector< std::string > _parOrder;
 
+  PdfModel();
+  PdfModel( const PdfModel& model );
+  PdfModel& operator=( const PdfModel& model );
+
+  // Models must call it when anything other than the parameters changes their area,
+  //    like their limits, and in cache, since their areas are computed from the values
+  //    cached there, and an area computed between setting the parameters and caching
+  //    would otherwise be kept for the new ones.
+  void invalidate() { ++_version; }
+
   void push( const Variable&        var  );
   void push( const Parameter&       par  );
   void push( const Coef&            coef );
@@ -73,21 +103,51 @@ public:
   // If a pdf model does not implement this function it's because it does not need to use cached values.
   //    Default to the standard evaluate function.
   virtual const double evaluate( const std::vector< double                 >& vars,
-                                 const std::vector< double                 >&     ,
-                                 const std::vector< std::complex< double > >&       ) const throw( PdfException )
+                                 const double*                                    ,
+                                 const std::complex< double >*                      ) const throw( PdfException )
   {
     return evaluate( vars );
   }
 
-  virtual const std::map< std::string, double > generate()           const throw( PdfException )
+  // Logarithm of the pdf. By default, compute it from the value of the pdf. Models that
+  //    implement it analytically must override the functions below and hasLog().
+  virtual const double evaluateLog( const double& value )               const throw( PdfException )
+  {
+    return std::log( evaluate( value ) );
+  }
+
+  virtual const double evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+  {
+    return std::log( evaluate( vars ) );
+  }
+
+  // Models with an analytic logarithm that do not use cached values do not need to
+  //    implement this function. Otherwise, take the logarithm of the cached evaluation.
+  virtual const double evaluateLog( const std::vector< double >&  vars  ,
+                                    const double*                 cacheR,
+                                    const std::complex< double >* cacheC ) const throw( PdfException )
+  {
+    if ( hasLog() )
+      return evaluateLog( vars );
+
+    return std::log( evaluate( vars, cacheR, cacheC ) );
+  }
+
+  virtual const std::map< std::string, double > generate( RandomStream& stream = Random::stream() ) const throw( PdfException )
   {
     throw PdfException( "Generate error: attempting to generate with a model without generate() implementation" );
   }
+  using PdfBase::generate;
 
 
   // Calculate the area of single-variable functions within given interval.
   virtual const double area( const double& min, const double& max ) const throw( PdfException );
 
+  // Area along a given variable. Models that do not depend on it are normalized to one.
+  //    The areas are memoized for the current parameters, so projections and fits in
+  //    sidebands only integrate every range once.
+  double area( const std::string& var, const double& min, const double& max ) const throw( PdfException );
+
 
   // Projection function for pdfs with one single variable.
   virtual const double project( const std::string& varName, const double& value ) const throw( PdfException )
@@ -113,7 +173,7 @@ public:
     cspMap::const_iterator end   = limits.end();
     for ( cspMap::const_iterator limit = begin; limit != end; ++limit )
       if ( this->dependsOn( limit->first ) )
-        return this->area( limit->second.first, limit->second.second );
+        return this->area( limit->first, limit->second.first, limit->second.second );
 
     return 1.0;
   }
@@ -156,7 +216,7 @@ public:
 
     for ( spmIter limit = limits.begin(); limit != limits.end(); ++limit )
       if ( this->dependsOn( limit->first ) )
-        return this->area( limit->second.first, limit->second.second );
+        return this->area( limit->first, limit->second.first, limit->second.second );
 
     return 1.0;
   }
@@ -170,6 +230,10 @@ public:
   friend const PdfExpr operator+( const PdfExpr&       left, const PdfModel&      right );
   friend const PdfExpr operator*( const PdfExpr&       left, const PdfModel&      right );
 
+  friend const PdfExpr operator^( const PdfModel&      left, const PdfModel&      right ) throw( PdfException );
+  friend const PdfExpr operator^( const PdfModel&      left, const PdfExpr&       right ) throw( PdfException );
+  friend const PdfExpr operator^( const PdfExpr&       left, const PdfModel&      right ) throw( PdfException );
+
   friend const PdfExpr operator*( const Parameter&     left, const PdfModel&      right );
   friend const PdfExpr operator*( const PdfModel&      left, const Parameter&     right );
   friend const PdfExpr operator/( const PdfModel&      left, const Parameter&     right );
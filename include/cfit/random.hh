@@ -1,40 +1,94 @@
 #ifndef __RANDOM_HH__
 #define __RANDOM_HH__
 
-#include <random>
+#include <limits>
+#include <cstdint>
 
-class Random
+// Counter-based random number stream (Philox4x32-10, Salmon et al., SC11). The key
+//    is the seed and the counter holds the stream number and the position in the
+//    stream, so any ( seed, stream ) pair gives the same sequence on every platform,
+//    independently of any other stream. Streams are cheap to create, so parallel jobs
+//    should use one per thread or per task instead of sharing one.
+//
+// It satisfies the requirements of a uniform random bit generator, so it can be used
+//    with the distributions of the standard library.
+class RandomStream
 {
+public:
+  typedef std::uint64_t result_type;
+
 private:
-  static std::mt19937_64                          _engine;
+  std::uint64_t _seed;
+  std::uint64_t _stream;
+  std::uint64_t _counter;
+
+  // Block of random numbers for the current counter, and next one to be returned.
+  std::uint64_t _block[ 2 ];
+  unsigned      _next;
 
-  static std::uniform_real_distribution< double > _uniform;
-  static std::normal_distribution      < double > _normal;
+  // Second normal deviate of the last Box-Muller pair.
+  double        _spare;
+  bool          _hasSpare;
+
+  void refill();
 
 public:
-  static std::mt19937_64& engine()
-  {
-    return _engine;
-  }
+  RandomStream( const std::uint64_t& seed = 0, const std::uint64_t& stream = 0 )
+    : _seed( seed ), _stream( stream ), _counter( 0 ), _next( 2 ), _spare( 0.0 ), _hasSpare( false )
+  {}
 
-  static void setSeed( const unsigned& seed ) { _engine.seed( seed ); }
+  static constexpr result_type min() { return 0;                                        }
+  static constexpr result_type max() { return std::numeric_limits< result_type >::max(); }
 
-  static const double flat   ( const double& min = 0.0, const double& max = 1.0 )
+  result_type operator()()
   {
-    return min + ( max - min ) * _uniform( engine() );
-  }
+    if ( _next == 2 )
+      refill();
 
-  static const double uniform( const double& min = 0.0, const double& max = 1.0 )
-  {
-    return min + ( max - min ) * _uniform( engine() );
+    return _block[ _next++ ];
   }
 
-  static const double normal( const double& mu = 0.0, const double& sigma = 1.0 )
+  // Skip the next n numbers in constant time.
+  void discard( std::uint64_t n );
+
+  // Independent stream of the same seed.
+  const RandomStream split( const std::uint64_t& stream ) const { return RandomStream( _seed, stream ); }
+
+  const std::uint64_t& seed  () const { return _seed;   }
+  const std::uint64_t& stream() const { return _stream; }
+
+  // Uniform in [ min, max ), with the 53 random bits of the mantissa.
+  const double flat( const double& min = 0.0, const double& max = 1.0 )
   {
-    return mu + sigma * _normal( _engine );
+    return min + ( max - min ) * ( ( *this )() >> 11 ) * ( 1.0 / 9007199254740992.0 );
   }
+
+  const double uniform( const double& min = 0.0, const double& max = 1.0 ) { return flat( min, max ); }
+
+  const double normal( const double& mu = 0.0, const double& sigma = 1.0 );
 };
 
 
-#endif
+// Default streams, for code that does not pass its own. Every thread has its own
+//    default stream, so they can be used concurrently. The calling thread that sets
+//    the seed gets stream 0, and other threads take the following streams in the
+//    order they first use them.
+class Random
+{
+private:
+  static std::uint64_t _seed;
+
+public:
+  static RandomStream& stream();
 
+  static RandomStream& engine() { return stream(); }
+
+  static void setSeed( const unsigned& seed );
+
+  static const double flat   ( const double& min = 0.0, const double& max = 1.0 ) { return stream().flat   ( min, max  ); }
+  static const double uniform( const double& min = 0.0, const double& max = 1.0 ) { return stream().uniform( min, max  ); }
+  static const double normal ( const double& mu  = 0.0, const double& sigma = 1.0 ) { return stream().normal ( mu, sigma ); }
+};
+
+
+#endif
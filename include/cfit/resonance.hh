@@ -61,6 +61,10 @@ public:
 
   const bool   isFixed() const;
 
+  // Indices of the resonant particles.
+  const unsigned& resoA() const { return _resoA; }
+  const unsigned& resoB() const { return _resoB; }
+
   const double mass()   const { return _parMap.find( _parOrder[ 0 ] )->second.value(); }
   const double m()      const { return _parMap.find( _parOrder[ 0 ] )->second.value(); }
   const double width()  const { return _parMap.find( _parOrder[ 1 ] )->second.value(); }
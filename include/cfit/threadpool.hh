@@ -0,0 +1,42 @@
+#ifndef __THREADPOOL_HH__
+#define __THREADPOOL_HH__
+
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed set of threads that run the same task, each one with its own index. The threads
+//    are started once and wait between tasks, so that running a task costs a wake-up
+//    instead of the creation of the threads. The calling thread takes the last index.
+//    Tasks must be run from one thread at a time.
+class ThreadPool
+{
+private:
+  std::vector< std::thread >                        _threads;
+  std::mutex                                        _mutex;
+  std::condition_variable                           _start;
+  std::condition_variable                           _done;
+  const std::function< void ( const unsigned& ) >* _task;
+  unsigned                                          _generation;
+  unsigned                                          _pending;
+  bool                                              _stop;
+
+  ThreadPool( const ThreadPool& );
+  ThreadPool& operator=( const ThreadPool& );
+
+  void work( const unsigned index );
+
+public:
+  // Pool with a given number of threads, counting the calling one (as many as cores if 0).
+  ThreadPool( const unsigned& nThreads = 0 );
+  ~ThreadPool();
+
+  unsigned size() const { return _threads.size() + 1; }
+
+  // Run task( index ) for every index in [ 0, size() ), and wait until all of them finish.
+  void run( const std::function< void ( const unsigned& ) >& task );
+};
+
+#endif
@@ -1,5 +1,6 @@
 
 #include <stack>
+#include <cmath>
 #include <algorithm>
 #include <functional>
 
@@ -43,6 +44,8 @@ BinnedAmplitude::BinnedAmplitude( const std::vector< Parameter >& npb,
     // _parMap.emplace( x->real().name(), x->real() );
     // _parMap.emplace( x->imag().name(), x->imag() );
   }
+
+  fill();
 }
 
 
@@ -77,6 +80,24 @@ BinnedAmplitude::BinnedAmplitude( const std::vector< ParameterExpr >& npb,
     const std::map< std::string, Parameter >& pars = x->getPars();
     _parMap.insert( pars.begin(), pars.end() );
   }
+
+  fill();
+}
+
+
+
+void BinnedAmplitude::fill()
+{
+  _tpb.resize( _nbins );
+  _tmb.resize( _nbins );
+  _txb.resize( _nbins );
+
+  for ( unsigned bin = 0; bin < _nbins; ++bin )
+  {
+    _tpb[ bin ] = _npb[ bin ].evaluate();
+    _tmb[ bin ] = _nmb[ bin ].evaluate();
+    _txb[ bin ] = std::sqrt( _tpb[ bin ] * _tmb[ bin ] ) * _xb[ bin ].evaluate();
+  }
 }
 
 
@@ -87,6 +108,16 @@ void BinnedAmplitude::setPars( const std::map< std::string, Parameter >& pars )
   for ( mIter par = _parMap.begin(); par != _parMap.end(); ++par )
     par->second.setValue( pars.find( par->first )->second.value() );
 
+  // Propagate the values to the expressions of every bin, and evaluate them once.
+  for ( unsigned bin = 0; bin < _nbins; ++bin )
+  {
+    _npb[ bin ].setPars( _parMap );
+    _nmb[ bin ].setPars( _parMap );
+    _xb [ bin ].setPars( _parMap );
+  }
+
+  fill();
+
   // // Set the values of the parameters.
   // typedef std::vector< Parameter >::iterator pIter;
   // for ( pIter par = _parms.begin(); par != _parms.end(); ++par )
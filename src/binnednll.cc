@@ -0,0 +1,184 @@
+
+#include <iostream>
+
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include <cfit/variable.hh>
+#include <cfit/dataset.hh>
+#include <cfit/pdfmodel.hh>
+#include <cfit/parallel.hh>
+#include <cfit/binnednll.hh>
+
+
+// Nodes and weights of the 5-point Gauss-Legendre quadrature in the interval ( -1, 1 ).
+static const unsigned glOrder     = 5;
+static const double   glNodes  [] = { -0.9061798459386640, -0.5384693101056831, 0.0,
+                                       0.5384693101056831,  0.9061798459386640 };
+static const double   glWeights[] = {  0.2369268850561891,  0.4786286704993665, 0.5688888888888889,
+                                       0.4786286704993665,  0.2369268850561891 };
+
+
+BinnedNll::BinnedNll( const PdfModel& pdf, const Histogram& hist, const bool& extended ) throw( PdfException )
+  : Minimizer( pdf, Dataset() ), _hist( hist ), _extended( extended )
+{
+  _up = 1.0;
+
+  init();
+}
+
+
+BinnedNll::BinnedNll( const PdfExpr& pdf, const Histogram& hist, const bool& extended ) throw( PdfException )
+  : Minimizer( pdf, Dataset() ), _hist( hist ), _extended( extended )
+{
+  _up = 1.0;
+
+  init();
+}
+
+
+BinnedNll::BinnedNll( const BinnedNll& nll )
+  : Minimizer( nll ),
+    _hist    ( nll._hist     ),
+    _extended( nll._extended ),
+    _useArea ( nll._useArea  ),
+    _nNodes  ( nll._nNodes   ),
+    _points  ( nll._points   ),
+    _weights ( nll._weights  )
+{}
+
+
+void BinnedNll::init() throw( PdfException )
+{
+  const std::vector< std::string >& varNames = _pdf->varNames();
+  const std::vector< Variable    >& histVars = _hist.vars();
+
+  if ( varNames.size() != histVars.size() )
+    throw PdfException( "BinnedNll: the histogram and the pdf must depend on the same variables." );
+
+  // Position of each variable of the pdf in the histogram.
+  std::vector< unsigned > dims;
+  for ( std::vector< std::string >::const_iterator var = varNames.begin(); var != varNames.end(); ++var )
+  {
+    unsigned dim = 0;
+    while ( ( dim < histVars.size() ) && ( histVars[ dim ].name() != *var ) )
+      ++dim;
+
+    if ( dim == histVars.size() )
+      throw PdfException( "BinnedNll: the pdf depends on variable " + *var + ", which is not in the histogram." );
+
+    dims.push_back( dim );
+  }
+
+  // Use the analytical area in one dimension if the pdf provides it.
+  _useArea = false;
+  if ( dims.size() == 1 )
+    try
+    {
+      _pdf->area( varNames[ 0 ], _hist.binLower( 0, 0 ), _hist.binUpper( 0, 0 ) );
+      _useArea = true;
+    }
+    catch ( PdfException& ) {}
+
+  _nNodes = 1;
+  for ( unsigned dim = 0; dim < dims.size(); ++dim )
+    _nNodes *= glOrder;
+
+  if ( _useArea )
+    return;
+
+  // Tensor product of the quadrature rule in every dimension, for every bin. The points
+  //    are stored in the order of the variables of the pdf.
+  const std::size_t& nVars = dims.size();
+  _points .reserve( _hist.size() * _nNodes * nVars );
+  _weights.reserve( _hist.size() * _nNodes         );
+  for ( std::size_t bin = 0; bin < _hist.size(); ++bin )
+    for ( std::size_t node = 0; node < _nNodes; ++node )
+    {
+      double      weight = 1.0;
+      std::size_t index  = node;
+      for ( std::size_t var = 0; var < nVars; ++var )
+      {
+        const double& lower = _hist.binLower( bin, dims[ var ] );
+        const double& half  = _hist.width( dims[ var ] ) / 2.0;
+
+        _points.push_back( lower + half * ( 1.0 + glNodes[ index % glOrder ] ) );
+        weight *= half * glWeights[ index % glOrder ];
+        index  /= glOrder;
+      }
+      _weights.push_back( weight );
+    }
+}
+
+
+const double BinnedNll::integral( const std::size_t& bin ) const throw( PdfException )
+{
+  if ( _useArea )
+    return _pdf->area( _hist.vars()[ 0 ].name(), _hist.binLower( bin, 0 ), _hist.binUpper( bin, 0 ) );
+
+  const std::size_t& nVars = _hist.dim();
+
+  std::vector< double > vars( nVars );
+
+  double integ = 0.0;
+  for ( std::size_t node = bin * _nNodes; node < ( bin + 1 ) * _nNodes; ++node )
+  {
+    vars.assign( _points.begin() + node * nVars, _points.begin() + ( node + 1 ) * nVars );
+    integ += _weights[ node ] * _pdf->evaluate( vars );
+  }
+
+  return integ;
+}
+
+
+double BinnedNll::operator()( const std::vector<double>& pars ) const throw( PdfException )
+{
+  if ( pars.size() != _pdf->nPars() )
+    throw PdfException( "Number of parameters passed does not match number of required arguments." );
+
+  _pdf->setPars( pars );
+
+  // Before evaluating the pdf at all bins, cache anything common to
+  //    all of them (usually compute the norm).
+  _pdf->cache();
+
+  const std::size_t& size = _hist.size();
+
+  // Expected content of each bin, before scaling it in non-extended fits.
+  std::vector< double > expected( size );
+  double sumExpected = 0.0;
+  for ( std::size_t bin = 0; bin < size; ++bin )
+  {
+    expected[ bin ] = integral( bin );
+    sumExpected    += expected[ bin ];
+  }
+
+  const double& scale = _extended ? 1.0 : _hist.total() / sumExpected;
+
+  // Poisson likelihood ratio to the saturated model, such that it behaves like a chi^2:
+  //    -2 log( lambda ) = 2 Sum [ nu - n + n log( n / nu ) ].
+  double nll = 0.0;
+  for ( std::size_t bin = 0; bin < size; ++bin )
+  {
+    const double& nu = scale * expected[ bin ];
+    const double& n  = _hist.count( bin );
+
+    nll += 2.0 * ( nu - n );
+    if ( n > 0.0 )
+      nll += 2.0 * n * std::log( n / nu );
+  }
+
+  if ( _verbose )
+    std::cout << "nll = " << nll << std::endl;
+
+  return nll;
+}
+
+
+double BinnedNll::local( const std::vector<double>& pars ) const throw( PdfException )
+{
+  const double& nll = ( *this )( pars );
+
+  return ( Parallel::rank() == 0 ) ? nll : 0.0;
+}
@@ -1,5 +1,6 @@
 
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <limits>
 #include <stdexcept>
@@ -9,6 +10,12 @@
 #include <cfit/exceptions.hh>
 
 
+// Constants of the binary format of binning schemes.
+static const char          fileMagic[ 8 ] = { 'C', 'F', 'I', 'T', 'B', 'I', 'N', 'S' };
+static const std::uint32_t fileVersion    = 1;
+static const std::uint32_t fileByteOrder  = 0x01020304;
+
+
 float Binning::distance( const std::pair< float, float >& a, const std::pair< float, float >& b )
 {
   return std::sqrt( std::pow( a.first - b.first, 2 ) + std::pow( a.second - b.second, 2 ) );
@@ -21,11 +28,168 @@ float Binning::distance( const std::pair< float, float >& a, const float& bx, co
 }
 
 
-Binning::Binning( const Data& xybin )
-  : _xybinx( xybin ), _xybiny( xybin )
+Binning::Binning( const Data& xybin, const unsigned& cells )
+  : _xybinx( xybin ), _xybiny( xybin ), _cells( 0 ), _xmin( 0.0 ), _ymin( 0.0 ), _xscale( 0.0 ), _yscale( 0.0 )
 {
   std::sort( _xybinx.begin(), _xybinx.end(), ByX() );
   std::sort( _xybiny.begin(), _xybiny.end(), ByY() );
+
+  rasterize( cells );
+}
+
+
+Binning::Binning( const std::string& filename ) throw( PdfException )
+  : _cells( 0 ), _xmin( 0.0 ), _ymin( 0.0 ), _xscale( 0.0 ), _yscale( 0.0 )
+{
+  std::ifstream file( filename.c_str(), std::ios::binary );
+  if ( ! file )
+    throw PdfException( "Binning: cannot open file " + filename + "." );
+
+  auto read = [ & ]( void* dest, const std::size_t& bytes )
+  {
+    if ( ! file.read( reinterpret_cast< char* >( dest ), bytes ) )
+      throw PdfException( "Binning: file " + filename + " is truncated." );
+  };
+
+  char          magic[ 8 ];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint64_t nPoints;
+
+  read( magic, sizeof( magic ) );
+  if ( std::memcmp( magic, fileMagic, sizeof( magic ) ) )
+    throw PdfException( "Binning: file " + filename + " is not a cfit binning scheme." );
+
+  read( &version  , sizeof( version   ) );
+  read( &byteOrder, sizeof( byteOrder ) );
+  if ( version != fileVersion )
+    throw PdfException( "Binning: unsupported version of file " + filename + "." );
+  if ( byteOrder != fileByteOrder )
+    throw PdfException( "Binning: file " + filename + " was written with a different byte order." );
+
+  read( &nPoints, sizeof( nPoints ) );
+
+  float         x;
+  float         y;
+  std::uint32_t bin;
+  _xybiny.reserve( nPoints );
+  for ( std::uint64_t point = 0; point < nPoints; ++point )
+  {
+    read( &x  , sizeof( x   ) );
+    read( &y  , sizeof( y   ) );
+    read( &bin, sizeof( bin ) );
+    _xybiny.push_back( Datum( std::make_pair( x, y ), bin ) );
+  }
+
+  // The points are written sorted by y, in the order the raster refers to.
+  _xybinx = _xybiny;
+  std::sort( _xybinx.begin(), _xybinx.end(), ByX() );
+
+  std::uint32_t cells;
+  read( &cells  , sizeof( cells   ) );
+  read( &_xmin  , sizeof( _xmin   ) );
+  read( &_ymin  , sizeof( _ymin   ) );
+  read( &_xscale, sizeof( _xscale ) );
+  read( &_yscale, sizeof( _yscale ) );
+
+  _cells = cells;
+  _raster.resize( std::size_t( _cells ) * _cells );
+  if ( ! _raster.empty() )
+    read( _raster.data(), _raster.size() * sizeof( std::int32_t ) );
+}
+
+
+void Binning::write( const std::string& filename ) const throw( PdfException )
+{
+  std::ofstream file( filename.c_str(), std::ios::binary | std::ios::trunc );
+  if ( ! file )
+    throw PdfException( "Binning: cannot open file " + filename + " for writing." );
+
+  const std::uint64_t nPoints = _xybiny.size();
+  const std::uint32_t cells   = _cells;
+
+  file.write( fileMagic, sizeof( fileMagic ) );
+  file.write( reinterpret_cast< const char* >( &fileVersion   ), sizeof( fileVersion   ) );
+  file.write( reinterpret_cast< const char* >( &fileByteOrder ), sizeof( fileByteOrder ) );
+  file.write( reinterpret_cast< const char* >( &nPoints       ), sizeof( nPoints       ) );
+
+  for ( Data::const_iterator point = _xybiny.begin(); point != _xybiny.end(); ++point )
+  {
+    const std::uint32_t bin = point->second;
+    file.write( reinterpret_cast< const char* >( &point->first.first  ), sizeof( float ) );
+    file.write( reinterpret_cast< const char* >( &point->first.second ), sizeof( float ) );
+    file.write( reinterpret_cast< const char* >( &bin                 ), sizeof( bin   ) );
+  }
+
+  file.write( reinterpret_cast< const char* >( &cells   ), sizeof( cells   ) );
+  file.write( reinterpret_cast< const char* >( &_xmin   ), sizeof( _xmin   ) );
+  file.write( reinterpret_cast< const char* >( &_ymin   ), sizeof( _ymin   ) );
+  file.write( reinterpret_cast< const char* >( &_xscale ), sizeof( _xscale ) );
+  file.write( reinterpret_cast< const char* >( &_yscale ), sizeof( _yscale ) );
+  file.write( reinterpret_cast< const char* >( _raster.data() ), _raster.size() * sizeof( std::int32_t ) );
+
+  if ( ! file )
+    throw PdfException( "Binning: error writing file " + filename + "." );
+}
+
+
+// The region of every reference point is convex, so a cell lies within the region of
+//    a single point if its four corners do.
+void Binning::rasterize( const unsigned& cells )
+{
+  _cells = 0;
+  _raster.clear();
+
+  if ( ( cells == 0 ) || _xybinx.empty() )
+    return;
+
+  const float& xmin = _xybinx.front().first.first;
+  const float& xmax = _xybinx.back ().first.first;
+  const float& ymin = _xybiny.front().first.second;
+  const float& ymax = _xybiny.back ().first.second;
+
+  if ( ! ( xmax > xmin ) || ! ( ymax > ymin ) )
+    return;
+
+  const float xstep = ( xmax - xmin ) / cells;
+  const float ystep = ( ymax - ymin ) / cells;
+
+  std::vector< Data::const_iterator > corners;
+  // Start the search at every corner from the point of the previous one.
+  corners.reserve( std::size_t( cells + 1 ) * ( cells + 1 ) );
+  for ( unsigned row = 0; row <= cells; ++row )
+    for ( unsigned col = 0; col <= cells; ++col )
+    {
+      const float& x = xmin + xstep * col;
+      const float& y = ymin + ystep * row;
+
+      if ( col )
+        corners.push_back( nearest( x, y, distance( corners.back()->first, x, y ) ) );
+      else if ( row )
+        corners.push_back( nearest( x, y, distance( corners[ ( cells + 1 ) * ( row - 1 ) ]->first, x, y ) ) );
+      else
+        corners.push_back( nearest( x, y ) );
+    }
+
+  _raster.resize( std::size_t( cells ) * cells );
+  for ( unsigned row = 0; row < cells; ++row )
+    for ( unsigned col = 0; col < cells; ++col )
+    {
+      const Data::const_iterator& corner = corners[ ( cells + 1 ) * row + col ];
+
+      const bool& single = ( corners[ ( cells + 1 ) *   row       + col + 1 ] == corner ) &&
+                           ( corners[ ( cells + 1 ) * ( row + 1 ) + col     ] == corner ) &&
+                           ( corners[ ( cells + 1 ) * ( row + 1 ) + col + 1 ] == corner );
+
+      const std::int32_t& index = corner - _xybiny.begin();
+      _raster[ std::size_t( cells ) * row + col ] = single ? index : -1 - index;
+    }
+
+  _cells  = cells;
+  _xmin   = xmin;
+  _ymin   = ymin;
+  _xscale = 1.0 / xstep;
+  _yscale = 1.0 / ystep;
 }
 
 
@@ -38,63 +202,95 @@ int Binning::bin( const float& x, const float& y ) const
   if ( x < y )
     return - bin( y, x );
 
-  // Find the first elements with x-coordinate >= x. Can be more than 1 if
-  //    some points have the same x-coordinate and different y-coordinate.
-  Data::const_iterator pxmin = std::lower_bound( _xybinx.begin(), _xybinx.end(), x                 , PosX() );
+  // Look the cell up in the raster. Positions outside it start the exact search from
+  //    the point of the closest cell. The comparisons are false for nan.
+  const float& col = ( x - _xmin ) * _xscale;
+  const float& row = ( y - _ymin ) * _yscale;
+  if ( _cells && ( col == col ) && ( row == row ) )
+  {
+    const unsigned cellCol = unsigned( std::min( std::max( col, 0.0f ), _cells - 1.0f ) );
+    const unsigned cellRow = unsigned( std::min( std::max( row, 0.0f ), _cells - 1.0f ) );
+
+    const std::int32_t& cell   = _raster[ std::size_t( _cells ) * cellRow + cellCol ];
+    const bool&         inside = ( col >= 0.0 ) && ( col < _cells ) && ( row >= 0.0 ) && ( row < _cells );
+    if ( inside && ( cell >= 0 ) )
+      return _xybiny[ cell ].second;
+
+    const std::int32_t& index = ( cell >= 0 ) ? cell : -1 - cell;
+    return nearest( x, y, distance( _xybiny[ index ].first, x, y ) )->second;
+  }
+
+  return nearest( x, y )->second;
+}
+
+
+Binning::Data::const_iterator Binning::nearest( const float& x, const float& y ) const
+{
+  // Find the first elements with x-coordinate >= x, or the last ones. Can be more
+  //    than 1 if some points have the same x-coordinate and different y-coordinate.
+  Data::const_iterator pxmin = std::lower_bound( _xybinx.begin(), _xybinx.end(), x, PosX() );
+  if ( pxmin == _xybinx.end() )
+    pxmin = std::lower_bound( _xybinx.begin(), _xybinx.end(), ( pxmin - 1 )->first.first, PosX() );
   Data::const_iterator pxmax = std::upper_bound( _xybinx.begin(), _xybinx.end(), pxmin->first.first, PosX() );
 
-  // Out of these, find the first point with y-coordinate >= y.
+  // Out of these, find the first point with y-coordinate >= y, or the last one.
   Data::const_iterator px = std::lower_bound( pxmin, pxmax, y, PosY() );
+  if ( px == pxmax )
+    --px;
 
-  // This point is likely to be close to (x,y). Find an upper limit to the closest point distance.
-  float delta = distance( px->first, x, y );
-  if ( px != _xybinx.begin() )
+  // This point is likely to be close to (x,y). Find an upper limit to the closest point
+  //    distance, also from the points around it with the previous x-coordinate.
+  float bound = distance( px->first, x, y );
+  if ( pxmin != _xybinx.begin() )
   {
-    delta = std::min( delta, distance( ( px - 1 )->first, x, y ) );
+    pxmax = pxmin;
     pxmin = std::lower_bound( _xybinx.begin(), _xybinx.end(), ( pxmin - 1 )->first.first, PosX() );
-    pxmax = std::upper_bound( _xybinx.begin(), _xybinx.end(),   pxmin      ->first.first, PosX() );
-    px = std::lower_bound( pxmin, pxmax, y, PosY() );
-    delta = std::min( delta, distance( px->first, x, y ) );
-    if ( px != _xybinx.begin() )
-      delta = std::min( delta, distance( ( px - 1 )->first, x, y ) );
+    px    = std::lower_bound( pxmin, pxmax, y, PosY() );
+    if ( px == pxmax )
+      --px;
+    bound = std::min( bound, distance( px->first, x, y ) );
   }
 
+  return nearest( x, y, bound );
+}
+
+
+// The closest point of every row of points with equal y is one of the two around x,
+//    so the point at the given distance, or a closer one, is always found.
+Binning::Data::const_iterator Binning::nearest( const float& x, const float& y, const float& bound ) const
+{
+  Data::const_iterator point = _xybiny.begin();
+  float                delta = bound;
+  float                dist;
+
   // Find all points with y-coordinate not further away than delta from the given point.
   Data::const_iterator pymin = std::lower_bound( _xybiny.begin(), _xybiny.end(), y - delta, PosY() );
   Data::const_iterator pymax = std::upper_bound( _xybiny.begin(), _xybiny.end(), y + delta, PosY() );
 
   Data::const_iterator py;
-
-  float dist;
-  Data::const_iterator point;
+  Data::const_iterator pos;
   while( pymin != pymax )
   {
     // Build (pymin, py) as a range of points with equal y, sorted by x.
-    //    Find the two points closest to (x,y).
-    py    = std::upper_bound( pymin, pymax, pymin->first.second, PosY() );
-    pymin = std::lower_bound( pymin, py   , x                  , PosX() );
-    if ( std::fabs( ( pymin - 1 )->first.first - x ) <= delta )
-    {
-      dist = distance( ( pymin - 1 )->first, x, y );
-      if ( dist <= delta )
+    //    Check the two points closest to x.
+    py  = std::upper_bound( pymin, pymax, pymin->first.second, PosY() );
+    pos = std::lower_bound( pymin, py   , x                  , PosX() );
+    if ( ( pos != pymin ) && ( std::fabs( ( pos - 1 )->first.first - x ) <= delta ) )
+      if ( ( dist = distance( ( pos - 1 )->first, x, y ) ) <= delta )
       {
         delta = dist;
-        point = pymin - 1;
+        point = pos - 1;
       }
-    }
-    if ( std::fabs( pymin->first.first - x ) <= delta )
-    {
-      dist = distance( pymin->first, x, y );
-      if ( dist <= delta )
+    if ( ( pos != py ) && ( std::fabs( pos->first.first - x ) <= delta ) )
+      if ( ( dist = distance( pos->first, x, y ) ) <= delta )
       {
         delta = dist;
-        point = pymin;
+        point = pos;
       }
-    }
     pymin = py;
   }
 
-  return point->second;
+  return point;
 }
 
 
@@ -4,13 +4,10 @@
 #include <vector>
 #include <string>
 
-#ifdef MPI_ON
-#include <mpi.h>
-#endif
-
 #include <cfit/variable.hh>
 #include <cfit/dataset.hh>
 #include <cfit/pdfmodel.hh>
+#include <cfit/parallel.hh>
 #include <cfit/chi2.hh>
 
 
@@ -33,17 +30,9 @@ Chi2::Chi2( const Chi2& chi2 )
 {}
 
 
-double Chi2::operator()( const std::vector<double>& pars ) const throw( PdfException )
+// Terms of the chi^2 of the entries [ first, last ).
+double Chi2::terms( const std::size_t& first, const std::size_t& last ) const throw( PdfException )
 {
-  if ( pars.size() != _pdf->nPars() )
-    throw PdfException( "Number of parameters passed does not match number of required arguments." );
-
-  _pdf->setPars( pars );
-
-  // Before evaluating the pdf at all data points, cache anything common to
-  //    all points (usually compute the norm).
-  _pdf->cache();
-
   // Get the vector of variable names that the pdf depends on.
   std::vector< std::string > varNames = _pdf->varNames();
   typedef std::vector< std::string >::const_iterator vIter;
@@ -55,7 +44,7 @@ double Chi2::operator()( const std::vector<double>& pars ) const throw( PdfExcep
   double chi2 = 0.;
 
   // Sum of the terms of the chi^2.
-  for ( std::size_t n = 0; n < _data.size(); ++n )
+  for ( std::size_t n = first; n < last; ++n )
     {
       // Initialize the value of the variance for the current entry.
       //    It must be s_y^2 + Sum( s_x^2 ).
@@ -75,23 +64,41 @@ double Chi2::operator()( const std::vector<double>& pars ) const throw( PdfExcep
       double diff = _pdf->evaluate( vars ) - _data.value( _y.name(), n );
       variance += pow( _data.error( _y.name(), n ), 2 );
 
-      // Add the term to the chi^2.
-      chi2 += pow( diff, 2 ) / variance;
+      // Add the term to the chi^2, weighted by the weight of the entry.
+      chi2 += _data.weight( n ) * pow( diff, 2 ) / variance;
     }
 
-#ifdef MPI_ON
+  return chi2;
+}
+
+
+double Chi2::local( const std::vector<double>& pars ) const throw( PdfException )
+{
+  if ( pars.size() != _pdf->nPars() )
+    throw PdfException( "Number of parameters passed does not match number of required arguments." );
+
+  _pdf->setPars( pars );
+
+  // Before evaluating the pdf at all data points, cache anything common to
+  //    all points (usually compute the norm).
+  _pdf->cache();
+
+  return sum( [ this ]( const std::size_t& first, const std::size_t& last ) { return terms( first, last ); },
+              0, _data.size() );
+}
+
+
+double Chi2::operator()( const std::vector<double>& pars ) const throw( PdfException )
+{
+  double chi2 = local( pars );
+
   // If running with MPI, each process has only computed a piece of the chi2.
   //    Add all the pieces up and broadcast them to all the processes.
-  double result = 0.;
-  MPI::Comm& world = MPI::COMM_WORLD;
-  world.Barrier();
-  world.Allreduce( &chi2, &result, 1, MPI::DOUBLE, MPI::SUM );
+  Parallel::sum( chi2 );
 
-  return result;
-#else
+#ifndef MPI_ON
   std::cout << "chi2 = " << chi2 << std::endl;
+#endif
 
   return chi2;
-#endif
 }
-
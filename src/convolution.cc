@@ -0,0 +1,319 @@
+
+#include <cmath>
+#include <algorithm>
+
+#include <cfit/convolution.hh>
+
+
+Convolution::Convolution( const PdfExpr& left , const PdfExpr& right,
+                          const double&  lower, const double&  upper, const unsigned& size ) throw( PdfException )
+  : _left( left ), _right( right ), _lower( lower ), _upper( upper ), _size( size ), _buffer( 0.1 ),
+    _sampled( false ), _step( 0.0 )
+{
+  const std::vector< std::string >& leftVars  = _left .varNames();
+  const std::vector< std::string >& rightVars = _right.varNames();
+
+  if ( ( leftVars.size() != 1 ) || ( leftVars != rightVars ) )
+    throw PdfException( "Convolution: both pdfs must depend on the same single variable." );
+
+  if ( ! ( upper > lower ) || ( size < 2 ) )
+    throw PdfException( "Convolution: the grid needs an upper limit above the lower one and at least two points." );
+
+  _var = leftVars[ 0 ];
+  push( Variable( _var ) );
+
+  // Use the analytical area of each operand if it provides it.
+  _leftArea  = true;
+  _rightArea = true;
+  try { _left .area( _var, lower, upper ); } catch ( PdfException& ) { _leftArea  = false; }
+  try { _right.area( _var, lower, upper ); } catch ( PdfException& ) { _rightArea = false; }
+
+  // Parameters shared by both operands are pushed only once.
+  typedef std::map< std::string, Parameter >::const_iterator pIter;
+  for ( pIter par = _left.getPars().begin(); par != _left.getPars().end(); ++par )
+    push( par->second );
+  for ( pIter par = _right.getPars().begin(); par != _right.getPars().end(); ++par )
+    if ( ! _parMap.count( par->first ) )
+      push( par->second );
+
+  cache();
+}
+
+
+Convolution* Convolution::copy() const
+{
+  return new Convolution( *this );
+}
+
+
+void Convolution::setLimits( const double& lower, const double& upper ) throw( PdfException )
+{
+  if ( ! ( upper > lower ) )
+    throw PdfException( "Convolution::setLimits: the upper limit must be above the lower one." );
+
+  _lower   = lower;
+  _upper   = upper;
+  _sampled = false;
+
+  invalidate();
+  cache();
+}
+
+
+void Convolution::setGridSize( const unsigned& size ) throw( PdfException )
+{
+  if ( size < 2 )
+    throw PdfException( "Convolution::setGridSize: the grid needs at least two points." );
+
+  _size    = size;
+  _sampled = false;
+
+  invalidate();
+  cache();
+}
+
+
+void Convolution::setBuffer( const double& buffer ) throw( PdfException )
+{
+  if ( buffer < 0.0 )
+    throw PdfException( "Convolution::setBuffer: the buffer cannot be negative." );
+
+  _buffer  = buffer;
+  _sampled = false;
+
+  invalidate();
+  cache();
+}
+
+
+void Convolution::setParExpr()
+{
+  _left .setPars( _parMap );
+  _right.setPars( _parMap );
+}
+
+
+const std::vector< double > Convolution::parValues( const PdfExpr& pdf ) const
+{
+  std::vector< double > values;
+
+  typedef std::map< std::string, Parameter >::const_iterator pIter;
+  for ( pIter par = pdf.getPars().begin(); par != pdf.getPars().end(); ++par )
+    values.push_back( par->second.value() );
+
+  return values;
+}
+
+
+// Averages over the cells centered at the points if the pdf has an analytical area, and
+//    values at the points otherwise.
+void Convolution::sample( PdfExpr& pdf, const bool& useArea, const double& x0, const double& step,
+                          const int& first, const std::size_t& n, std::vector< double >& samples )
+{
+  pdf.cache();
+
+  const std::string  var  = pdf.varNames()[ 0 ];
+  const double&      half = std::fabs( step ) / 2.0;
+
+  std::vector< double > vars( 1 );
+
+  samples.resize( n );
+  for ( std::size_t point = 0; point < n; ++point )
+  {
+    vars[ 0 ] = x0 + ( first + int( point ) ) * step;
+
+    if ( useArea )
+      samples[ point ] = pdf.area( var, vars[ 0 ] - half, vars[ 0 ] + half ) / ( 2.0 * half );
+    else
+      samples[ point ] = pdf.evaluate( vars );
+  }
+}
+
+
+// Iterative radix-2 transform, with the inverse one not divided by the size.
+void Convolution::fft( std::vector< std::complex< double > >& data, const bool& inverse ) const
+{
+  const std::size_t& size = data.size();
+
+  // Bit reversal permutation.
+  for ( std::size_t i = 1, j = 0; i < size; ++i )
+  {
+    std::size_t bit = size >> 1;
+    for ( ; j & bit; bit >>= 1 )
+      j ^= bit;
+    j ^= bit;
+
+    if ( i < j )
+      std::swap( data[ i ], data[ j ] );
+  }
+
+  for ( std::size_t length = 2; length <= size; length <<= 1 )
+  {
+    const std::size_t& stride = size / length;
+    for ( std::size_t start = 0; start < size; start += length )
+      for ( std::size_t k = 0; k < length / 2; ++k )
+      {
+        const std::complex< double >& root = inverse ? std::conj( _roots[ k * stride ] ) : _roots[ k * stride ];
+
+        const std::complex< double >  even = data[ start + k              ];
+        const std::complex< double >  odd  = data[ start + k + length / 2 ] * root;
+
+        data[ start + k              ] = even + odd;
+        data[ start + k + length / 2 ] = even - odd;
+      }
+  }
+}
+
+
+void Convolution::cache()
+{
+  invalidate();
+
+  const std::vector< double >& leftPars  = parValues( _left  );
+  const std::vector< double >& rightPars = parValues( _right );
+
+  const bool& leftChanged  = ! _sampled || ( leftPars  != _leftPars  );
+  const bool& rightChanged = ! _sampled || ( rightPars != _rightPars );
+
+  if ( ! leftChanged && ! rightChanged )
+    return;
+
+  // The left operand is sampled at the points of the grid and of the buffers, and the
+  //    right one at all the differences between them, with positive differences first
+  //    and negative ones at the end, as the transform treats the sequence as periodic.
+  //    With a size of at least twice the number of points, the periodic convolution
+  //    equals the linear one.
+  _step = ( _upper - _lower ) / ( _size - 1 );
+
+  const int&         nBuffer = int( std::ceil( _buffer * ( _size - 1 ) ) );
+  const std::size_t& nPoints = _size + 2 * nBuffer;
+
+  std::size_t nFFT = 1;
+  while ( nFFT < 2 * nPoints )
+    nFFT <<= 1;
+
+  if ( _roots.size() != nFFT / 2 )
+  {
+    _roots.resize( nFFT / 2 );
+    for ( std::size_t k = 0; k < nFFT / 2; ++k )
+      _roots[ k ] = std::polar( 1.0, - 2.0 * M_PI * k / nFFT );
+  }
+
+  if ( leftChanged )
+    sample( _left, _leftArea, _lower, _step, - nBuffer, nPoints, _leftSamples );
+
+  if ( rightChanged )
+  {
+    std::vector< double > positive;
+    std::vector< double > negative;
+    sample( _right, _rightArea, 0.0,   _step, 0, nFFT / 2    , positive );
+    sample( _right, _rightArea, 0.0, - _step, 1, nFFT / 2 - 1, negative );
+
+    _rightSamples.assign( nFFT, 0.0 );
+    std::copy( positive.begin(), positive.end(), _rightSamples.begin()  );
+    std::copy( negative.begin(), negative.end(), _rightSamples.rbegin() );
+  }
+
+  _leftPars  = leftPars;
+  _rightPars = rightPars;
+  _sampled   = true;
+
+  // Both real sequences are transformed at once, as the real and imaginary parts of a
+  //    complex one, and separated using the symmetry of the transform of a real one.
+  std::vector< std::complex< double > > data( nFFT );
+  for ( std::size_t point = 0; point < nFFT; ++point )
+    data[ point ] = std::complex< double >( ( point < nPoints ) ? _leftSamples[ point ] : 0.0, _rightSamples[ point ] );
+
+  fft( data, false );
+
+  std::vector< std::complex< double > > product( nFFT );
+  for ( std::size_t k = 0; k < nFFT; ++k )
+  {
+    const std::complex< double >& mirror = std::conj( data[ ( nFFT - k ) % nFFT ] );
+
+    const std::complex< double >& leftFT  = ( data[ k ] + mirror ) / 2.0;
+    const std::complex< double >& rightFT = ( data[ k ] - mirror ) / std::complex< double >( 0.0, 2.0 );
+
+    product[ k ] = leftFT * rightFT;
+  }
+
+  fft( product, true );
+
+  // Keep the points between the limits, with the rounding errors of the transform that
+  //    may be negative removed, and normalize them.
+  _grid.resize( _size );
+  for ( unsigned point = 0; point < _size; ++point )
+    _grid[ point ] = std::max( std::real( product[ point + nBuffer ] ) * _step / nFFT, 0.0 );
+
+  _cumulative.resize( _size );
+  _cumulative[ 0 ] = 0.0;
+  for ( unsigned point = 1; point < _size; ++point )
+    _cumulative[ point ] = _cumulative[ point - 1 ] + ( _grid[ point - 1 ] + _grid[ point ] ) * _step / 2.0;
+
+  const double& norm = _cumulative.back();
+  if ( norm > 0.0 )
+  {
+    for ( unsigned point = 0; point < _size; ++point )
+    {
+      _grid      [ point ] /= norm;
+      _cumulative[ point ] /= norm;
+    }
+  }
+}
+
+
+const double Convolution::evaluate( const double& x ) const throw( PdfException )
+{
+  if ( ( x < _lower ) || ( x > _upper ) )
+    return 0.0;
+
+  const double&   position = ( x - _lower ) / _step;
+  const unsigned  point    = std::min( unsigned( position ), _size - 2 );
+  const double&   frac     = position - point;
+
+  return ( 1.0 - frac ) * _grid[ point ] + frac * _grid[ point + 1 ];
+}
+
+
+const double Convolution::evaluate( const std::vector< double >& vars ) const throw( PdfException )
+{
+  return evaluate( vars[ 0 ] );
+}
+
+
+// Exact integral of the linear interpolation.
+const double Convolution::area( const double& min, const double& max ) const throw( PdfException )
+{
+  const double& xmin = std::max( min, _lower );
+  const double& xmax = std::min( max, _upper );
+
+  if ( ! ( xmax > xmin ) )
+    return 0.0;
+
+  // Integral from the lower limit.
+  auto integral = [ this ]( const double& x )
+  {
+    const double&   position = ( x - _lower ) / _step;
+    const unsigned  point    = std::min( unsigned( position ), _size - 2 );
+    const double&   frac     = position - point;
+
+    return _cumulative[ point ] + _step * frac * ( _grid[ point ] + frac * ( _grid[ point + 1 ] - _grid[ point ] ) / 2.0 );
+  };
+
+  return integral( xmax ) - integral( xmin );
+}
+
+
+const std::map< std::string, double > Convolution::generate( RandomStream& stream ) const throw( PdfException )
+{
+  std::map< std::string, double > values;
+
+  double x = 0.0;
+  do
+    x = _left.generateFull( stream ).at( _var ) + _right.generateFull( stream ).at( _var );
+  while ( ( x < _lower ) || ( x > _upper ) );
+
+  values[ _var ] = x;
+
+  return values;
+}
@@ -0,0 +1,284 @@
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include <cfit/amplitude.hh>
+#include <cfit/resonance.hh>
+#include <cfit/dalitzsampler.hh>
+
+
+// Number of points of every scan, and factor applied to the largest ratio found.
+static const unsigned scanPoints = 20000;
+static const double   safety     = 1.2;
+
+// Smallest fraction of the flat component, such that the proposal covers the whole
+//    Dalitz plot wherever the resonances are.
+static const double   minFlat    = 0.1;
+
+
+DalitzSampler::DalitzSampler( const PhaseSpace& ps )
+  : _ps( ps ), _maxPdf( 0.0 ), _ready( false ), _fractions( 1, 1.0 ), _envelope( 0.0 )
+{}
+
+
+DalitzSampler::DalitzSampler( const DalitzSampler& sampler )
+  : _ps( sampler._ps ), _channels( sampler._channels ), _maxPdf( sampler._maxPdf ), _ready( false ),
+    _fractions( 1, 1.0 ), _envelope( 0.0 )
+{
+  std::lock_guard< std::mutex > lock( sampler._mutex );
+  _ready     = sampler._ready;
+  _fractions = sampler._fractions;
+  _envelope  = sampler._envelope;
+}
+
+
+DalitzSampler& DalitzSampler::operator=( const DalitzSampler& sampler )
+{
+  if ( this == &sampler )
+    return *this;
+
+  std::lock( _mutex, sampler._mutex );
+  std::lock_guard< std::mutex > lockThis ( _mutex        , std::adopt_lock );
+  std::lock_guard< std::mutex > lockOther( sampler._mutex, std::adopt_lock );
+
+  _ps        = sampler._ps;
+  _channels  = sampler._channels;
+  _maxPdf    = sampler._maxPdf;
+  _ready     = sampler._ready;
+  _fractions = sampler._fractions;
+  _envelope  = sampler._envelope;
+
+  return *this;
+}
+
+
+void DalitzSampler::update( const Amplitude& amp )
+{
+  std::lock_guard< std::mutex > lock( _mutex );
+
+  _channels.clear();
+
+  const std::vector< Resonance* >& resos = amp.resonances();
+  for ( std::vector< Resonance* >::const_iterator reso = resos.begin(); reso != resos.end(); ++reso )
+  {
+    const unsigned& resoA = ( *reso )->resoA();
+    const unsigned& resoB = ( *reso )->resoB();
+
+    // Only resonances with a positive width in a valid pair can be sampled.
+    if ( ( resoA == resoB ) || ( resoA < 1 ) || ( resoA > 3 ) || ( resoB < 1 ) || ( resoB > 3 ) )
+      continue;
+    if ( ! ( ( *reso )->width() > 0.0 ) )
+      continue;
+
+    Channel channel;
+    channel.pair    = resoA + resoB - 3;
+    channel.mSq     = ( *reso )->mSq();
+    channel.mGamma  = ( *reso )->mGamma();
+    channel.atanMin = std::atan( ( _ps.mSqMin( channel.pair ) - channel.mSq ) / channel.mGamma );
+    channel.atanMax = std::atan( ( _ps.mSqMax( channel.pair ) - channel.mSq ) / channel.mGamma );
+
+    _channels.push_back( channel );
+  }
+
+  _ready = false;
+}
+
+
+void DalitzSampler::setMaxPdf( const double& max )
+{
+  std::lock_guard< std::mutex > lock( _mutex );
+
+  _maxPdf = std::max( max, 0.0 );
+  _ready  = false;
+}
+
+
+const double DalitzSampler::rectangle() const
+{
+  return ( _ps.mSq12max() - _ps.mSq12min() ) * ( _ps.mSq13max() - _ps.mSq13min() );
+}
+
+
+// The first particle of the pair recoils against the second one in the rest frame of
+//    the pair, and the third particle recoils against the pair in the rest frame of
+//    the mother.
+void DalitzSampler::limits( const unsigned& pair, const double& mSqPair, double& min, double& max ) const
+{
+  static const unsigned first [] = { 1, 1, 2 };
+  static const unsigned second[] = { 2, 3, 3 };
+  static const unsigned third [] = { 3, 2, 1 };
+
+  const double& mPair = std::sqrt( mSqPair );
+
+  const double& eA = ( mSqPair - _ps.mSq( second[ pair ] ) + _ps.mSq( first[ pair ] ) ) / ( 2.0 * mPair );
+  const double& eC = ( _ps.mSqMother() - mSqPair - _ps.mSq( third[ pair ] ) )          / ( 2.0 * mPair );
+
+  const double& pA = std::sqrt( std::max( eA * eA - _ps.mSq( first[ pair ] ), 0.0 ) );
+  const double& pC = std::sqrt( std::max( eC * eC - _ps.mSq( third[ pair ] ), 0.0 ) );
+
+  min = std::pow( eA + eC, 2 ) - std::pow( pA + pC, 2 );
+  max = std::pow( eA + eC, 2 ) - std::pow( pA - pC, 2 );
+}
+
+
+const double DalitzSampler::propose( RandomStream& stream, double& mSq12, double& mSq13 ) const
+{
+  // Choose a component.
+  double      choice    = stream.flat();
+  std::size_t component = 0;
+  while ( ( component + 1 < _fractions.size() ) && ( choice >= _fractions[ component ] ) )
+    choice -= _fractions[ component++ ];
+
+  if ( component == 0 )
+  {
+    mSq12 = stream.flat( _ps.mSq12min(), _ps.mSq12max() );
+    mSq13 = stream.flat( _ps.mSq13min(), _ps.mSq13max() );
+    return density( mSq12, mSq13 );
+  }
+
+  // Breit-Wigner in the squared mass of the pair, and flat in the other squared mass.
+  const Channel& channel = _channels[ component - 1 ];
+
+  const double& mSqPair = channel.mSq + channel.mGamma * std::tan( stream.flat( channel.atanMin, channel.atanMax ) );
+
+  double min;
+  double max;
+  limits( channel.pair, mSqPair, min, max );
+  const double& mSqOther = stream.flat( min, max );
+
+  if ( channel.pair == 0 )
+  {
+    mSq12 = mSqPair;
+    mSq13 = mSqOther;
+  }
+  else if ( channel.pair == 1 )
+  {
+    mSq12 = mSqOther;
+    mSq13 = mSqPair;
+  }
+  else
+  {
+    mSq12 = mSqOther;
+    mSq13 = _ps.mSqSum() - mSqPair - mSqOther;
+  }
+
+  return density( mSq12, mSq13 );
+}
+
+
+// The change from ( mSqPair, mSqOther ) to ( mSq12, mSq13 ) has unit Jacobian for all
+//    the pairs, so the densities of the components can be added directly.
+const double DalitzSampler::component( const std::size_t& index, const double& mSq12, const double& mSq13 ) const
+{
+  if ( index == 0 )
+    return 1.0 / rectangle();
+
+  if ( ! _ps.contains( mSq12, mSq13 ) )
+    return 0.0;
+
+  const Channel& channel = _channels[ index - 1 ];
+
+  const double& mSqPair = ( channel.pair == 0 ) ? mSq12 :
+                          ( channel.pair == 1 ) ? mSq13 : _ps.mSqSum() - mSq12 - mSq13;
+
+  double min;
+  double max;
+  limits( channel.pair, mSqPair, min, max );
+
+  return channel.mGamma / ( channel.atanMax - channel.atanMin ) /
+         ( std::pow( mSqPair - channel.mSq, 2 ) + std::pow( channel.mGamma, 2 ) ) / ( max - min );
+}
+
+
+const double DalitzSampler::density( const double& mSq12, const double& mSq13 ) const
+{
+  double value = 0.0;
+  for ( std::size_t index = 0; index < _fractions.size(); ++index )
+    value += _fractions[ index ] * component( index, mSq12, mSq13 );
+
+  return value;
+}
+
+
+void DalitzSampler::scan( const target_type& target ) const
+{
+  // Flat proposal with the bound given by hand.
+  if ( _maxPdf > 0.0 )
+  {
+    _fractions.assign( 1, 1.0 );
+    _envelope = _maxPdf * rectangle();
+    return;
+  }
+
+  RandomStream stream( 0, 0 );
+
+  double mSq12;
+  double mSq13;
+  double ratio;
+
+  // Start from equal fractions, and move every one of them to the share of the target
+  //    its component accounts for.
+  const std::size_t& nComponents = _channels.size() + 1;
+  _fractions.assign( nComponents, 1.0 / nComponents );
+  if ( nComponents > 1 )
+  {
+    std::vector< double > shares( nComponents, 0.0 );
+    for ( unsigned point = 0; point < scanPoints; ++point )
+    {
+      const double& dens = propose( stream, mSq12, mSq13 );
+      if ( ! _ps.contains( mSq12, mSq13 ) )
+        continue;
+
+      ratio = target( stream, mSq12, mSq13 ) / dens;
+
+      // Every component takes its contribution to the density of the point.
+      for ( std::size_t index = 0; index < nComponents; ++index )
+        shares[ index ] += ratio * _fractions[ index ] * component( index, mSq12, mSq13 ) / dens;
+    }
+
+    const double& total = std::accumulate( shares.begin(), shares.end(), 0.0 );
+    if ( total > shares[ 0 ] )
+    {
+      const double  flat = std::max( shares[ 0 ] / total, minFlat );
+      for ( std::size_t component = 1; component < nComponents; ++component )
+        _fractions[ component ] = ( 1.0 - flat ) * shares[ component ] / ( total - shares[ 0 ] );
+      _fractions[ 0 ] = flat;
+    }
+  }
+
+  // Largest ratio of the target to the proposal.
+  double max = 0.0;
+  for ( unsigned point = 0; point < scanPoints; ++point )
+  {
+    const double& dens = propose( stream, mSq12, mSq13 );
+    if ( _ps.contains( mSq12, mSq13 ) )
+      max = std::max( max, target( stream, mSq12, mSq13 ) / dens );
+  }
+
+  _envelope = safety * max;
+}
+
+
+const double DalitzSampler::envelope( const target_type& target ) const
+{
+  std::lock_guard< std::mutex > lock( _mutex );
+
+  if ( ! _ready )
+  {
+    scan( target );
+    _ready = true;
+  }
+
+  return _envelope;
+}
+
+
+const double DalitzSampler::raise( const double& ratio ) const
+{
+  std::lock_guard< std::mutex > lock( _mutex );
+
+  _envelope = std::max( _envelope, safety * ratio );
+
+  return _envelope;
+}
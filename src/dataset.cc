@@ -3,50 +3,153 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
 
 #include <cfit/functors.hh>
+#include <cfit/mappedfile.hh>
 #include <cfit/dataset.hh>
 
 #ifdef MPI_ON
 #include <mpi.h>
 #endif
 
+
+// Constants of the binary format of datasets.
+static const char          fileMagic[ 8 ] = { 'C', 'F', 'I', 'T', 'D', 'A', 'T', 'A' };
+static const std::uint32_t fileVersion    = 1;
+static const std::uint32_t fileByteOrder  = 0x01020304;
+static const std::size_t   fileAlignment  = 64;
+
+
 // Add event from field, value and error.
 void Dataset::push( const std::string& field, const double& value, const double& error )
 {
-  _data[ field ].push_back( std::make_pair( value, error ) );
+  detach();
+
+  std::vector< std::pair< double, double > >& column = ( *_data )[ field ];
+  column.push_back( std::make_pair( value, error ) );
+
+  // Entries added field by field have unit weight.
+  if ( ! _weights->empty() && ( column.size() > _weights->size() ) )
+    _weights->push_back( 1.0 );
 }
 
 
 // Add event from map of fields and values.
 void Dataset::push( const std::map< std::string, double >& event )
 {
+  detach();
+
   typedef std::map< std::string, double >::const_iterator fIter;
   for ( fIter entry = event.begin(); entry != event.end(); ++entry )
-    _data[ entry->first ].push_back( std::make_pair( entry->second, 0.0 ) );
+    ( *_data )[ entry->first ].push_back( std::make_pair( entry->second, 0.0 ) );
+  // Entries added without a weight have unit weight.
+  if ( ! _weights->empty() )
+    _weights->push_back( 1.0 );
 }
 
 
 // Add event from map of fields and pair of values and errors.
 void Dataset::push( const datum_type& event )
 {
+  detach();
+
   for ( datum_type::const_iterator entry = event.begin(); entry != event.end(); ++entry )
-    _data[ entry->first ].push_back( entry->second );
+    ( *_data )[ entry->first ].push_back( entry->second );
+  // Entries added without a weight have unit weight.
+  if ( ! _weights->empty() )
+    _weights->push_back( 1.0 );
+}
+
+
+// Add a column of values to a field.
+void Dataset::push( const std::string& field, const std::vector< double >& values )
+{
+  detach();
+
+  std::vector< std::pair< double, double > >& column = ( *_data )[ field ];
+  column.reserve( column.size() + values.size() );
+  for ( std::vector< double >::const_iterator value = values.begin(); value != values.end(); ++value )
+    column.push_back( std::make_pair( *value, 0.0 ) );
+
+  // Entries added field by field have unit weight.
+  if ( ! _weights->empty() && ( column.size() > _weights->size() ) )
+    _weights->resize( column.size(), 1.0 );
+}
+
+
+// Add weighted event from map of fields and values.
+void Dataset::push( const std::map< std::string, double >& event, const double& weight )
+{
+  push( event );
+  pushWeight( weight );
+}
+
+
+// Add weighted event from map of fields and pair of values and errors.
+void Dataset::push( const datum_type& event, const double& weight )
+{
+  push( event );
+  pushWeight( weight );
+}
+
+
+// Store the weight of the last entry. The weights are only stored once a weight
+//    different from one has been pushed, and then the entry already has unit weight.
+void Dataset::pushWeight( const double& weight )
+{
+  if ( ! _weights->empty() )
+  {
+    _weights->back() = weight;
+    return;
+  }
+
+  if ( weight == 1.0 )
+    return;
+
+  _weights->assign( size() - 1, 1.0 );
+  _weights->push_back( weight );
+}
+
+
+void Dataset::setWeights( const std::vector< double >& weights ) throw( DataException )
+{
+  detach();
+
+  if ( weights.size() != size() )
+    throw DataException( "Dataset: the number of weights does not match the number of entries." );
+
+  *_weights = weights;
 }
 
 
 // Getters.
 bool Dataset::empty() const
 {
-  return _data.empty();
+  if ( _file )
+    return _columns.empty();
+
+  return _data->empty();
 }
 
 std::size_t Dataset::size() const
 {
-  if ( _data.empty() )
+  if ( _index )
+    return _index->size();
+
+  if ( _file )
+    return _mappedSize;
+
+  if ( _data->empty() )
     return 0;
 
-  return _data.begin()->second.size();
+  return _data->begin()->second.size();
 }
 
 
@@ -54,9 +157,19 @@ const Dataset::datum_type Dataset::entry( const std::size_t& index ) const
 {
   Dataset::datum_type ret;
 
-  for ( std::map< std::string, std::vector< std::pair< double, double > > >::const_iterator b = _data.begin();
-        b != _data.end(); ++b )
-    ret.emplace( b->first, b->second.at( index ) );
+  const std::size_t& r = row( index );
+
+  if ( _file )
+  {
+    typedef std::map< std::string, std::pair< const double*, const double* > >::const_iterator cIter;
+    for ( cIter col = _columns.begin(); col != _columns.end(); ++col )
+      ret.emplace( col->first, std::make_pair( col->second.first[ r ], col->second.second ? col->second.second[ r ] : 0.0 ) );
+
+    return ret;
+  }
+
+  for ( data_type::const_iterator b = _data->begin(); b != _data->end(); ++b )
+    ret.emplace( b->first, b->second.at( r ) );
 
   return ret;
 }
@@ -65,19 +178,36 @@ const Dataset::datum_type Dataset::entry( const std::size_t& index ) const
 
 double Dataset::value( const std::string& field, int entry ) const throw( DataException )
 {
-  if ( ! _data.count( field ) )
+  if ( _file )
+  {
+    if ( ! _columns.count( field ) )
+      throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
+
+    return _columns.find( field )->second.first[ row( entry ) ];
+  }
+
+  if ( ! _data->count( field ) )
     throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
 
-  return _data.find( field )->second[ entry ].first;
+  return _data->find( field )->second[ row( entry ) ].first;
 }
 
 
 double Dataset::error( const std::string& field, int entry ) const throw( DataException )
 {
-  if ( ! _data.count( field ) )
+  if ( _file )
+  {
+    if ( ! _columns.count( field ) )
+      throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
+
+    const double* errors = _columns.find( field )->second.second;
+    return errors ? errors[ row( entry ) ] : 0.0;
+  }
+
+  if ( ! _data->count( field ) )
     throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
 
-  return _data.find( field )->second[ entry ].second;
+  return _data->find( field )->second[ row( entry ) ].second;
 }
 
 
@@ -85,12 +215,36 @@ std::vector< double > Dataset::values( const std::string& field ) const throw( D
 {
   std::vector< double > vals;
 
-  if ( ! _data.count( field ) )
+  if ( _file )
+  {
+    if ( ! _columns.count( field ) )
+      throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
+
+    const double* column = _columns.find( field )->second.first;
+    if ( ! _index )
+      return std::vector< double >( column, column + _mappedSize );
+
+    vals.reserve( _index->size() );
+    for ( std::vector< std::size_t >::const_iterator r = _index->begin(); r != _index->end(); ++r )
+      vals.push_back( column[ *r ] );
+
+    return vals;
+  }
+
+  if ( ! _data->count( field ) )
     throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
 
-  const std::vector< std::pair< double, double > >& entries = _data.find( field )->second;
+  const std::vector< std::pair< double, double > >& entries = _data->find( field )->second;
 
-  std::transform( entries.begin(), entries.end(), std::back_inserter( vals ), Select1st() );
+  if ( ! _index )
+  {
+    std::transform( entries.begin(), entries.end(), std::back_inserter( vals ), Select1st() );
+    return vals;
+  }
+
+  vals.reserve( _index->size() );
+  for ( std::vector< std::size_t >::const_iterator r = _index->begin(); r != _index->end(); ++r )
+    vals.push_back( entries[ *r ].first );
 
   return vals;
 }
@@ -100,12 +254,39 @@ std::vector< double > Dataset::errors( const std::string& field ) const throw( D
 {
   std::vector< double > errs;
 
-  if ( ! _data.count( field ) )
+  if ( _file )
+  {
+    if ( ! _columns.count( field ) )
+      throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
+
+    const double* column = _columns.find( field )->second.second;
+    if ( ! column )
+      return std::vector< double >( size(), 0.0 );
+
+    if ( ! _index )
+      return std::vector< double >( column, column + _mappedSize );
+
+    errs.reserve( _index->size() );
+    for ( std::vector< std::size_t >::const_iterator r = _index->begin(); r != _index->end(); ++r )
+      errs.push_back( column[ *r ] );
+
+    return errs;
+  }
+
+  if ( ! _data->count( field ) )
     throw DataException( "Dataset: requested variable " + field + " does not exist in dataset" );
 
-  const std::vector< std::pair< double, double > >& entries = _data.find( field )->second;
+  const std::vector< std::pair< double, double > >& entries = _data->find( field )->second;
 
-  std::transform( entries.begin(), entries.end(), std::back_inserter( errs ), Select2nd() );
+  if ( ! _index )
+  {
+    std::transform( entries.begin(), entries.end(), std::back_inserter( errs ), Select2nd() );
+    return errs;
+  }
+
+  errs.reserve( _index->size() );
+  for ( std::vector< std::size_t >::const_iterator r = _index->begin(); r != _index->end(); ++r )
+    errs.push_back( entries[ *r ].second );
 
   return errs;
 }
@@ -115,38 +296,708 @@ std::vector< std::string > Dataset::fields() const
 {
   std::vector< std::string > fieldVect;
 
-  std::transform( _data.begin(), _data.end(), std::back_inserter( fieldVect ), Select1st() );
+  if ( _file )
+  {
+    std::transform( _columns.begin(), _columns.end(), std::back_inserter( fieldVect ), Select1st() );
+    return fieldVect;
+  }
+
+  std::transform( _data->begin(), _data->end(), std::back_inserter( fieldVect ), Select1st() );
 
   return fieldVect;
 }
 
 
 
-const Dataset Dataset::slice( const Region& region ) const
+std::vector< double > Dataset::weights() const
+{
+  if ( ! weighted() )
+    return std::vector< double >( size(), 1.0 );
+
+  const double* wgts = _mappedWeights ? _mappedWeights : _weights->data();
+  if ( ! _index )
+    return std::vector< double >( wgts, wgts + size() );
+
+  std::vector< double > ret;
+  ret.reserve( _index->size() );
+  for ( std::vector< std::size_t >::const_iterator r = _index->begin(); r != _index->end(); ++r )
+    ret.push_back( wgts[ *r ] );
+
+  return ret;
+}
+
+
+double Dataset::sumWeights() const
+{
+  if ( ! weighted() )
+    return size();
+
+  if ( ! _index )
+  {
+    const double* wgts = _mappedWeights ? _mappedWeights : _weights->data();
+    return std::accumulate( wgts, wgts + size(), 0.0 );
+  }
+
+  const std::vector< double >& wgts = weights();
+  return std::accumulate( wgts.begin(), wgts.end(), 0.0 );
+}
+
+
+double Dataset::sumWeights2() const
+{
+  if ( ! weighted() )
+    return size();
+
+  if ( ! _index )
+  {
+    const double* wgts = _mappedWeights ? _mappedWeights : _weights->data();
+    return std::inner_product( wgts, wgts + size(), wgts, 0.0 );
+  }
+
+  const std::vector< double >& wgts = weights();
+  return std::inner_product( wgts.begin(), wgts.end(), wgts.begin(), 0.0 );
+}
+
+
+
+void Dataset::write( const std::string& filename ) const throw( DataException )
+{
+  std::ofstream file( filename.c_str(), std::ios::binary | std::ios::trunc );
+  if ( ! file )
+    throw DataException( "Dataset: cannot open file " + filename + " for writing." );
+
+  const std::vector< std::string >& names = fields();
+
+  const std::uint64_t nEntries = size();
+  const std::uint32_t nFields  = names.size();
+  const std::uint32_t flags    = weighted() ? 1 : 0;
+
+  // Error columns are only written for fields with some non-zero error.
+  std::vector< std::vector< double > > errorColumns;
+  for ( std::vector< std::string >::const_iterator name = names.begin(); name != names.end(); ++name )
+  {
+    errorColumns.push_back( errors( *name ) );
+    const std::vector< double >& errs = errorColumns.back();
+    if ( std::all_of( errs.begin(), errs.end(), []( const double& err ){ return err == 0.0; } ) )
+      errorColumns.back().clear();
+  }
+
+  // Header.
+  file.write( fileMagic, sizeof( fileMagic ) );
+  file.write( reinterpret_cast< const char* >( &fileVersion   ), sizeof( fileVersion   ) );
+  file.write( reinterpret_cast< const char* >( &fileByteOrder ), sizeof( fileByteOrder ) );
+  file.write( reinterpret_cast< const char* >( &nEntries      ), sizeof( nEntries      ) );
+  file.write( reinterpret_cast< const char* >( &nFields       ), sizeof( nFields       ) );
+  file.write( reinterpret_cast< const char* >( &flags         ), sizeof( flags         ) );
+
+  for ( std::uint32_t field = 0; field < nFields; ++field )
+  {
+    const std::uint32_t length    = names[ field ].size();
+    const std::uint32_t hasErrors = ! errorColumns[ field ].empty();
+    file.write( reinterpret_cast< const char* >( &length ), sizeof( length ) );
+    file.write( names[ field ].c_str(), length );
+    file.write( reinterpret_cast< const char* >( &hasErrors ), sizeof( hasErrors ) );
+  }
+
+  // Align the columns.
+  const std::size_t& padding = ( fileAlignment - file.tellp() % fileAlignment ) % fileAlignment;
+  file.write( std::string( padding, '\0' ).c_str(), padding );
+
+  // Columns.
+  for ( std::uint32_t field = 0; field < nFields; ++field )
+  {
+    const std::vector< double >& vals = values( names[ field ] );
+    file.write( reinterpret_cast< const char* >( vals.data() ), nEntries * sizeof( double ) );
+
+    const std::vector< double >& errs = errorColumns[ field ];
+    if ( ! errs.empty() )
+      file.write( reinterpret_cast< const char* >( errs.data() ), nEntries * sizeof( double ) );
+  }
+
+  if ( flags )
+  {
+    const std::vector< double >& wgts = weights();
+    file.write( reinterpret_cast< const char* >( wgts.data() ), nEntries * sizeof( double ) );
+  }
+
+  if ( ! file )
+    throw DataException( "Dataset: error writing file " + filename + "." );
+}
+
+
+void Dataset::open( const std::string& filename ) throw( DataException )
+{
+  std::shared_ptr< const MappedFile > mapped( new MappedFile( filename ) );
+
+  const char*        data   = mapped->data();
+  const std::size_t& length = mapped->length();
+  std::size_t        pos    = 0;
+
+  // Read a value of the header, checking that it is within the file.
+  auto read = [ & ]( void* dest, const std::size_t& bytes )
+  {
+    if ( pos + bytes > length )
+      throw DataException( "Dataset: file " + filename + " is truncated." );
+    std::memcpy( dest, data + pos, bytes );
+    pos += bytes;
+  };
+
+  char          magic[ 8 ];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint64_t nEntries;
+  std::uint32_t nFields;
+  std::uint32_t flags;
+
+  read( magic, sizeof( magic ) );
+  if ( std::memcmp( magic, fileMagic, sizeof( magic ) ) )
+    throw DataException( "Dataset: file " + filename + " is not a cfit dataset." );
+
+  read( &version  , sizeof( version   ) );
+  read( &byteOrder, sizeof( byteOrder ) );
+  if ( version != fileVersion )
+    throw DataException( "Dataset: unsupported version of file " + filename + "." );
+  if ( byteOrder != fileByteOrder )
+    throw DataException( "Dataset: file " + filename + " was written with a different byte order." );
+
+  read( &nEntries, sizeof( nEntries ) );
+  read( &nFields , sizeof( nFields  ) );
+  read( &flags   , sizeof( flags    ) );
+
+  std::vector< std::string > names;
+  std::vector< bool        > hasErrors;
+  for ( std::uint32_t field = 0; field < nFields; ++field )
+  {
+    std::uint32_t nameLength;
+    std::uint32_t errors;
+    read( &nameLength, sizeof( nameLength ) );
+    std::string name( nameLength, '\0' );
+    read( &name[ 0 ], nameLength );
+    read( &errors, sizeof( errors ) );
+
+    names    .push_back( name   );
+    hasErrors.push_back( errors );
+  }
+
+  pos += ( fileAlignment - pos % fileAlignment ) % fileAlignment;
+
+  // Point the columns to their position in the file.
+  const std::size_t& columnSize = nEntries * sizeof( double );
+  const std::size_t& nColumns = std::count( hasErrors.begin(), hasErrors.end(), true ) + nFields + ( flags & 1 );
+  if ( pos + nColumns * columnSize > length )
+    throw DataException( "Dataset: file " + filename + " is truncated." );
+
+  std::map< std::string, std::pair< const double*, const double* > > columns;
+  for ( std::uint32_t field = 0; field < nFields; ++field )
+  {
+    const double* vals = reinterpret_cast< const double* >( data + pos );
+    pos += columnSize;
+
+    const double* errs = 0;
+    if ( hasErrors[ field ] )
+    {
+      errs = reinterpret_cast< const double* >( data + pos );
+      pos += columnSize;
+    }
+
+    columns[ names[ field ] ] = std::make_pair( vals, errs );
+  }
+
+  reset();
+
+  _mappedWeights = ( flags & 1 ) ? reinterpret_cast< const double* >( data + pos ) : 0;
+  _mappedSize    = nEntries;
+  _columns       = columns;
+  _file          = mapped;
+}
+
+
+void Dataset::detach()
+{
+  if ( ! _file && ! _index && ( _data.use_count() == 1 ) && ( _weights.use_count() == 1 ) )
+    return;
+
+  std::shared_ptr< data_type >             data   ( new data_type );
+  std::shared_ptr< std::vector< double > > weights( new std::vector< double > );
+
+  const std::vector< std::string >& names = fields();
+  for ( std::vector< std::string >::const_iterator name = names.begin(); name != names.end(); ++name )
+  {
+    const std::vector< double >& vals = values( *name );
+    const std::vector< double >& errs = errors( *name );
+
+    std::vector< std::pair< double, double > >& column = ( *data )[ *name ];
+    column.reserve( vals.size() );
+    for ( std::size_t entry = 0; entry < vals.size(); ++entry )
+      column.push_back( std::make_pair( vals[ entry ], errs[ entry ] ) );
+  }
+
+  if ( weighted() )
+    *weights = this->weights();
+
+  reset();
+
+  _data    = data;
+  _weights = weights;
+}
+
+
+void Dataset::reset()
+{
+  _data   .reset( new data_type             );
+  _weights.reset( new std::vector< double > );
+  _index  .reset();
+
+  _file.reset();
+  _columns.clear();
+  _mappedWeights = 0;
+  _mappedSize    = 0;
+}
+
+
+
+// Separators of the columns in text files.
+static inline bool isSeparator( const char& ch )
+{
+  return ( ch == ' ' ) || ( ch == '\t' ) || ( ch == ',' ) || ( ch == ';' ) || ( ch == '\r' );
+}
+
+
+// Parse a floating point number starting at pos, and move pos after it. Numbers with
+//    up to 15 significant digits and decimal exponents up to 22 in absolute value are
+//    computed exactly with a single multiplication or division, since both the mantissa
+//    and the power of ten are exact doubles. Otherwise, fall back to strtod. The buffer
+//    must be null-terminated.
+static bool parseDouble( const char*& pos, double& value )
+{
+  static const double powers[] = { 1e0 , 1e1 , 1e2 , 1e3 , 1e4 , 1e5 , 1e6 , 1e7 , 1e8 , 1e9 , 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  const char* ch = pos;
+
+  const bool negative = ( *ch == '-' );
+  if ( ( *ch == '-' ) || ( *ch == '+' ) )
+    ++ch;
+
+  std::uint64_t mantissa = 0;
+  int           digits   = 0;
+  int           exponent = 0;
+  bool          any      = false;
+
+  for ( ; ( *ch >= '0' ) && ( *ch <= '9' ); ++ch, any = true )
+    if ( digits < 19 )
+    {
+      mantissa = 10 * mantissa + ( *ch - '0' );
+      digits  += ( mantissa != 0 );
+    }
+    else
+      ++exponent;
+
+  if ( *ch == '.' )
+    for ( ++ch; ( *ch >= '0' ) && ( *ch <= '9' ); ++ch, any = true )
+      if ( digits < 19 )
+      {
+        mantissa = 10 * mantissa + ( *ch - '0' );
+        digits  += ( mantissa != 0 );
+        --exponent;
+      }
+
+  if ( any && ( ( *ch == 'e' ) || ( *ch == 'E' ) ) )
+  {
+    const char* exp = ch + 1;
+    const bool negExp = ( *exp == '-' );
+    if ( ( *exp == '-' ) || ( *exp == '+' ) )
+      ++exp;
+
+    if ( ( *exp >= '0' ) && ( *exp <= '9' ) )
+    {
+      int expValue = 0;
+      for ( ; ( *exp >= '0' ) && ( *exp <= '9' ); ++exp )
+        expValue = std::min( 10 * expValue + ( *exp - '0' ), 100000 );
+
+      exponent += negExp ? - expValue : expValue;
+      ch        = exp;
+    }
+  }
+
+  if ( any && ( digits <= 15 ) && ( exponent >= -22 ) && ( exponent <= 22 ) )
+  {
+    value = ( exponent < 0 ) ? mantissa / powers[ - exponent ] : mantissa * powers[ exponent ];
+    if ( negative )
+      value = - value;
+    pos = ch;
+    return true;
+  }
+
+  // Slow path, also for special values like nan or inf.
+  char* end = 0;
+  value = std::strtod( pos, &end );
+  if ( end == pos )
+    return false;
+
+  pos = end;
+  return true;
+}
+
+
+// Split a line of a text file into its tokens.
+static std::vector< std::string > splitLine( const char* begin, const char* end )
+{
+  std::vector< std::string > tokens;
+  while ( begin < end )
+  {
+    while ( ( begin < end ) && isSeparator( *begin ) )
+      ++begin;
+
+    const char* token = begin;
+    while ( ( begin < end ) && ! isSeparator( *begin ) )
+      ++begin;
+
+    if ( begin > token )
+      tokens.push_back( std::string( token, begin ) );
+  }
+
+  return tokens;
+}
+
+
+// Count the lines with data, i.e. not empty nor comments, between begin and end.
+static std::size_t countLines( const char* begin, const char* end )
+{
+  std::size_t count = 0;
+  while ( begin < end )
+  {
+    const char* eol = static_cast< const char* >( std::memchr( begin, '\n', end - begin ) );
+    if ( ! eol )
+      eol = end;
+
+    while ( ( begin < eol ) && isSeparator( *begin ) )
+      ++begin;
+
+    count += ( begin < eol ) && ( *begin != '#' );
+    begin  = eol + 1;
+  }
+
+  return count;
+}
+
+
+void Dataset::read( const std::string& filename, const std::vector< Variable >& columns,
+                    const unsigned& nThreads ) throw( DataException )
+{
+  std::vector< std::string > fields;
+  for ( std::vector< Variable >::const_iterator var = columns.begin(); var != columns.end(); ++var )
+    fields.push_back( var->name() );
+
+  if ( fields.empty() )
+    throw DataException( "Dataset: no variables given to read the columns of file " + filename + "." );
+
+  readText( filename, fields, std::map< std::string, std::string >(), nThreads );
+}
+
+
+void Dataset::read( const std::string& filename, const std::map< std::string, Variable >& columns,
+                    const unsigned& nThreads ) throw( DataException )
+{
+  std::map< std::string, std::string > renames;
+  for ( std::map< std::string, Variable >::const_iterator col = columns.begin(); col != columns.end(); ++col )
+    renames[ col->first ] = col->second.name();
+
+  readText( filename, std::vector< std::string >(), renames, nThreads );
+}
+
+
+void Dataset::readText( const std::string&                          filename,
+                        const std::vector< std::string >&           fields  ,
+                        const std::map< std::string, std::string >& renames ,
+                        const unsigned&                             nThreads  ) throw( DataException )
+{
+  // Read the whole file at once. The string keeps the buffer null-terminated.
+  std::ifstream file( filename.c_str(), std::ios::binary );
+  if ( ! file )
+    throw DataException( "Dataset: cannot open file " + filename + "." );
+
+  file.seekg( 0, std::ios::end );
+  std::string buffer( std::size_t( file.tellg() ), '\0' );
+  file.seekg( 0, std::ios::beg );
+  file.read( &buffer[ 0 ], buffer.size() );
+  file.close();
+
+  const char* begin = buffer.c_str();
+  const char* end   = begin + buffer.size();
+
+  // Find the first line with content, and determine if it is a header.
+  const char* first = begin;
+  const char* eol   = end;
+  while ( first < end )
+  {
+    eol = static_cast< const char* >( std::memchr( first, '\n', end - first ) );
+    if ( ! eol )
+      eol = end;
+
+    const char* ch = first;
+    while ( ( ch < eol ) && isSeparator( *ch ) )
+      ++ch;
+
+    if ( ( ch < eol ) && ( *ch != '#' ) )
+      break;
+
+    first = eol + 1;
+  }
+
+  double dummy;
+  const std::vector< std::string >& firstTokens = splitLine( first, eol );
+  const char* token = firstTokens.empty() ? 0 : firstTokens[ 0 ].c_str();
+  const bool& hasHeader = token && ! parseDouble( token, dummy );
+
+  // Name of the field of every column of the file, or empty if it is not read.
+  std::vector< std::string > fieldOf;
+  if ( ! fields.empty() )
+    fieldOf = fields;
+  else
+  {
+    if ( ! hasHeader )
+      throw DataException( "Dataset: file " + filename + " does not have a header with the names of the columns." );
+
+    for ( std::vector< std::string >::const_iterator name = firstTokens.begin(); name != firstTokens.end(); ++name )
+      if ( renames.empty() )
+        fieldOf.push_back( *name );
+      else
+        fieldOf.push_back( renames.count( *name ) ? renames.find( *name )->second : std::string() );
+
+    for ( std::map< std::string, std::string >::const_iterator col = renames.begin(); col != renames.end(); ++col )
+      if ( std::find( firstTokens.begin(), firstTokens.end(), col->first ) == firstTokens.end() )
+        throw DataException( "Dataset: column " + col->first + " does not exist in file " + filename + "." );
+  }
+
+  if ( hasHeader )
+    begin = std::min( eol + 1, end );
+
+  // Split the file in chunks with complete lines.
+  unsigned nChunks = nThreads ? nThreads : std::max( 1u, std::thread::hardware_concurrency() );
+  nChunks = std::max< std::size_t >( 1, std::min< std::size_t >( nChunks, ( end - begin ) / ( 1 << 16 ) ) );
+
+  std::vector< const char* > bounds( 1, begin );
+  for ( unsigned chunk = 1; chunk < nChunks; ++chunk )
+  {
+    const char* bound = std::max( bounds.back(), begin + ( end - begin ) * chunk / nChunks );
+    const char* next  = static_cast< const char* >( std::memchr( bound, '\n', end - bound ) );
+    bounds.push_back( next ? next + 1 : end );
+  }
+  bounds.push_back( end );
+
+  // First pass: count the lines of every chunk to determine where their rows start.
+  std::vector< std::size_t > offsets( nChunks + 1, 0 );
+  std::vector< std::thread > threads;
+  for ( unsigned chunk = 0; chunk < nChunks; ++chunk )
+    threads.push_back( std::thread( [ &, chunk ]() { offsets[ chunk + 1 ] = countLines( bounds[ chunk ], bounds[ chunk + 1 ] ); } ) );
+  for ( std::vector< std::thread >::iterator thread = threads.begin(); thread != threads.end(); ++thread )
+    thread->join();
+  threads.clear();
+
+  std::partial_sum( offsets.begin(), offsets.end(), offsets.begin() );
+  const std::size_t& nRows = offsets.back();
+
+  // Allocate the columns with their final size.
+  reset();
+
+  std::vector< std::vector< std::pair< double, double > >* > targets;
+  std::size_t nColumns = 0;
+  for ( std::size_t col = 0; col < fieldOf.size(); ++col )
+    if ( fieldOf[ col ].empty() )
+      targets.push_back( 0 );
+    else
+    {
+      targets.push_back( &( *_data )[ fieldOf[ col ] ] );
+      targets.back()->assign( nRows, std::make_pair( 0.0, 0.0 ) );
+      nColumns = col + 1;
+    }
+
+  // Second pass: parse every chunk, writing directly in the columns. Each chunk
+  //    reports the first row that could not be parsed, if any.
+  std::vector< std::size_t > badRows( nChunks, nRows );
+  for ( unsigned chunk = 0; chunk < nChunks; ++chunk )
+    threads.push_back( std::thread( [ &, chunk ]()
+    {
+      std::size_t row = offsets[ chunk ];
+      const char* ch  = bounds[ chunk ];
+      const char* last = bounds[ chunk + 1 ];
+      while ( ch < last )
+      {
+        const char* lineEnd = static_cast< const char* >( std::memchr( ch, '\n', last - ch ) );
+        if ( ! lineEnd )
+          lineEnd = last;
+
+        while ( ( ch < lineEnd ) && isSeparator( *ch ) )
+          ++ch;
+
+        if ( ( ch < lineEnd ) && ( *ch != '#' ) )
+        {
+          double value;
+          for ( std::size_t col = 0; col < nColumns; ++col )
+          {
+            if ( ( ch >= lineEnd ) || ! parseDouble( ch, value ) || ( ch > lineEnd ) ||
+                 ( ( ch < lineEnd ) && ! isSeparator( *ch ) ) )
+            {
+              badRows[ chunk ] = row;
+              return;
+            }
+
+            if ( targets[ col ] )
+              ( *targets[ col ] )[ row ].first = value;
+
+            while ( ( ch < lineEnd ) && isSeparator( *ch ) )
+              ++ch;
+          }
+          ++row;
+        }
+
+        ch = lineEnd + 1;
+      }
+    } ) );
+  for ( std::vector< std::thread >::iterator thread = threads.begin(); thread != threads.end(); ++thread )
+    thread->join();
+
+  const std::size_t& badRow = *std::min_element( badRows.begin(), badRows.end() );
+  if ( badRow < nRows )
+  {
+    reset();
+    std::ostringstream msg;
+    msg << "Dataset: cannot parse entry " << badRow << " of file " << filename << ".";
+    throw DataException( msg.str() );
+  }
+}
+
+
+
+// View of the entries [ first, last ).
+const Dataset Dataset::range( const std::size_t& first, const std::size_t& last ) const
+{
+  const std::size_t  begin = std::min( first, size() );
+  const std::size_t  end   = std::min( std::max( last, begin ), size() );
+
+  std::shared_ptr< std::vector< std::size_t > > index( new std::vector< std::size_t >( end - begin ) );
+  for ( std::size_t entry = begin; entry < end; ++entry )
+    ( *index )[ entry - begin ] = row( entry );
+
+  Dataset ret( *this );
+  ret._index = index;
+
+  return ret;
+}
+
+
+void Dataset::prefetch( const std::size_t& first, const std::size_t& last ) const
+{
+  const std::size_t end = std::min( last, size() );
+  if ( ! _file || ( first >= end ) )
+    return;
+
+  // Views keep their entries in the order of the rows, so these are within the rows
+  //    [ row( first ), row( end - 1 ) ].
+  const std::size_t  begin = row( first );
+  const std::size_t& bytes = ( row( end - 1 ) + 1 - begin ) * sizeof( double );
+
+  typedef std::map< std::string, std::pair< const double*, const double* > >::const_iterator cIter;
+  for ( cIter col = _columns.begin(); col != _columns.end(); ++col )
+  {
+    _file->prefetch( col->second.first + begin, bytes );
+    if ( col->second.second )
+      _file->prefetch( col->second.second + begin, bytes );
+  }
+
+  if ( _mappedWeights )
+    _file->prefetch( _mappedWeights + begin, bytes );
+}
+
+
+void Dataset::release( const std::size_t& first, const std::size_t& last ) const
 {
-  std::map< const std::string, std::pair< double, double > > limits = region.limits();
+  const std::size_t end = std::min( last, size() );
+  if ( ! _file || ( first >= end ) )
+    return;
 
-  Dataset ret;
+  // Views keep their entries in the order of the rows, so these are within the rows
+  //    [ row( first ), row( end - 1 ) ].
+  const std::size_t  begin = row( first );
+  const std::size_t& bytes = ( row( end - 1 ) + 1 - begin ) * sizeof( double );
 
-  bool accept; // To decide whether a given entry passes the region cuts.
-  std::size_t nentries = this->size();
-  for ( std::size_t e = 0; e < nentries; ++e )
+  typedef std::map< std::string, std::pair< const double*, const double* > >::const_iterator cIter;
+  for ( cIter col = _columns.begin(); col != _columns.end(); ++col )
   {
-    // Check if this entry passes all the region cuts.
-    const datum_type& entry = this->entry( e );
-    accept = true;
-    for ( std::map< const std::string, std::pair< double, double > >::const_iterator limit = limits.begin();
-          accept && ( limit != limits.end() ); ++limit )
+    _file->release( col->second.first + begin, bytes );
+    if ( col->second.second )
+      _file->release( col->second.second + begin, bytes );
+  }
+
+  if ( _mappedWeights )
+    _file->release( _mappedWeights + begin, bytes );
+}
+
+
+
+// Value of an entry of a mapped column, or of an owned column of (value, error) pairs.
+static inline const double& columnValue( const double*                      column, const std::size_t& entry ) { return column[ entry ];       }
+static inline const double& columnValue( const std::pair< double, double >* column, const std::size_t& entry ) { return column[ entry ].first; }
+
+
+// Clear the flags of the entries of a column outside the open range ( lower, upper ).
+//    If rows is not null, entry e of the view is the row rows[ e ] of the column.
+template < class Column >
+static void cutColumn( const Column* column, const std::size_t* rows, const double& lower, const double& upper,
+                       std::vector< unsigned char >& accept )
+{
+  const std::size_t nEntries = accept.size();
+
+  if ( rows )
+    for ( std::size_t e = 0; e < nEntries; ++e )
+    {
+      const double& x = columnValue( column, rows[ e ] );
+      accept[ e ] &= ( x > lower ) & ( x < upper );
+    }
+  else
+    for ( std::size_t e = 0; e < nEntries; ++e )
     {
-      accept &= entry.at( limit->first ).first > limit->second.first;
-      accept &= entry.at( limit->first ).first < limit->second.second;
+      const double& x = columnValue( column, e );
+      accept[ e ] &= ( x > lower ) & ( x < upper );
     }
+}
+
+
+const Dataset Dataset::slice( const Region& region ) const throw( DataException )
+{
+  typedef std::map< const std::string, std::pair< double, double > >::const_iterator lIter;
 
-    // If this entry passes all the region cuts, include it in the result dataset.
-    if ( accept )
-      ret.push( entry );
+  const std::map< const std::string, std::pair< double, double > >& limits = region.limits();
+  const std::size_t&                                                 nEntries = size();
+
+  // Flag the entries that pass the cuts, with a pass over the column of every field
+  //    constrained by the region.
+  std::vector< unsigned char > accept( nEntries, 1 );
+  const std::size_t*           rows = _index ? _index->data() : 0;
+  for ( lIter limit = limits.begin(); limit != limits.end(); ++limit )
+  {
+    const double& lower = limit->second.first;
+    const double& upper = limit->second.second;
+
+    if ( _file && _columns.count( limit->first ) )
+      cutColumn( _columns.find( limit->first )->second.first, rows, lower, upper, accept );
+    else if ( ! _file && _data->count( limit->first ) )
+      cutColumn( _data->find( limit->first )->second.data(), rows, lower, upper, accept );
+    else
+      throw DataException( "Dataset: cannot slice variable " + limit->first + ", which does not exist in dataset" );
   }
 
+  // The view refers to the rows of the parent dataset, so views of views do not chain.
+  std::shared_ptr< std::vector< std::size_t > > index( new std::vector< std::size_t > );
+  index->reserve( std::count( accept.begin(), accept.end(), 1 ) );
+  for ( std::size_t e = 0; e < nEntries; ++e )
+    if ( accept[ e ] )
+      index->push_back( row( e ) );
+
+  Dataset ret( *this );
+  ret._index = index;
+
   return ret;
 }
 
@@ -155,95 +1006,151 @@ const Dataset Dataset::slice( const Region& region ) const
 #ifdef MPI_ON
 void Dataset::scatter()
 {
-  const MPI::Comm& world = MPI::COMM_WORLD;
-  const int size = world.Get_size();
-  const int rank = world.Get_rank();
+  scatter( std::vector< double >() );
+}
 
-  int root = 0;
 
-  int nFields;
-  int nData;    // Number of data this process is assigned.
-  int nAllData; // Total number of data in all processes.
+void Dataset::scatter( const std::vector< double >& costs ) throw( DataException )
+{
+  int size;
+  int rank;
+  MPI_Comm_size( MPI_COMM_WORLD, &size );
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+
+  const int root = 0;
+
+  // Description of the dataset, known by the root process: number of entries, whether
+  //    they are weighted, and the names of the fields (separated by null characters)
+  //    with a flag telling if they have any non-zero error.
+  int         header[ 3 ] = { 0, 0, 0 }; // Entries, weighted, length of the names.
+  std::string names;
+  std::vector< std::string > fieldNames;
+  std::vector< char        > hasErrors;
 
-  char* fieldName;
-  int   fieldLength;
+  std::vector< std::vector< double > > valueCols;
+  std::vector< std::vector< double > > errorCols;
 
-  // The root process is the one that has read the data, so it knows about it.
   if ( rank == root )
+  {
+    if ( ! costs.empty() && ( costs.size() != this->size() ) )
+      throw DataException( "Dataset: the number of costs does not match the number of entries." );
+
+    fieldNames = fields();
+    for ( std::vector< std::string >::const_iterator name = fieldNames.begin(); name != fieldNames.end(); ++name )
     {
-      nFields  = _data.size();
-      nAllData = this->size();
+      names += *name + '\0';
+
+      valueCols.push_back( values( *name ) );
+      errorCols.push_back( errors( *name ) );
+      const std::vector< double >& errs = errorCols.back();
+      hasErrors.push_back( std::any_of( errs.begin(), errs.end(), []( const double& err ){ return err != 0.0; } ) );
     }
 
-  // Broadcast the number of fields and data to be scattered.
-  world.Bcast( &nFields , 1, MPI::INT, root );
-  world.Bcast( &nAllData, 1, MPI::INT, root );
+    header[ 0 ] = this->size();
+    header[ 1 ] = weighted();
+    header[ 2 ] = names.size();
+  }
+
+  MPI_Bcast( header, 3, MPI_INT, root, MPI_COMM_WORLD );
+
+  const int& nAllData   = header[ 0 ];
+  const int& isWeighted = header[ 1 ];
 
-  // Compute how many events this process must receive from the root and allocate memory for them.
-  nData = nAllData / size + ( rank < nAllData % size );
+  names.resize( header[ 2 ] );
+  MPI_Bcast( &names[ 0 ], header[ 2 ], MPI_CHAR, root, MPI_COMM_WORLD );
 
-  // Arrays that will receive sent data.
-  double* values = new double[ nData ];
-  double* errors = new double[ nData ];
+  if ( rank != root )
+  {
+    for ( std::size_t begin = 0; begin < names.size(); begin = names.find( '\0', begin ) + 1 )
+      fieldNames.push_back( names.c_str() + begin );
+    hasErrors.resize( fieldNames.size() );
+  }
+
+  const int nFields = fieldNames.size();
+  if ( nFields )
+    MPI_Bcast( &hasErrors[ 0 ], nFields, MPI_CHAR, root, MPI_COMM_WORLD );
 
+  // Number of columns sent for every entry.
+  const int nColumns = nFields + std::count( hasErrors.begin(), hasErrors.end(), 1 ) + isWeighted;
+
+  // First entry assigned to every process. By default all the processes get the same
+  //    number of entries. If the cost of every entry is given, the entries are split
+  //    such that the accumulated cost of every process is the same.
+  std::vector< int > first( size + 1, nAllData );
   if ( rank == root )
+  {
+    if ( costs.empty() )
+      for ( int proc = 0; proc < size; ++proc )
+        first[ proc ] = ( nAllData / size ) * proc + std::min( nAllData % size, proc );
+    else
     {
-      // Vectors of the size and offset of the dataset to be delivered to each process.
-      int count [ size ];
-      int offset[ size ];
-
-      // Compute how many events to send each process, and their offsets.
-      for ( int proc = 0; proc < size; proc++ )
-	{
-	  count [ proc ] =   nAllData / size + ( proc < nAllData % size );
-	  offset[ proc ] = ( nAllData / size ) * rank + std::min( nAllData % size, rank );
-	}
-
-      double* allValues = new double[ nAllData ];
-      double* allErrors = new double[ nAllData ];
-
-      typedef std::map< std::string, std::vector< std::pair< double, double > > >::const_iterator dataIter;
-      for ( dataIter field = _data.begin(); field != _data.end(); field++ )
-	{
-	  // Determine the name of the field and its length.
-	  fieldName   = const_cast< char* >( field->first.c_str() );
-	  fieldLength = field->first.size() + 1;
-
-	  // Convert the C++ container objects to C arrays.
-	  std::transform( field->second.begin(), field->second.end(), allValues, Select1st() );
-	  std::transform( field->second.begin(), field->second.end(), allErrors, Select2nd() );
-
-	  // Broadcast the name of the field.
-	  world.Bcast( &fieldLength, 1          , MPI::INT , root );
-	  world.Bcast( fieldName   , fieldLength, MPI::CHAR, root );
-
-	  // Scatter the data corresponding to this field.
-	  world.Scatterv( allValues, count, offset, MPI::DOUBLE, values, nData, MPI::DOUBLE, root );
-	  world.Scatterv( allErrors, count, offset, MPI::DOUBLE, errors, nData, MPI::DOUBLE, root );
-
-	  _data[ field->first ].clear();
-	  for ( int datum = 0; datum < nData; datum++ )
-	    this->push( field->first, values[ datum ], errors[ datum ] );
-	}
+      std::vector< double > accumulated( nAllData );
+      std::partial_sum( costs.begin(), costs.end(), accumulated.begin() );
+      const double& total = nAllData ? accumulated.back() : 0.0;
+      for ( int proc = 0; proc < size; ++proc )
+        first[ proc ] = std::lower_bound( accumulated.begin(), accumulated.end(), total * proc / size ) - accumulated.begin();
+      first[ 0 ] = 0;
     }
-  else
+  }
+  MPI_Bcast( &first[ 0 ], size + 1, MPI_INT, root, MPI_COMM_WORLD );
+
+  const int& nData = first[ rank + 1 ] - first[ rank ];
+
+  // Pack the columns of each process contiguously, one after the other, such that
+  //    a single call delivers all of them.
+  std::vector< double > sendBuffer;
+  std::vector< int    > count ( size );
+  std::vector< int    > offset( size );
+  if ( rank == root )
+  {
+    sendBuffer.reserve( std::size_t( nAllData ) * nColumns );
+    const std::vector< double >& wgts = weights();
+    for ( int proc = 0; proc < size; ++proc )
     {
-      for ( int field = 0; field < nFields; field++ )
-	{
-	  world.Bcast( &fieldLength, 1          , MPI::INT , root );
-	  fieldName = new char[ fieldLength ];
-	  world.Bcast( fieldName   , fieldLength, MPI::CHAR, root );
+      offset[ proc ] = first[ proc ] * nColumns;
+      count [ proc ] = ( first[ proc + 1 ] - first[ proc ] ) * nColumns;
+
+      for ( int field = 0; field < nFields; ++field )
+      {
+        sendBuffer.insert( sendBuffer.end(), valueCols[ field ].begin() + first[ proc ], valueCols[ field ].begin() + first[ proc + 1 ] );
+        if ( hasErrors[ field ] )
+          sendBuffer.insert( sendBuffer.end(), errorCols[ field ].begin() + first[ proc ], errorCols[ field ].begin() + first[ proc + 1 ] );
+      }
+      if ( isWeighted )
+        sendBuffer.insert( sendBuffer.end(), wgts.begin() + first[ proc ], wgts.begin() + first[ proc + 1 ] );
+    }
+    valueCols.clear();
+    errorCols.clear();
+  }
 
-	  world.Scatterv( 0, 0, 0, MPI::DOUBLE, values, nData, MPI::DOUBLE, root );
-	  world.Scatterv( 0, 0, 0, MPI::DOUBLE, errors, nData, MPI::DOUBLE, root );
+  std::vector< double > recvBuffer( std::size_t( nData ) * nColumns );
+  MPI_Scatterv( sendBuffer.data(), count.data(), offset.data(), MPI_DOUBLE,
+                recvBuffer.data(), nData * nColumns, MPI_DOUBLE, root, MPI_COMM_WORLD );
+  sendBuffer.clear();
 
-	  _data[ fieldName ].clear();
-	  for ( int datum = 0; datum < nData; datum++ )
-	    this->push( fieldName, values[ datum ], errors[ datum ] );
+  // Unpack the received columns into the storage of the dataset.
+  reset();
+
+  const double* column = recvBuffer.data();
+  for ( int field = 0; field < nFields; ++field )
+  {
+    std::vector< std::pair< double, double > >& entries = ( *_data )[ fieldNames[ field ] ];
+    entries.resize( nData );
 
-	  delete[] fieldName;
-	}
+    for ( int entry = 0; entry < nData; ++entry )
+      entries[ entry ].first = column[ entry ];
+    column += nData;
+
+    if ( hasErrors[ field ] )
+    {
+      for ( int entry = 0; entry < nData; ++entry )
+        entries[ entry ].second = column[ entry ];
+      column += nData;
     }
+  }
+
+  if ( isWeighted )
+    _weights->assign( column, column + nData );
 }
 #endif
 
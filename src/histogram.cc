@@ -0,0 +1,136 @@
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include <cfit/histogram.hh>
+
+
+Histogram::Histogram( const Variable& x, const unsigned& nbins, const double& min, const double& max ) throw( DataException )
+{
+  _vars .push_back( x     );
+  _nBins.push_back( nbins );
+  _lower.push_back( min   );
+  _upper.push_back( max   );
+
+  init();
+}
+
+
+Histogram::Histogram( const Variable& x, const unsigned& nbinsx, const double& minx, const double& maxx,
+                      const Variable& y, const unsigned& nbinsy, const double& miny, const double& maxy ) throw( DataException )
+{
+  _vars .push_back( x      );
+  _nBins.push_back( nbinsx );
+  _lower.push_back( minx   );
+  _upper.push_back( maxx   );
+
+  _vars .push_back( y      );
+  _nBins.push_back( nbinsy );
+  _lower.push_back( miny   );
+  _upper.push_back( maxy   );
+
+  init();
+}
+
+
+void Histogram::init()
+{
+  std::size_t size = 1;
+  for ( unsigned dim = 0; dim < _vars.size(); ++dim )
+  {
+    if ( _nBins[ dim ] == 0 )
+      throw DataException( "Histogram: the number of bins of variable " + _vars[ dim ].name() + " must be positive." );
+
+    if ( ! ( _lower[ dim ] < _upper[ dim ] ) )
+      throw DataException( "Histogram: the lower limit of variable " + _vars[ dim ].name() + " must be below its upper limit." );
+
+    size *= _nBins[ dim ];
+  }
+
+  _counts.assign( size, 0.0 );
+}
+
+
+void Histogram::fill( const Dataset& data ) throw( DataException )
+{
+  // Read the columns of the histogrammed variables only once.
+  std::vector< std::vector< double > > columns;
+  for ( std::vector< Variable >::const_iterator var = _vars.begin(); var != _vars.end(); ++var )
+    columns.push_back( data.values( var->name() ) );
+
+  std::vector< double > values( _vars.size() );
+
+  const std::size_t& size = data.size();
+  for ( std::size_t entry = 0; entry < size; ++entry )
+  {
+    for ( unsigned dim = 0; dim < _vars.size(); ++dim )
+      values[ dim ] = columns[ dim ][ entry ];
+
+    fill( values, data.weight( entry ) );
+  }
+}
+
+
+void Histogram::fill( const std::vector< double >& values, const double& weight )
+{
+  const std::size_t& index = bin( values );
+
+  if ( index < _counts.size() )
+    _counts[ index ] += weight;
+}
+
+
+const double Histogram::width( const unsigned& dim ) const
+{
+  return ( _upper.at( dim ) - _lower.at( dim ) ) / _nBins.at( dim );
+}
+
+
+const double Histogram::binLower( const std::size_t& bin, const unsigned& dim ) const
+{
+  // Determine the index of the bin along the requested variable.
+  std::size_t index = bin;
+  for ( unsigned prev = 0; prev < dim; ++prev )
+    index /= _nBins[ prev ];
+  index %= _nBins.at( dim );
+
+  return _lower[ dim ] + index * width( dim );
+}
+
+
+const double Histogram::binUpper( const std::size_t& bin, const unsigned& dim ) const
+{
+  return binLower( bin, dim ) + width( dim );
+}
+
+
+const double Histogram::total() const
+{
+  double total = 0.0;
+  for ( std::vector< double >::const_iterator count = _counts.begin(); count != _counts.end(); ++count )
+    total += *count;
+
+  return total;
+}
+
+
+const std::size_t Histogram::bin( const std::vector< double >& values ) const
+{
+  std::size_t index  = 0;
+  std::size_t stride = 1;
+  for ( unsigned dim = 0; dim < _vars.size(); ++dim )
+  {
+    // Entries exactly at the upper limit are left out, as any other value outside the range.
+    if ( ( values[ dim ] < _lower[ dim ] ) || ( values[ dim ] >= _upper[ dim ] ) )
+      return _counts.size();
+
+    const std::size_t  local = std::min< std::size_t >( std::floor( ( values[ dim ] - _lower[ dim ] ) / width( dim ) ), _nBins[ dim ] - 1 );
+
+    index  += local * stride;
+    stride *= _nBins[ dim ];
+  }
+
+  return index;
+}
@@ -0,0 +1,219 @@
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+#include <cfit/kdtree.hh>
+
+
+KdTree::KdTree( const std::map< std::string, double >& tolerances ) throw( DataException )
+  : _nCells( 0 )
+{
+  typedef std::map< std::string, double >::const_iterator tIter;
+  for ( tIter tol = tolerances.begin(); tol != tolerances.end(); ++tol )
+  {
+    if ( ! ( tol->second > 0.0 ) )
+      throw DataException( "KdTree: the tolerance of field " + tol->first + " must be positive." );
+
+    _fields    .push_back( tol->first  );
+    _tolerances.push_back( tol->second );
+  }
+}
+
+
+// Split the cell with the entries in [ begin, end ) until its extent is below the tolerances.
+void KdTree::split( const std::vector< std::vector< double > >& columns,
+                    std::vector< std::size_t >::iterator        begin  ,
+                    std::vector< std::size_t >::iterator        end    ,
+                    std::vector< std::vector< std::size_t > >&  cells    ) const
+{
+  // Find the field with the largest extent relative to its tolerance.
+  std::size_t axis   = 0;
+  double      ratio  = 0.0;
+  double      middle = 0.0;
+  for ( std::size_t field = 0; field < _fields.size(); ++field )
+  {
+    const std::vector< double >& column = columns[ field ];
+
+    double min = column[ *begin ];
+    double max = column[ *begin ];
+    for ( std::vector< std::size_t >::iterator entry = begin; entry != end; ++entry )
+    {
+      min = std::min( min, column[ *entry ] );
+      max = std::max( max, column[ *entry ] );
+    }
+
+    if ( ( max - min ) / _tolerances[ field ] > ratio )
+    {
+      axis   = field;
+      ratio  = ( max - min ) / _tolerances[ field ];
+      middle = ( max + min ) / 2.0;
+    }
+  }
+
+  // The cell is small enough.
+  if ( ratio <= 1.0 )
+  {
+    cells.push_back( std::vector< std::size_t >( begin, end ) );
+    return;
+  }
+
+  // Split at the middle of the widest side. Both halves contain at least one entry,
+  //    since the minimum is below the middle and the maximum is not.
+  const std::vector< double >& column = columns[ axis ];
+  std::vector< std::size_t >::iterator half = std::partition( begin, end,
+                                                              [ &column, middle ]( const std::size_t& entry )
+                                                              { return column[ entry ] < middle; } );
+
+  split( columns, begin, half, cells );
+  split( columns, half , end , cells );
+}
+
+
+const Dataset KdTree::compress( const Dataset& data ) throw( DataException )
+{
+  const std::size_t& size = data.size();
+
+  std::vector< std::vector< double > > columns;
+  for ( std::vector< std::string >::const_iterator field = _fields.begin(); field != _fields.end(); ++field )
+    columns.push_back( data.values( *field ) );
+
+  const std::vector< double >& weights = data.weights();
+
+  // Build the cells of the tree.
+  std::vector< std::size_t > index( size );
+  for ( std::size_t entry = 0; entry < size; ++entry )
+    index[ entry ] = entry;
+
+  std::vector< std::vector< std::size_t > > cells;
+  if ( size )
+    split( columns, index.begin(), index.end(), cells );
+
+  _nCells = cells.size();
+
+  // Values and errors of all the fields in the dataset. Entries are only merged if the
+  //    fields that are not used to build the tree and the errors of all the fields are
+  //    equal, since they are not bound by any tolerance.
+  const std::vector< std::string >& allFields = data.fields();
+
+  std::vector< std::vector< double > > allValues;
+  std::vector< std::vector< double > > allErrors;
+  std::vector< const std::vector< double >* > keys;
+  for ( std::vector< std::string >::const_iterator field = allFields.begin(); field != allFields.end(); ++field )
+  {
+    allValues.push_back( data.values( *field ) );
+    allErrors.push_back( data.errors( *field ) );
+  }
+
+  for ( std::size_t field = 0; field < allFields.size(); ++field )
+  {
+    if ( std::find( _fields.begin(), _fields.end(), allFields[ field ] ) == _fields.end() )
+      keys.push_back( &allValues[ field ] );
+    keys.push_back( &allErrors[ field ] );
+  }
+
+  auto less = [ &keys ]( const std::size_t& left, const std::size_t& right )
+  {
+    for ( std::vector< const std::vector< double >* >::const_iterator key = keys.begin(); key != keys.end(); ++key )
+      if ( ( **key )[ left ] != ( **key )[ right ] )
+        return ( **key )[ left ] < ( **key )[ right ];
+
+    return false;
+  };
+
+  _maxDeviation.clear();
+  _deviation2  .clear();
+  for ( std::vector< std::string >::const_iterator field = allFields.begin(); field != allFields.end(); ++field )
+  {
+    _maxDeviation[ *field ] = 0.0;
+    _deviation2  [ *field ] = 0.0;
+  }
+
+  Dataset compressed;
+  std::map< std::string, std::pair< double, double > > merged;
+
+  typedef std::vector< std::size_t >::iterator eIter;
+  for ( std::vector< std::vector< std::size_t > >::iterator cell = cells.begin(); cell != cells.end(); ++cell )
+  {
+    std::sort( cell->begin(), cell->end(), less );
+
+    eIter end;
+    for ( eIter begin = cell->begin(); begin != cell->end(); begin = end )
+    {
+      end = begin + 1;
+      while ( ( end != cell->end() ) && ! less( *begin, *end ) )
+        ++end;
+
+      // The group keeps the signed sum of the weights, but its centroid uses their
+      //    absolute values, so that it stays inside the cell when negative weights
+      //    cancel the positive ones. Groups with all their weights null are dropped.
+      double sumW    = 0.0;
+      double sumAbsW = 0.0;
+      for ( eIter entry = begin; entry != end; ++entry )
+      {
+        sumW    += weights[ *entry ];
+        sumAbsW += std::fabs( weights[ *entry ] );
+      }
+
+      if ( sumAbsW <= 0.0 )
+        continue;
+
+      for ( std::size_t field = 0; field < allFields.size(); ++field )
+      {
+        double value = 0.0;
+        double error = 0.0;
+        for ( eIter entry = begin; entry != end; ++entry )
+        {
+          const double absW = std::fabs( weights[ *entry ] );
+          value += absW * allValues[ field ][ *entry ];
+          error += absW * allErrors[ field ][ *entry ];
+        }
+
+        merged[ allFields[ field ] ] = std::make_pair( value / sumAbsW, error / sumAbsW );
+      }
+
+      // Accumulate the distances of the entries to the centroid, along every field.
+      for ( std::size_t field = 0; field < allFields.size(); ++field )
+      {
+        const double& centroid = merged[ allFields[ field ] ].first;
+        double&       maxDev   = _maxDeviation[ allFields[ field ] ];
+        double&       dev2     = _deviation2  [ allFields[ field ] ];
+        for ( eIter entry = begin; entry != end; ++entry )
+        {
+          const double& dist = std::fabs( allValues[ field ][ *entry ] - centroid );
+
+          maxDev  = std::max( maxDev, dist );
+          dev2   += std::fabs( weights[ *entry ] ) * dist * dist;
+        }
+      }
+
+      compressed.push( merged, sumW );
+    }
+  }
+
+  return compressed;
+}
+
+
+const double KdTree::maxDeviation( const std::string& field ) const throw( DataException )
+{
+  const std::map< std::string, double >::const_iterator& pos = _maxDeviation.find( field );
+
+  if ( pos == _maxDeviation.end() )
+    throw DataException( "KdTree: field " + field + " is not in the last compressed dataset." );
+
+  return pos->second;
+}
+
+
+const double KdTree::deviation2( const std::string& field ) const throw( DataException )
+{
+  const std::map< std::string, double >::const_iterator& pos = _deviation2.find( field );
+
+  if ( pos == _deviation2.end() )
+    throw DataException( "KdTree: field " + field + " is not in the last compressed dataset." );
+
+  return pos->second;
+}
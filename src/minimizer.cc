@@ -1,5 +1,11 @@
 
 #include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <numeric>
+#include <exception>
 
 #include <Minuit/MnMigrad.h>
 
@@ -8,13 +14,193 @@
 #include <cfit/parameter.hh>
 
 
+// Transpose the cached values of a pdf, given by slot, into a contiguous event-major block.
+template < class T >
+static void transpose( const std::map< unsigned, std::vector< T > >& cached,
+                       const std::size_t&                            stride,
+                       const std::size_t&                            size  ,
+                       std::vector< T >&                             block ,
+                       const std::string&                            type    ) throw( PdfException )
+{
+  block.assign( size * stride, T() );
+
+  typedef typename std::map< unsigned, std::vector< T > >::const_iterator mIter;
+  for ( mIter slot = cached.begin(); slot != cached.end(); ++slot )
+  {
+    if ( ( slot->first >= stride ) || ( slot->second.size() != size ) )
+      throw PdfException( "Minimizer::cache: inconsistent cached " + type + " values." );
+
+    for ( std::size_t n = 0; n < size; ++n )
+      block[ n * stride + slot->first ] = slot->second[ n ];
+  }
+}
+
+
 void Minimizer::cache()
 {
+  // Each minimizer owns its copy of the pdf, so cache indices can be assigned from
+  //    zero. This way the cache indices are dense, and they can be used as offsets.
+  PdfBase::_cacheIdxReal    = 0;
+  PdfBase::_cacheIdxComplex = 0;
+
   const std::map< unsigned, std::vector< double >                 >& cachedR = _pdf->cacheReal   ( _data );
   const std::map< unsigned, std::vector< std::complex< double > > >& cachedC = _pdf->cacheComplex( _data );
 
-  _cacheR.insert( cachedR.begin(), cachedR.end() );
-  _cacheC.insert( cachedC.begin(), cachedC.end() );
+  _strideR = _pdf->nCachedReal();
+  _strideC = _pdf->nCachedComplex();
+
+  // Transpose the cached values into event-major contiguous blocks.
+  transpose( cachedR, _strideR, _data.size(), _cacheR, "real"    );
+  transpose( cachedC, _strideC, _data.size(), _cacheC, "complex" );
+
+  _blockR = _cacheR.data();
+  _blockC = _cacheC.data();
+}
+
+
+// Cache the values chunk by chunk, writing them to the scratch file, that is mapped
+//    afterwards. The real block goes first, followed by the complex one.
+void Minimizer::cacheToFile()
+{
+  const std::size_t& size = _data.size();
+
+  std::ofstream file( _scratch.c_str(), std::ios::binary | std::ios::trunc );
+  if ( ! file )
+    throw PdfException( "Minimizer::cacheToFile: cannot open scratch file " + _scratch + "." );
+
+  std::vector< double                 > blockR;
+  std::vector< std::complex< double > > blockC;
+
+  for ( std::size_t first = 0; first < size; first += _chunkSize )
+  {
+    const std::size_t last = std::min( first + _chunkSize, size );
+    const Dataset& chunk = _data.range( first, last );
+
+    PdfBase::_cacheIdxReal    = 0;
+    PdfBase::_cacheIdxComplex = 0;
+
+    const std::map< unsigned, std::vector< double >                 >& cachedR = _pdf->cacheReal   ( chunk );
+    const std::map< unsigned, std::vector< std::complex< double > > >& cachedC = _pdf->cacheComplex( chunk );
+
+    // Every chunk must use the same slots.
+    if ( first == 0 )
+    {
+      _strideR = _pdf->nCachedReal();
+      _strideC = _pdf->nCachedComplex();
+    }
+    else if ( ( _strideR != _pdf->nCachedReal() ) || ( _strideC != _pdf->nCachedComplex() ) )
+      throw PdfException( "Minimizer::cacheToFile: inconsistent cached values between chunks." );
+
+    transpose( cachedR, _strideR, last - first, blockR, "real"    );
+    transpose( cachedC, _strideC, last - first, blockC, "complex" );
+
+    file.seekp( first * _strideR * sizeof( double ) );
+    file.write( reinterpret_cast< const char* >( blockR.data() ), blockR.size() * sizeof( double ) );
+    file.seekp( size * _strideR * sizeof( double ) + first * _strideC * sizeof( std::complex< double > ) );
+    file.write( reinterpret_cast< const char* >( blockC.data() ), blockC.size() * sizeof( std::complex< double > ) );
+
+    _data.release( first, last );
+  }
+
+  file.close();
+  if ( ! file )
+    throw PdfException( "Minimizer::cacheToFile: error writing scratch file " + _scratch + "." );
+
+  _blockR = 0;
+  _blockC = 0;
+
+  if ( _strideR || _strideC )
+  {
+    try
+    {
+      _cacheFile.reset( new MappedFile( _scratch ) );
+    }
+    catch ( DataException& error )
+    {
+      throw PdfException( error.what() );
+    }
+
+    _blockR = reinterpret_cast< const double*                 >( _cacheFile->data() );
+    _blockC = reinterpret_cast< const std::complex< double >* >( _cacheFile->data() + size * _strideR * sizeof( double ) );
+  }
+
+  // The mapping keeps the content of the file until it is unmapped.
+  std::remove( _scratch.c_str() );
+}
+
+
+void Minimizer::prefetch( const std::size_t& first, const std::size_t& last ) const
+{
+  const std::size_t end = std::min( last, _data.size() );
+  if ( first >= end )
+    return;
+
+  _data.prefetch( first, end );
+
+  if ( _cacheFile )
+  {
+    _cacheFile->prefetch( _blockR + first * _strideR, ( end - first ) * _strideR * sizeof( double ) );
+    _cacheFile->prefetch( _blockC + first * _strideC, ( end - first ) * _strideC * sizeof( std::complex< double > ) );
+  }
+}
+
+
+void Minimizer::release( const std::size_t& first, const std::size_t& last ) const
+{
+  const std::size_t end = std::min( last, _data.size() );
+  if ( first >= end )
+    return;
+
+  _data.release( first, end );
+
+  if ( _cacheFile )
+  {
+    _cacheFile->release( _blockR + first * _strideR, ( end - first ) * _strideR * sizeof( double ) );
+    _cacheFile->release( _blockC + first * _strideC, ( end - first ) * _strideC * sizeof( std::complex< double > ) );
+  }
+}
+
+
+void Minimizer::setThreads( const unsigned& nThreads )
+{
+  _pool.reset( ( nThreads == 1 ) ? 0 : new ThreadPool( nThreads ) );
+
+  if ( _pool && ( _pool->size() == 1 ) )
+    _pool.reset();
+}
+
+
+double Minimizer::sum( const std::function< double ( const std::size_t&, const std::size_t& ) >& terms,
+                       const std::size_t& first, const std::size_t& last ) const throw( PdfException )
+{
+  if ( ! _pool )
+    return terms( first, last );
+
+  const unsigned& nThreads = _pool->size();
+
+  // Exceptions cannot leave the threads, so they are thrown again from the calling one.
+  std::vector< double             > partial( nThreads, 0.0 );
+  std::vector< std::exception_ptr > errors ( nThreads );
+
+  _pool->run( [ & ]( const unsigned& thread )
+  {
+    const std::size_t begin = first + ( last - first ) *   thread         / nThreads;
+    const std::size_t end   = first + ( last - first ) * ( thread + 1 ) / nThreads;
+    try
+    {
+      partial[ thread ] = terms( begin, end );
+    }
+    catch ( ... )
+    {
+      errors[ thread ] = std::current_exception();
+    }
+  } );
+
+  for ( std::vector< std::exception_ptr >::const_iterator error = errors.begin(); error != errors.end(); ++error )
+    if ( *error )
+      std::rethrow_exception( *error );
+
+  return std::accumulate( partial.begin(), partial.end(), 0.0 );
 }
 
 
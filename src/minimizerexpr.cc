@@ -2,10 +2,12 @@
 #include <iostream>
 
 #include <algorithm>
+#include <numeric>
 
 #include <Minuit/MnMigrad.h>
 
 #include <cfit/functors.hh>
+#include <cfit/parallel.hh>
 #include <cfit/minimizerexpr.hh>
 
 
@@ -36,18 +38,25 @@ double MinimizerExpr::operator()( const std::vector< double >& pars ) const thro
     parMap[ par->first ].setValue( pars[ index++ ] );
 
   // Set each minimizer's parameter vector from the just set local values of the parameters.
-  typedef std::vector< const Minimizer* >::const_iterator mIter;
-  double total = 0.;
-  for ( mIter mmzr = _minimizers.begin(); mmzr != _minimizers.end(); ++mmzr )
+  //    With MPI, the sum of the contribution of each process to one term is started while
+  //    the next term is computed.
+  std::vector< double            > terms( _minimizers.size(), 0.0 );
+  std::vector< Parallel::Request > requests;
+  for ( std::size_t term = 0; term < _minimizers.size(); ++term )
   {
-    const std::map< std::string, Parameter >& mParMap = (*mmzr)->pdf().getPars();
+    const std::map< std::string, Parameter >& mParMap = _minimizers[ term ]->pdf().getPars();
     std::vector< double > mPars;
     for ( pIter par = mParMap.begin(); par != mParMap.end(); ++par )
       mPars.push_back( parMap.find( par->first )->second.value() );
 
-    total += (**mmzr)( mPars );
+    terms[ term ] = _minimizers[ term ]->local( mPars );
+    requests.push_back( Parallel::startSum( &terms[ term ], 1 ) );
   }
 
+  Parallel::wait( requests );
+
+  const double& total = std::accumulate( terms.begin(), terms.end(), 0.0 );
+
   if ( _verbose )
     std::cout << "total = " << total << std::endl;
 
@@ -1,4 +1,6 @@
 
+#include <limits>
+
 #include <cfit/models/argus.hh>
 #include <cfit/math.hh>
 
@@ -45,6 +47,7 @@ void Argus::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -57,6 +60,7 @@ void Argus::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -74,6 +78,7 @@ void Argus::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -82,6 +87,7 @@ void Argus::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -90,6 +96,7 @@ void Argus::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -99,12 +106,15 @@ void Argus::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
 
 void Argus::cache()
 {
+  invalidate();
+
   const double& vc    = c();
   const double& cSq   = std::pow( c()  , 2 );
   const double& chiSq = std::pow( chi(), 2 );
@@ -119,7 +129,8 @@ void Argus::cache()
   //    c^2/3 ( 1 - x^2 / c^2 )^(3/2) between upper and lower.
   if ( chiSq == 0.0 )
   {
-    _norm = cSq / 3.0 * ( std::pow( argmax, 1.5 ) - std::pow( argmin, 1.5 ) );
+    _norm    = cSq / 3.0 * ( std::pow( argmax, 1.5 ) - std::pow( argmin, 1.5 ) );
+    _logNorm = std::log( _norm );
     return;
   }
 
@@ -129,6 +140,8 @@ void Argus::cache()
   //    which is Gamma( 3/2 ).
   _norm  = cSq / ( 2.0 * chi3 ) * std::sqrt( M_PI / 2.0 );
   _norm *= ( Math::gamma_p( 1.5, chiSq * argmax ) - Math::gamma_p( 1.5, chiSq * argmin ) );
+
+  _logNorm = std::log( _norm );
 }
 
 
@@ -164,6 +177,37 @@ const double Argus::evaluate( const std::vector< double >& vars ) const throw( P
 }
 
 
+const double Argus::evaluateLog( const double& x ) const throw( PdfException )
+{
+  const double& vc   = c();
+  const double& vchi = chi();
+
+  if ( _hasLower && ( x < _lower ) )
+    return - std::numeric_limits< double >::infinity();
+
+  if ( _hasUpper && ( x > _upper ) )
+    return - std::numeric_limits< double >::infinity();
+
+  if ( ( x < 0.0 ) || ( x > vc ) )
+    return - std::numeric_limits< double >::infinity();
+
+  const double& cSq   = std::pow( vc  , 2 );
+  const double& chiSq = std::pow( vchi, 2 );
+
+  const double& xSq = std::pow( x, 2 );
+
+  const double& diff = 1.0 - xSq / cSq;
+
+  return std::log( x * std::sqrt( diff ) ) - chiSq * diff - _logNorm;
+}
+
+
+const double Argus::evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+{
+  return evaluateLog( vars[ 0 ] );
+}
+
+
 void Argus::setParExpr()
 {
   _c  .setPars( _parMap );
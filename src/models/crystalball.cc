@@ -1,4 +1,6 @@
 
+#include <limits>
+
 #include <cfit/math.hh>
 #include <cfit/models/crystalball.hh>
 
@@ -48,6 +50,7 @@ void CrystalBall::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -57,6 +60,7 @@ void CrystalBall::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -68,6 +72,7 @@ void CrystalBall::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -76,6 +81,7 @@ void CrystalBall::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -84,6 +90,7 @@ void CrystalBall::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -93,6 +100,7 @@ void CrystalBall::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -176,6 +184,8 @@ const double CrystalBall::cumulativeNorm( const double& x ) const
 
 void CrystalBall::cache()
 {
+  invalidate();
+
   // Evaluate the area up to the lower limit (0 if it's -infinity).
   double areaLo = 0.0;
   if ( _hasLower )
@@ -195,7 +205,8 @@ void CrystalBall::cache()
   }
 
   // Assign the value of the norm as the difference of areas between the upper and lower limits.
-  _norm = areaUp - areaLo;
+  _norm    = areaUp - areaLo;
+  _logNorm = std::log( _norm );
 }
 
 
@@ -246,6 +257,39 @@ const double CrystalBall::evaluate( const std::vector< double >& vars ) const th
 }
 
 
+// Logarithm of the pdf, computed analytically for both the core and the tail.
+const double CrystalBall::evaluateLog( const double& x ) const throw( PdfException )
+{
+  if ( _hasLower && ( x < _lower ) )
+    return - std::numeric_limits< double >::infinity();
+
+  if ( _hasUpper && ( x > _upper ) )
+    return - std::numeric_limits< double >::infinity();
+
+  const double& valpha = alpha();
+  const double& sign   = ( valpha > 0 ) - ( valpha < 0 );
+  const double& chi    = sign * ( x - mu() ) / sigma();
+
+  const double& absAlpha = std::fabs( valpha );
+
+  if ( chi < - absAlpha )
+  {
+    const double& vn      = n();
+    const double& alphaSq = std::pow( valpha, 2 );
+
+    return - alphaSq / 2.0 + vn * std::log( vn / ( vn - alphaSq - absAlpha * chi ) ) - _logNorm;
+  }
+
+  return - std::pow( chi, 2 ) / 2.0 - _logNorm;
+}
+
+
+const double CrystalBall::evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+{
+  return evaluateLog( vars[ 0 ] );
+}
+
+
 void CrystalBall::setParExpr()
 {
   _mu   .setPars( _parMap );
@@ -264,8 +308,19 @@ const double CrystalBall::area( const double& min, const double& max ) const thr
 }
 
 
-const std::map< std::string, double > CrystalBall::generate() const throw( PdfException )
+const std::map< std::string, double > CrystalBall::generate( RandomStream& stream ) const throw( PdfException )
 {
+  return generateEvent( stream );
+}
+
+
+// Inverse of the cumulative distribution, applied to a block of flat random numbers.
+void CrystalBall::generateBlock( RandomStream&                            stream ,
+                                 const std::size_t&                       count  ,
+                                 const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* column = columns.at( getVar( 0 ).name() );
+
   const double& vmu    = mu();
   const double& vn     = n();
   const double& vnm1   = vn - 1.0;
@@ -289,25 +344,28 @@ const std::map< std::string, double > CrystalBall::generate() const throw( PdfEx
   // Cumulative pdf evaluated at the tail-core threshold for alpha > 0.
   const double& areaTh = vsigma / ( std::fabs( valpha ) * _norm ) * vn / vnm1 * std::exp( - std::pow( valpha, 2 ) / 2.0 );
 
-  // Generate a flat random number.
-  std::uniform_real_distribution< double > dist( 0.0, 1.0 );
-  const double& unif = dist( Random::engine() ) + areaLo;
+  // Terms of the inverse of the core.
+  const double& coreCoef   = _norm / vsigma * sqrt( 2.0 / M_PI );
+  const double& coreOffset = std::erf( std::fabs( valpha ) / sqrt2 );
 
-  // If random number is below the tail-core threshold, generate the tail.
-  //    Otherwise, generate the (Gaussian) core.
-  double genChi;
-  if ( unif < areaTh )
-    genChi = - std::fabs( valpha ) - vn / std::fabs( valpha ) * ( std::pow( areaTh / unif, 1.0 / vnm1 ) - 1.0 );
-  else
-    genChi = sqrt2 * Math::inverf( _norm / vsigma * sqrt( 2.0 / M_PI ) * ( unif - areaTh ) - std::erf( std::fabs( valpha ) / sqrt2 ) );
+  const int& sign = ( valpha > 0 ) - ( valpha < 0 );
 
-  genChi *= ( valpha > 0 ) - ( valpha < 0 );
+  // Generate flat random numbers.
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = stream.flat() + areaLo;
 
-  double genVal = vmu + vsigma * genChi;
-
-  std::map< std::string, double > gen;
-  gen[ getVar( 0 ).name() ] = genVal;
+  // If a random number is below the tail-core threshold, generate the tail.
+  //    Otherwise, generate the (Gaussian) core.
+  double genChi;
+  for ( std::size_t entry = 0; entry < count; ++entry )
+  {
+    const double& unif = column[ entry ];
+    if ( unif < areaTh )
+      genChi = - std::fabs( valpha ) - vn / std::fabs( valpha ) * ( std::pow( areaTh / unif, 1.0 / vnm1 ) - 1.0 );
+    else
+      genChi = sqrt2 * Math::inverf( coreCoef * ( unif - areaTh ) - coreOffset );
 
-  return gen;
+    column[ entry ] = vmu + vsigma * sign * genChi;
+  }
 }
 
@@ -2,13 +2,19 @@
 #include <cfit/models/decay3body.hh>
 #include <cfit/function.hh>
 #include <cfit/random.hh>
+#include <cfit/parallel.hh>
+
+
+// Maximum number of candidates drawn at once in batch generation.
+static const std::size_t maxBatch = 65536;
+
 
 Decay3Body::Decay3Body( const Variable&   mSq12,
 			const Variable&   mSq13,
 			const Variable&   mSq23,
 			const Amplitude&  amp  ,
 			const PhaseSpace& ps     )
-  : DecayModel( mSq12, mSq13, mSq23, amp, ps ), _norm( 1.0 ), _maxPdf( 14.0 )
+  : DecayModel( mSq12, mSq13, mSq23, amp, ps ), _norm( 1.0 ), _sampler( ps )
 {
   // Do calculations common to all values of variables
   //    (usually compute norm).
@@ -51,6 +57,9 @@ const double Decay3Body::evaluateFuncs( const double& mSq12, const double& mSq13
 
 void Decay3Body::cache()
 {
+  // Resonances of the proposal for generation.
+  _sampler.update( _amp );
+
   // Compute the value of _norm.
   _norm = 0.0;
 
@@ -67,8 +76,10 @@ void Decay3Body::cache()
   double mSq13;
   double mSq23;
 
-  // Compute the integral on the grid.
-  for ( int binX = 0; binX < nBins; ++binX )
+  // Compute the integral on the grid. Every process integrates a subset of its rows.
+  const int rank  = Parallel::rank();
+  const int nProc = Parallel::size();
+  for ( int binX = rank; binX < nBins; binX += nProc )
     for ( int binY = 0; binY < nBins; ++binY )
     {
       mSq12 = min + step * ( binX + 0.5 );
@@ -81,6 +92,8 @@ void Decay3Body::cache()
         _norm += std::norm( _amp.evaluate( _ps, mSq12, mSq13, mSq23 ) ) * evaluateFuncs( mSq12, mSq13, mSq23 );
     }
 
+  Parallel::sum( _norm );
+
   _norm *= std::pow( step, 2 );
 
   return;
@@ -229,56 +242,91 @@ const Decay3Body operator*( const Function& left, Decay3Body right )
 }
 
 
-const std::map< std::string, double > Decay3Body::generate() const throw( PdfException )
+const std::map< std::string, double > Decay3Body::generate( RandomStream& stream ) const throw( PdfException )
 {
-  // Generate mSq12 and mSq13, and compute mSq23 from these.
-  const double& min12 = std::pow( _ps.m1()      + _ps.m2(), 2 );
-  const double& min13 = std::pow( _ps.m1()      + _ps.m3(), 2 );
-  const double& max12 = std::pow( _ps.mMother() - _ps.m3(), 2 );
-  const double& max13 = std::pow( _ps.mMother() - _ps.m2(), 2 );
+  return generateEvent( stream );
+}
+
 
-  const std::string& mSq12name = getVar( 0 ).name();
-  const std::string& mSq13name = getVar( 1 ).name();
-  const std::string& mSq23name = getVar( 2 ).name();
+// Accept-reject in batches: candidates are drawn from the proposal of the sampler for
+//    all the events left in the block, scaled by the inverse of the acceptance observed
+//    so far, and the pdf is evaluated for the whole batch before applying the decisions.
+void Decay3Body::generateBlock( RandomStream&                            stream ,
+                                const std::size_t&                       count  ,
+                                const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* mSq12col = columns.at( getVar( 0 ).name() );
+  double* mSq13col = columns.at( getVar( 1 ).name() );
+  double* mSq23col = columns.at( getVar( 2 ).name() );
 
   // Sum of squared invariant masses of all particles (mother and daughters).
   const double& mSqSum = _ps.mSqMother() + _ps.mSq1() + _ps.mSq2() + _ps.mSq3();
 
-  // Generate uniform mSq12 and mSq13.
-  double mSq12 = 0.0;
-  double mSq13 = 0.0;
-  double mSq23 = 0.0;
+  const DalitzSampler::target_type target = [ this, mSqSum ]( RandomStream&, const double& mSq12, const double& mSq13 )
+  {
+    return this->evaluate( mSq12, mSq13, mSqSum - mSq12 - mSq13 );
+  };
 
-  double pdfVal  = 0.0;
+  // Bound of the ratio of the pdf to the proposal. If a candidate exceeds it, the events
+  //    accepted so far in the block follow a distorted distribution, so the envelope of
+  //    the sampler is raised for all the blocks that follow and the block is generated
+  //    again.
+  double envelope = _sampler.envelope( target );
 
-  // Attempts to generate an event.
-  int count = 10000;
+  std::vector< double > mSq12;
+  std::vector< double > mSq13;
+  std::vector< double > ratio;
 
-  std::map< std::string, double > values;
+  std::size_t filled   = 0;
+  std::size_t tried    = 0;
+  std::size_t accepted = 0;
 
-  while ( count-- )
-  {
-    mSq12 = Random::flat( min12, max12 );
-    mSq13 = Random::flat( min13, max13 );
-    mSq23 = mSqSum - mSq12 - mSq13;
+  // Attempts to generate an event.
+  std::size_t attempts = 0;
 
-    values[ mSq12name ] = mSq12;
-    values[ mSq13name ] = mSq13;
-    values[ mSq23name ] = mSq23;
+  while ( filled < count )
+  {
+    const std::size_t  batch = std::min( ( count - filled ) * ( tried + 1 ) / ( accepted + 1 ), maxBatch );
 
-    pdfVal = this->evaluate( mSq12, mSq13, mSq23 );
+    // Draw mSq12 and mSq13 from the proposal, and keep its density.
+    mSq12.resize( batch );
+    mSq13.resize( batch );
+    ratio.resize( batch );
+    for ( std::size_t cand = 0; cand < batch; ++cand )
+      ratio[ cand ] = _sampler.propose( stream, mSq12[ cand ], mSq13[ cand ] );
 
-    if ( pdfVal > _maxPdf )
-      std::cout << "Problem: " << pdfVal << " " << mSq12 << " " << mSq13 << " " << mSqSum - mSq12 - mSq13 << std::endl;
+    for ( std::size_t cand = 0; cand < batch; ++cand )
+    {
+      const double& mSq23 = mSqSum - mSq12[ cand ] - mSq13[ cand ];
+      ratio[ cand ] = _ps.contains( mSq12[ cand ], mSq13[ cand ], mSq23 ) ?
+                      this->evaluate( mSq12[ cand ], mSq13[ cand ], mSq23 ) / ratio[ cand ] : -1.0;
+    }
 
-    // Apply the accept-reject decision.
-    if ( Random::flat( 0.0, _maxPdf ) < pdfVal )
-      return values;
+    for ( std::size_t cand = 0; ( cand < batch ) && ( filled < count ); ++cand )
+    {
+      ++tried;
+      ++attempts;
+
+      if ( ratio[ cand ] > envelope )
+      {
+        envelope = _sampler.raise( ratio[ cand ] );
+        filled   = 0;
+        attempts = 0;
+        break;
+      }
+
+      // Apply the accept-reject decision.
+      if ( ( ratio[ cand ] >= 0.0 ) && ( stream.flat( 0.0, envelope ) < ratio[ cand ] ) )
+      {
+        mSq12col[ filled ] = mSq12[ cand ];
+        mSq13col[ filled ] = mSq13[ cand ];
+        mSq23col[ filled ] = mSqSum - mSq12[ cand ] - mSq13[ cand ];
+        ++filled;
+        ++accepted;
+        attempts = 0;
+      }
+      else if ( attempts == 10000 )
+        throw PdfException( "Decay3Body::generateBlock: too many attempts to generate an event." );
+    }
   }
-
-  values[ mSq12name ] = 0.0;
-  values[ mSq13name ] = 0.0;
-  values[ mSq23name ] = 0.0;
-
-  return values;
 }
@@ -1,5 +1,6 @@
 
 #include <complex>
+#include <algorithm>
 
 #include <cfit/dataset.hh>
 #include <cfit/function.hh>
@@ -8,6 +9,13 @@
 #include <cfit/models/decay3bodybin.hh>
 
 
+// Number of cells per dimension of the grids that the areas of the bins are computed
+//    with: a fine one if the efficiency is fixed, since they are only computed once,
+//    and a coarse one if it floats, since they are computed for every set of parameters.
+static const unsigned fixedAreaCells    = 1000;
+static const unsigned floatingAreaCells = 100;
+
+
 Decay3BodyBin::Decay3BodyBin( const Variable&        mSq12  ,
                               const Variable&        mSq13  ,
                               const Variable&        mSq23  ,
@@ -19,8 +27,8 @@ Decay3BodyBin::Decay3BodyBin( const Variable&        mSq12  ,
   : DecayModel( mSq12, mSq13, mSq23, amp, ps ),
     _binning( binning ),
     _hasKappa( false ), _phi( phi ),
-    _nDir( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ),
-    _binIndex( 0 )
+    _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ), _fixedAreas( false ),
+    _cacheBins( false ), _binIndex( 0 ), _cacheEff( false ), _effIndex( 0 )
 {
   push( phi );
 
@@ -44,8 +52,8 @@ Decay3BodyBin::Decay3BodyBin( const Variable&        mSq12  ,
   : DecayModel( mSq12, mSq13, mSq23, amp, ps ),
     _binning( binning ),
     _hasKappa( true ), _kappa( kappa ), _phi( phi ),
-    _nDir( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ),
-    _binIndex( 0 )
+    _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ), _fixedAreas( false ),
+    _cacheBins( false ), _binIndex( 0 ), _cacheEff( false ), _effIndex( 0 )
 {
   push( phi   );
   push( kappa );
@@ -71,8 +79,8 @@ Decay3BodyBin::Decay3BodyBin( const Variable&        mSq12  ,
   : DecayModel( mSq12, mSq13, mSq23, amp, ps ),
     _binning( binning ),
     _hasKappa( true ), _kappa( kappa ), _phi( phi ),
-    _nDir( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ),
-    _binIndex( 0 )
+    _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ), _fixedAreas( false ),
+    _cacheBins( false ), _binIndex( 0 ), _cacheEff( false ), _effIndex( 0 )
 {
   push( phi   );
   push( kappa );
@@ -105,74 +113,103 @@ void Decay3BodyBin::setParExpr()
 
 
 
-void Decay3BodyBin::cacheNormComponents()
+// Integrate the efficiency over every bin with the midpoint rule, on a grid over the
+//    whole Dalitz plot, since the positive and negative bins are not symmetric if the
+//    efficiency is not.
+void Decay3BodyBin::cacheAreas()
 {
-  // If the amplitude is fixed and the components have already
-  //    been computed, just return without recomputing anything.
-  if ( _fixedAmp )
+  if ( _fixedAreas )
     return;
 
-  // Define the properties of the integration method.
-  const unsigned& nBins = 100;
-  const double min   = _ps.mSq12min();
-  const double max   = _ps.mSq12max();
-  const double step  = ( max - min ) / double( nBins );
+  // If the efficiency is fixed, the areas are final.
+  bool fixedAreas = true;
+  for ( std::vector< Function >::const_iterator func = _funcs.begin(); func != _funcs.end(); ++func )
+    fixedAreas &= func->isFixed();
+
+  const unsigned& areaCells = fixedAreas ? fixedAreaCells : floatingAreaCells;
+  const unsigned& nAmpBins  = _amp.nBins();
+
+  const double& min12  = _ps.mSq12min();
+  const double& min13  = _ps.mSq13min();
+  const double& step12 = ( _ps.mSq12max() - min12 ) / double( areaCells );
+  const double& step13 = ( _ps.mSq13max() - min13 ) / double( areaCells );
 
-  // Determine whether the bins in the 100x100 bins should be cached.
-  //    Cache them if it has not yet been cached.
-  bool needToCache = _binCache.empty();
+  // The bins of the grid only depend on the binning, so they are only found once.
+  const bool needToCache = ( _binCache.size() != areaCells * areaCells );
   if ( needToCache )
-    _binCache.resize( std::pow( nBins, 2 ) );
+    _binCache.resize( areaCells * areaCells );
+
+  _apb.assign( nAmpBins, 0.0 );
+  _amb.assign( nAmpBins, 0.0 );
 
   double mSq12;
   double mSq13;
-
-  unsigned bin;
-  // Integrate only over the region mSq13 < mSq12 (positive bins).
-  for ( unsigned binX = 0; binX < nBins; ++binX )
-    for ( unsigned binY = 0; binY < binX; ++binY )
+  int    bin;
+  for ( unsigned cell12 = 0; cell12 < areaCells; ++cell12 )
+    for ( unsigned cell13 = 0; cell13 < areaCells; ++cell13 )
     {
-      mSq12 = min + step * ( binX + 0.5 );
-      mSq13 = min + step * ( binY + 0.5 );
+      mSq12 = min12 + step12 * ( cell12 + 0.5 );
+      mSq13 = min13 + step13 * ( cell13 + 0.5 );
 
-      if ( _ps.contains( mSq12, mSq13 ) )
+      // Points outside the phase space are marked as bin 0.
+      if ( needToCache )
       {
-        if ( needToCache )
-        {
-          bin = std::abs( _binning.bin( mSq12, mSq13 ) );
-
-          if ( needToCache )
-            _binCache[ nBins * binX + binY ] = bin;
-        }
-        else
-        {
-          bin = _binCache[ nBins * binX + binY ];
-        }
+        bin = _ps.contains( mSq12, mSq13 ) ? _binning.bin( mSq12, mSq13 ) : 0;
+        if ( std::abs( bin ) > int( nAmpBins ) )
+          throw PdfException( "Decay3BodyBin: the binning has more bins than the amplitude." );
+
+        _binCache[ areaCells * cell12 + cell13 ] = bin;
       }
+      else
+        bin = _binCache[ areaCells * cell12 + cell13 ];
+
+      if ( bin > 0 )
+        _apb[   bin - 1 ] += _funcs.empty() ? 1.0 : evaluateFuncs( mSq12, mSq13 );
+      else if ( bin < 0 )
+        _amb[ - bin - 1 ] += _funcs.empty() ? 1.0 : evaluateFuncs( mSq12, mSq13 );
     }
 
+  for ( unsigned ampBin = 0; ampBin < nAmpBins; ++ampBin )
+  {
+    _apb[ ampBin ] *= step12 * step13;
+    _amb[ ampBin ] *= step12 * step13;
+  }
+
+  // Once the areas are final, the bins of the grid are not needed any more.
+  _fixedAreas = fixedAreas;
+  if ( _fixedAreas )
+    std::vector< int >().swap( _binCache );
+}
+
+
+
+void Decay3BodyBin::cacheNormComponents()
+{
+  // If the amplitude is fixed and the components have already
+  //    been computed, just return without recomputing anything.
+  if ( _fixedAmp )
+    return;
+
+  cacheAreas();
+
   // Initialize the value of the norm components and the norm.
   _nDir = 0.0;
+  _nCnj = 0.0;
   _nXed = 0.0;
   _norm = 0.0;
 
-  std::vector< ParameterExpr >::const_iterator npb = _amp.npb().begin();
-  std::vector< ParameterExpr >::const_iterator nmb = _amp.nmb().begin();
-  std::vector< CoefExpr      >::const_iterator xb  = _amp.xb() .begin();
-
-  double                 np;
-  double                 nm;
-  std::complex< double > nx;
+  // Calculate the norm components, as dot products of the areas with the terms of
+  //    the bins. Bin -b has T_{-b}, T_{b} and the conjugate of X_b.
+  const std::vector< double                 >& tpb = _amp.tpb();
+  const std::vector< double                 >& tmb = _amp.tmb();
+  const std::vector< std::complex< double > >& txb = _amp.txb();
 
-  // Calculate the norm components.
-  while ( npb != _amp.npb().end() )
+  const std::size_t& nAmpBins = tpb.size();
+  for ( std::size_t bin = 0; bin < nAmpBins; ++bin )
   {
-    np = (npb++)->evaluate();
-    nm = (nmb++)->evaluate();
-    nx = std::sqrt( np * nm ) * (xb++)->evaluate();
-
-    _nDir += np + nm;
-    _nXed += 2.0 * std::real( nx );
+    _nDir += _apb[ bin ] * tpb[ bin ] + _amb[ bin ] * tmb[ bin ];
+    _nCnj += _apb[ bin ] * tmb[ bin ] + _amb[ bin ] * tpb[ bin ];
+    _nXed += _apb[ bin ] * txb[ bin ] + _amb[ bin ] * std::conj( txb[ bin ] );
   }
 
   return;
@@ -190,7 +227,7 @@ void Decay3BodyBin::cache()
   // Calculate the norm.
   const std::complex< double >& vz     = z();
   const double&                 vKappa = kappa();
-  _norm = _nDir * ( 1.0 + std::norm( vz ) ) + 2.0 * vKappa * std::real( vz * _nXed );
+  _norm = _nDir + std::norm( vz ) * _nCnj + 2.0 * vKappa * std::real( vz * _nXed );
 
   return;
 }
@@ -203,8 +240,15 @@ const std::map< unsigned, std::vector< double > > Decay3BodyBin::cacheReal( cons
 {
   std::map< unsigned, std::vector< double > > cached;
 
-  // Get an index for the cached bin.
-  _binIndex = _cacheIdxReal++;
+  // Get an index for the cached bin, and for the efficiency if it is fixed.
+  _cacheBins = true;
+  _binIndex  = _cacheIdxReal++;
+
+  _cacheEff = ! _funcs.empty();
+  for ( std::vector< Function >::const_iterator func = _funcs.begin(); func != _funcs.end(); ++func )
+    _cacheEff &= func->isFixed();
+  if ( _cacheEff )
+    _effIndex = _cacheIdxReal++;
 
   const std::string& mSq12name = getVar( 0 ).name();
   const std::string& mSq13name = getVar( 1 ).name();
@@ -219,6 +263,8 @@ const std::map< unsigned, std::vector< double > > Decay3BodyBin::cacheReal( cons
     mSq13 = data.value( mSq13name, entry );
 
     cached[ _binIndex ].push_back( _binning.bin( mSq12, mSq13 ) );
+    if ( _cacheEff )
+      cached[ _effIndex ].push_back( evaluateFuncs( mSq12, mSq13 ) );
   }
 
   return cached;
@@ -229,6 +275,52 @@ const std::map< unsigned, std::vector< double > > Decay3BodyBin::cacheReal( cons
 
 
 
+const Dataset Decay3BodyBin::counts( const Dataset& data ) const throw( PdfException )
+{
+  // The efficiency at the first event of a bin only stands for the efficiency at the
+  //    rest of its events up to a constant, and only if it does not float.
+  for ( std::vector< Function >::const_iterator func = _funcs.begin(); func != _funcs.end(); ++func )
+    if ( ! func->isFixed() )
+      throw PdfException( "Decay3BodyBin: cannot count the events of a dataset with a floating efficiency." );
+
+  // Any other field would be taken from the first event of each bin.
+  const std::vector< std::string > vars   = varNames();
+  const std::vector< std::string > fields = data.fields();
+  for ( std::vector< std::string >::const_iterator field = fields.begin(); field != fields.end(); ++field )
+    if ( std::find( vars.begin(), vars.end(), *field ) == vars.end() )
+      throw PdfException( "Decay3BodyBin: cannot count the events of a dataset with field " + *field + "." );
+
+  const std::string& mSq12name = getVar( 0 ).name();
+  const std::string& mSq13name = getVar( 1 ).name();
+
+  // First entry and sum of weights of every populated bin.
+  std::map< int, std::pair< std::size_t, double > > contents;
+
+  const std::size_t& size = data.size();
+  for ( std::size_t entry = 0; entry < size; ++entry )
+  {
+    const int& bin = _binning.bin( data.value( mSq12name, entry ), data.value( mSq13name, entry ) );
+
+    std::map< int, std::pair< std::size_t, double > >::iterator content = contents.find( bin );
+    if ( content == contents.end() )
+      contents[ bin ] = std::make_pair( entry, data.weight( entry ) );
+    else
+      content->second.second += data.weight( entry );
+  }
+
+  Dataset counted;
+  typedef std::map< int, std::pair< std::size_t, double > >::const_iterator cIter;
+  for ( cIter content = contents.begin(); content != contents.end(); ++content )
+    counted.push( data.entry( content->second.first ), content->second.second );
+
+  return counted;
+}
+
+
+
+
+
+
 // Unnormalized evaluation.
 const double Decay3BodyBin::evaluateUnnorm( const double& mSq12, const double& mSq13 ) const throw( PdfException )
 {
@@ -240,9 +332,11 @@ const double Decay3BodyBin::evaluateUnnorm( const double& mSq12, const double& m
   const std::complex< double >&& vz     = z();
   const double&&                 vKappa = kappa();
 
-  return std::max( 0.0, ( std::get< 0 >( tx )                   +
-                          std::get< 1 >( tx ) * std::norm( vz ) +
-                          2.0 * vKappa * std::real( vz * std::get< 2 >( tx ) ) ) );
+  const double& eff = _funcs.empty() ? 1.0 : evaluateFuncs( mSq12, mSq13 );
+
+  return eff * std::max( 0.0, ( std::get< 0 >( tx )                   +
+                                std::get< 1 >( tx ) * std::norm( vz ) +
+                                2.0 * vKappa * std::real( vz * std::get< 2 >( tx ) ) ) );
 }
 
 
@@ -273,10 +367,10 @@ const double Decay3BodyBin::evaluate( const std::vector< double >& vars ) const
 
 
 const double Decay3BodyBin::evaluate( const std::vector< double >&                 vars  ,
-                                      const std::vector< double >&                 cacheR,
-                                      const std::vector< std::complex< double > >& cacheC ) const throw( PdfException )
+                                      const double*                                cacheR,
+                                      const std::complex< double >*                cacheC ) const throw( PdfException )
 {
-  if ( cacheR.empty() )
+  if ( ! _cacheBins )
     return evaluate( vars );
 
   const std::size_t& size = vars.size();
@@ -291,8 +385,53 @@ const double Decay3BodyBin::evaluate( const std::vector< double >&
 
   const std::tuple< double, double, std::complex< double > >&& nx = _amp.evaluate( bin );
 
-  return std::max( 0.0, ( std::get< 0 >( nx )                   +
-                          std::get< 1 >( nx ) * std::norm( vz ) +
-                          2.0 * vKappa * std::real( vz * std::get< 2 >( nx ) ) ) ) / _norm;
+  const double& eff = _cacheEff ? cacheR[ _effIndex ] : _funcs.empty() ? 1.0 : evaluateFuncs( vars[ 0 ], vars[ 1 ] );
+
+  return eff * std::max( 0.0, ( std::get< 0 >( nx )                   +
+                                std::get< 1 >( nx ) * std::norm( vz ) +
+                                2.0 * vKappa * std::real( vz * std::get< 2 >( nx ) ) ) ) / _norm;
+}
+
+
+
+// No need to append an operator, since it can only be multiplication.
+const Decay3BodyBin& Decay3BodyBin::operator*=( const Function& right ) throw( PdfException )
+{
+  // Check that the function does not depend on any variables that the model does not.
+  const std::map< std::string, Variable >& varMap = right.getVarMap();
+  for ( std::map< std::string, Variable >::const_iterator var = varMap.begin(); var != varMap.end(); ++var )
+    if ( ! _varMap.count( var->second.name() ) )
+      throw PdfException( "Cannot multiply a Decay3BodyBin pdf model by a function that depends on other variables." );
+
+  // Consider the function parameters as own ones.
+  const std::map< std::string, Parameter >& parMap = right.getParMap();
+  _parMap.insert( parMap.begin(), parMap.end() );
+
+  // Append the function to the functions vector.
+  _funcs.push_back( right );
+
+  // Recompute the areas and the norm, since the pdf shape has changed under this operation.
+  _fixedAreas = false;
+  cache();
+
+  return *this;
+}
+
+
+
+const Decay3BodyBin operator*( Decay3BodyBin left, const Function& right )
+{
+  left *= right;
+
+  return left;
+}
+
+
+
+const Decay3BodyBin operator*( const Function& left, Decay3BodyBin right )
+{
+  right *= left;
+
+  return right;
 }
 
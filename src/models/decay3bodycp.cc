@@ -4,10 +4,16 @@
 #include <cfit/dataset.hh>
 #include <cfit/function.hh>
 #include <cfit/random.hh>
+#include <cfit/parallel.hh>
 
 #include <cfit/models/decay3bodycp.hh>
 
 
+// Maximum number of candidates drawn at once in batch generation.
+static const std::size_t maxBatch = 65536;
+
+
+
 Decay3BodyCP::Decay3BodyCP( const Variable&   mSq12  ,
                             const Variable&   mSq13  ,
                             const Variable&   mSq23  ,
@@ -17,7 +23,7 @@ Decay3BodyCP::Decay3BodyCP( const Variable&   mSq12  ,
                             bool              docache  )
   : DecayModel( mSq12, mSq13, mSq23, amp, ps ), _hasKappa( false ), _phi( phi ),
     _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixed( false ),
-    _maxPdf( 14.0 ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
+    _sampler( ps ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
     _nIntegSteps( 400 )
 {
   push( phi );
@@ -41,7 +47,7 @@ Decay3BodyCP::Decay3BodyCP( const Variable&   mSq12  ,
                             bool              docache  )
   : DecayModel( mSq12, mSq13, mSq23, amp, ps ), _hasKappa( true ), _kappa( kappa ), _phi( phi ),
     _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixed( false ),
-    _maxPdf( 14.0 ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
+    _sampler( ps ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
     _nIntegSteps( 400 )
 {
   push( phi   );
@@ -67,7 +73,7 @@ Decay3BodyCP::Decay3BodyCP( const Variable&      mSq12  ,
                             bool                 docache  )
   : DecayModel( mSq12, mSq13, mSq23, amp, ps ), _hasKappa( true ), _kappa( kappa ), _phi( phi ),
     _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixed( false ),
-    _maxPdf( 14.0 ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
+    _sampler( ps ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
     _nIntegSteps( 400 )
 {
   push( phi   );
@@ -100,6 +106,10 @@ void Decay3BodyCP::setParExpr()
 
 void Decay3BodyCP::cache()
 {
+  // Resonances of the proposal for generation. The envelope depends on z and kappa
+  //    even if the amplitudes are fixed.
+  _sampler.update( _amp );
+
   const std::complex< double >& vz     = z();
   const double&                 vKappa = kappa();
 
@@ -141,8 +151,10 @@ void Decay3BodyCP::cache()
   unsigned binDir;
   unsigned binCnj;
 
-  // Compute the integral on the grid.
-  for ( unsigned binX = 0; binX < _nIntegSteps; ++binX )
+  // Compute the integral on the grid. Every process integrates a subset of its rows.
+  const unsigned rank  = Parallel::rank();
+  const unsigned nProc = Parallel::size();
+  for ( unsigned binX = rank; binX < _nIntegSteps; binX += nProc )
     for ( unsigned binY = 0; binY < _nIntegSteps; ++binY )
     {
       mSq12 = min + step * ( binX + 0.5 );
@@ -169,8 +181,13 @@ void Decay3BodyCP::cache()
           ampDir = _amp.evaluate( _ps, mSq12, mSq13, mSq23 );
           ampCnj = _amp.evaluate( _ps, mSq13, mSq12, mSq23 );
 
+          // Cache the transposed bin too, since it is read as the conjugated
+          //    amplitude of this row, which may belong to another process.
           if ( needToCache )
+          {
             _ampCache[ _nIntegSteps * binX + binY ] = ampDir;
+            _ampCache[ _nIntegSteps * binY + binX ] = ampCnj;
+          }
         }
 
         _nDir += std::norm( ampDir ) * funcs;
@@ -179,6 +196,10 @@ void Decay3BodyCP::cache()
       }
     }
 
+  Parallel::sum( _nDir );
+  Parallel::sum( _nCnj );
+  Parallel::sum( _nXed );
+
   const double& stepSq = std::pow( step, 2 );
   _nDir *= stepSq;
   _nCnj *= stepSq;
@@ -321,8 +342,8 @@ const double Decay3BodyCP::evaluate( const std::vector< double >& vars ) const t
 
 
 const double Decay3BodyCP::evaluate( const std::vector< double >&                 vars  ,
-                                     const std::vector< double >&                 cacheR,
-                                     const std::vector< std::complex< double > >& cacheC ) const throw( PdfException )
+                                     const double*                                cacheR,
+                                     const std::complex< double >*                cacheC ) const throw( PdfException )
 {
   if ( ! _cacheAmps )
     return evaluate( vars );
@@ -430,62 +451,92 @@ const Decay3BodyCP operator*( const Function& left, Decay3BodyCP right )
 }
 
 
-const std::map< std::string, double > Decay3BodyCP::generate() const throw( PdfException )
+const std::map< std::string, double > Decay3BodyCP::generate( RandomStream& stream ) const throw( PdfException )
 {
-  // Generate mSq12 and mSq13, and compute mSq23 from these.
-  const double& min12 = std::pow( _ps.m1()      + _ps.m2(), 2 );
-  const double& min13 = std::pow( _ps.m1()      + _ps.m3(), 2 );
-  const double& max12 = std::pow( _ps.mMother() - _ps.m3(), 2 );
-  const double& max13 = std::pow( _ps.mMother() - _ps.m2(), 2 );
+  return generateEvent( stream );
+}
 
-  const std::string& mSq12name = getVar( 0 ).name();
-  const std::string& mSq13name = getVar( 1 ).name();
-  const std::string& mSq23name = getVar( 2 ).name();
+
+// Accept-reject in batches: candidates are drawn from the proposal of the sampler for
+//    all the events left in the block, scaled by the inverse of the acceptance observed
+//    so far, and the pdf is evaluated for the whole batch before applying the decisions.
+void Decay3BodyCP::generateBlock( RandomStream&                            stream ,
+                                  const std::size_t&                       count  ,
+                                  const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* mSq12col = columns.at( getVar( 0 ).name() );
+  double* mSq13col = columns.at( getVar( 1 ).name() );
+  double* mSq23col = columns.at( getVar( 2 ).name() );
 
   // Sum of squared invariant masses of all particles (mother and daughters).
   const double& mSqSum = _ps.mSqMother() + _ps.mSq1() + _ps.mSq2() + _ps.mSq3();
 
-  double mSq12 = 0.0;
-  double mSq13 = 0.0;
-  double mSq23 = 0.0;
+  const DalitzSampler::target_type target = [ this, mSqSum ]( RandomStream&, const double& mSq12, const double& mSq13 )
+  {
+    return this->evaluate( mSq12, mSq13, mSqSum - mSq12 - mSq13 );
+  };
 
-  double pdfVal  = 0.0;
+  // Bound of the ratio of the pdf to the proposal. If a candidate exceeds it, the events
+  //    accepted so far in the block follow a distorted distribution, so the envelope of
+  //    the sampler is raised for all the blocks that follow and the block is generated
+  //    again.
+  double envelope = _sampler.envelope( target );
 
-  // Attempts to generate an event.
-  int count = 50000;
+  std::vector< double > mSq12;
+  std::vector< double > mSq13;
+  std::vector< double > ratio;
 
-  std::map< std::string, double > values;
+  std::size_t filled   = 0;
+  std::size_t tried    = 0;
+  std::size_t accepted = 0;
 
-  while ( count-- )
+  // Attempts to generate an event.
+  std::size_t attempts = 0;
+
+  while ( filled < count )
   {
-    // Generate uniform mSq12 and mSq13.
-    mSq12 = Random::flat( min12, max12 );
-    mSq13 = Random::flat( min13, max13 );
-    mSq23 = mSqSum - mSq12 - mSq13;
+    const std::size_t  batch = std::min( ( count - filled ) * ( tried + 1 ) / ( accepted + 1 ), maxBatch );
+
+    // Draw mSq12 and mSq13 from the proposal, and keep its density.
+    mSq12.resize( batch );
+    mSq13.resize( batch );
+    ratio.resize( batch );
+    for ( std::size_t cand = 0; cand < batch; ++cand )
+      ratio[ cand ] = _sampler.propose( stream, mSq12[ cand ], mSq13[ cand ] );
 
-    if ( _ps.contains( mSq12, mSq13, mSq23 ) )
+    // Candidates outside the phase space are marked with a negative value.
+    for ( std::size_t cand = 0; cand < batch; ++cand )
     {
-      values[ mSq12name ] = mSq12;
-      values[ mSq13name ] = mSq13;
-      values[ mSq23name ] = mSq23;
+      const double& mSq23 = mSqSum - mSq12[ cand ] - mSq13[ cand ];
+      ratio[ cand ] = _ps.contains( mSq12[ cand ], mSq13[ cand ], mSq23 ) ?
+                      this->evaluate( mSq12[ cand ], mSq13[ cand ], mSq23 ) / ratio[ cand ] : -1.0;
+    }
 
-      pdfVal = this->evaluate( mSq12, mSq13, mSq23 );
+    for ( std::size_t cand = 0; ( cand < batch ) && ( filled < count ); ++cand )
+    {
+      ++tried;
+      ++attempts;
 
-      if ( pdfVal > _maxPdf )
-        std::cout << "Problem: " << pdfVal << " > " << _maxPdf
-                  << " for variables " << mSq12 << " " << mSq13 << " " << mSq23 << " " << _norm << std::endl;
+      if ( ratio[ cand ] > envelope )
+      {
+        envelope = _sampler.raise( ratio[ cand ] );
+        filled   = 0;
+        attempts = 0;
+        break;
+      }
 
       // Apply the accept-reject decision.
-      if ( Random::flat( 0.0, _maxPdf ) < pdfVal )
-        return values;
+      if ( ( ratio[ cand ] >= 0.0 ) && ( stream.flat( 0.0, envelope ) < ratio[ cand ] ) )
+      {
+        mSq12col[ filled ] = mSq12[ cand ];
+        mSq13col[ filled ] = mSq13[ cand ];
+        mSq23col[ filled ] = mSqSum - mSq12[ cand ] - mSq13[ cand ];
+        ++filled;
+        ++accepted;
+        attempts = 0;
+      }
+      else if ( attempts == 50000 )
+        throw PdfException( "Decay3BodyCP::generateBlock: too many attempts to generate an event." );
     }
   }
-
-  std::cout << "ALERT: too many attempts trying to generate an event" << std::endl;
-
-  values[ mSq12name ] = 0.0;
-  values[ mSq13name ] = 0.0;
-  values[ mSq23name ] = 0.0;
-
-  return values;
 }
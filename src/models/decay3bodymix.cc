@@ -1,12 +1,23 @@
 
 #include <complex>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 
 #include <cfit/dataset.hh>
 #include <cfit/function.hh>
+#include <cfit/math.hh>
 #include <cfit/random.hh>
+#include <cfit/parallel.hh>
 
 #include <cfit/models/decay3bodymix.hh>
 
+
+// Maximum number of candidates drawn at once in batch generation.
+static const std::size_t maxBatch = 65536;
+
+
 // Main constructor.
 Decay3BodyMix::Decay3BodyMix( const Variable&      mSq12  ,
                               const Variable&      mSq13  ,
@@ -25,7 +36,13 @@ Decay3BodyMix::Decay3BodyMix( const Variable&      mSq12  ,
     _hasMixing( true  ),
     _hasCPV   ( false ),
     _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ),
-    _maxPdf( 54.0 ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 )
+    _hasLower( false ), _hasUpper( false ), _lower( 0.0 ), _upper( 0.0 ),
+    _hasResolution( false ), _perEventRes( false ), _resolution( 0.0 ),
+    _gammaVal( 0.0 ), _xVal( 0.0 ), _yVal( 0.0 ), _qoverpVal( 1.0 ), _resVal( 0.0 ),
+    _normp( 0.0 ), _normm( 0.0 ), _normi( 0.0 ),
+    _sampler( ps ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
+    _cacheTimes( false ), _cacheFuncs( false ), _timeCache( 0 ),
+    _block( 0 ), _blockStride( 0 ), _blockSize( 0 ), _blockValid( false )
 {
   // Make the variables available to cfit.
   // The squared invariant masses are already made available by the DecayModel constructor.
@@ -60,7 +77,13 @@ Decay3BodyMix::Decay3BodyMix( const Variable&      mSq12  ,
     _hasMixing( true ),
     _hasCPV   ( true ),
     _nDir( 0.0 ), _nCnj( 0.0 ), _nXed( 0.0 ), _norm( 1.0 ), _fixedAmp( false ),
-    _maxPdf( 54.0 ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 )
+    _hasLower( false ), _hasUpper( false ), _lower( 0.0 ), _upper( 0.0 ),
+    _hasResolution( false ), _perEventRes( false ), _resolution( 0.0 ),
+    _gammaVal( 0.0 ), _xVal( 0.0 ), _yVal( 0.0 ), _qoverpVal( 1.0 ), _resVal( 0.0 ),
+    _normp( 0.0 ), _normm( 0.0 ), _normi( 0.0 ),
+    _sampler( ps ), _cacheAmps( false ), _ampDirCache( 0 ), _ampCnjCache( 0 ),
+    _cacheTimes( false ), _cacheFuncs( false ), _timeCache( 0 ),
+    _block( 0 ), _blockStride( 0 ), _blockSize( 0 ), _blockValid( false )
 {
   // Make the variables available to cfit.
   // The squared invariant masses are already made available by the DecayModel constructor.
@@ -86,22 +109,205 @@ Decay3BodyMix* Decay3BodyMix::copy() const
 }
 
 
-// Time evolution functions.
-const double Decay3BodyMix::psip( const double& t ) const
+// Convolution of e^[ - k t ] for t > 0 with a Gaussian of width sigma:
+//    f(t) = e^[ k^2 sigma^2 / 2 - k t ] erfc( z ) / 2, with z = ( k sigma - t / sigma ) / sqrt( 2 ),
+//         = e^[ - t^2 / ( 2 sigma^2 ) ] w( i z ) / 2,
+//    where w is the Faddeeva function. It is evaluated in the upper half plane, using
+//    erfc( z ) = 2 - erfc( - z ) when Re( z ) < 0.
+const std::complex< double > Decay3BodyMix::decay( const std::complex< double >& k, const double& t, const double& sigma )
 {
-  return std::exp( - ( 1.0 - x() ) * gamma() * t );
+  if ( std::isinf( t ) )
+    return 0.0;
+
+  if ( ! ( sigma > 0.0 ) )
+    return ( t < 0.0 ) ? 0.0 : std::exp( - k * t );
+
+  const std::complex< double >&& z     = ( k * sigma - t / sigma ) / std::sqrt( 2.0 );
+  const double&&                 gauss = std::exp( - std::pow( t / sigma, 2 ) / 2.0 );
+
+  if ( std::real( z ) >= 0.0 )
+    return gauss * Math::faddeeva( std::complex< double >( - std::imag( z ), std::real( z ) ) ) / 2.0;
+
+  return std::exp( k * k * sigma * sigma / 2.0 - k * t ) -
+         gauss * Math::faddeeva( std::complex< double >( std::imag( z ), - std::real( z ) ) ) / 2.0;
 }
 
 
-const double Decay3BodyMix::psim( const double& t ) const
+// The integral of the convolution up to t is ( Phi( t / sigma ) - f(t) ) / k, where Phi is
+//    the normal cumulative distribution, or a step function that is 1 from t = 0 without
+//    resolution, consistently with f(0) = 1.
+const std::complex< double > Decay3BodyMix::integral( const std::complex< double >& k,
+                                                      const double& lower, const double& upper, const double& sigma )
 {
-  return std::exp( - ( 1.0 + x() ) * gamma() * t );
+  double phi = 0.0;
+  if ( sigma > 0.0 )
+    phi = ( Math::erfc( - upper / sigma / std::sqrt( 2.0 ) ) - Math::erfc( - lower / sigma / std::sqrt( 2.0 ) ) ) / 2.0;
+  else
+    phi = ( ( upper >= 0.0 ) ? 1.0 : 0.0 ) - ( ( lower >= 0.0 ) ? 1.0 : 0.0 );
+
+  return ( phi - decay( k, upper, sigma ) + decay( k, lower, sigma ) ) / k;
 }
 
 
-const std::complex< double > Decay3BodyMix::psii( const double& t ) const
+void Decay3BodyMix::decay( const std::complex< double >& k, const double* t, const double* sigma,
+                           std::complex< double >* result, const std::size_t& n )
 {
-  return std::exp( - std::complex< double >( 1.0, - y() ) * gamma() * t );
+  std::vector< std::complex< double > > args( n );
+  std::vector< std::complex< double > > w   ( n );
+
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    if ( std::isinf( t[ i ] ) || ! ( sigma[ i ] > 0.0 ) )
+      continue;
+
+    const std::complex< double >&& z = ( k * sigma[ i ] - t[ i ] / sigma[ i ] ) / std::sqrt( 2.0 );
+    if ( std::real( z ) >= 0.0 )
+      args[ i ] = std::complex< double >( - std::imag( z ),   std::real( z ) );
+    else
+      args[ i ] = std::complex< double >(   std::imag( z ), - std::real( z ) );
+  }
+
+  Math::faddeeva( args.data(), w.data(), n );
+
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    if ( std::isinf( t[ i ] ) || ! ( sigma[ i ] > 0.0 ) )
+    {
+      result[ i ] = decay( k, t[ i ], sigma[ i ] );
+      continue;
+    }
+
+    const std::complex< double >&& z     = ( k * sigma[ i ] - t[ i ] / sigma[ i ] ) / std::sqrt( 2.0 );
+    const double&&                 gauss = std::exp( - std::pow( t[ i ] / sigma[ i ], 2 ) / 2.0 );
+
+    if ( std::real( z ) >= 0.0 )
+      result[ i ] = gauss * w[ i ] / 2.0;
+    else
+      result[ i ] = std::exp( k * k * sigma[ i ] * sigma[ i ] / 2.0 - k * t[ i ] ) - gauss * w[ i ] / 2.0;
+  }
+}
+
+
+void Decay3BodyMix::integral( const std::complex< double >& k, const double& lower, const double& upper,
+                              const double* sigma, std::complex< double >* result, const std::size_t& n )
+{
+  const std::vector< double > lowers( n, lower );
+  const std::vector< double > uppers( n, upper );
+
+  std::vector< std::complex< double > > decayLower( n );
+  std::vector< std::complex< double > > decayUpper( n );
+  decay( k, lowers.data(), sigma, decayLower.data(), n );
+  decay( k, uppers.data(), sigma, decayUpper.data(), n );
+
+  std::vector< double > erfcLower( n );
+  std::vector< double > erfcUpper( n );
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    erfcLower[ i ] = - lower / sigma[ i ] / std::sqrt( 2.0 );
+    erfcUpper[ i ] = - upper / sigma[ i ] / std::sqrt( 2.0 );
+  }
+  Math::erfc( erfcLower.data(), erfcLower.data(), n );
+  Math::erfc( erfcUpper.data(), erfcUpper.data(), n );
+
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    double phi = 0.0;
+    if ( sigma[ i ] > 0.0 )
+      phi = ( erfcUpper[ i ] - erfcLower[ i ] ) / 2.0;
+    else
+      phi = ( ( upper >= 0.0 ) ? 1.0 : 0.0 ) - ( ( lower >= 0.0 ) ? 1.0 : 0.0 );
+
+    result[ i ] = ( phi - decayUpper[ i ] + decayLower[ i ] ) / k;
+  }
+}
+
+
+// Time evolution functions, with the width and mixing parameters of the last call to cache.
+const double Decay3BodyMix::psip( const double& t, const double& sigma ) const
+{
+  return std::real( decay( ( 1.0 - _xVal ) * _gammaVal, t, sigma ) );
+}
+
+
+const double Decay3BodyMix::psim( const double& t, const double& sigma ) const
+{
+  return std::real( decay( ( 1.0 + _xVal ) * _gammaVal, t, sigma ) );
+}
+
+
+const std::complex< double > Decay3BodyMix::psii( const double& t, const double& sigma ) const
+{
+  return decay( std::complex< double >( 1.0, - _yVal ) * _gammaVal, t, sigma );
+}
+
+
+const double Decay3BodyMix::lowerLimit() const
+{
+  if ( _hasLower )
+    return _lower;
+
+  return _hasResolution ? - std::numeric_limits< double >::infinity() : 0.0;
+}
+
+
+const double Decay3BodyMix::upperLimit() const
+{
+  return _hasUpper ? _upper : std::numeric_limits< double >::infinity();
+}
+
+
+
+void Decay3BodyMix::setLowerLimit( const double& lower )
+{
+  _hasLower = true;
+  _lower    = lower;
+
+  cache();
+}
+
+
+void Decay3BodyMix::setUpperLimit( const double& upper )
+{
+  _hasUpper = true;
+  _upper    = upper;
+
+  cache();
+}
+
+
+void Decay3BodyMix::setLimits( const double& lower, const double& upper )
+{
+  _hasLower = true;
+  _hasUpper = true;
+  _lower    = lower;
+  _upper    = upper;
+
+  cache();
+}
+
+
+void Decay3BodyMix::unsetLowerLimit()
+{
+  _hasLower = false;
+
+  cache();
+}
+
+
+void Decay3BodyMix::unsetUpperLimit()
+{
+  _hasUpper = false;
+
+  cache();
+}
+
+
+void Decay3BodyMix::unsetLimits()
+{
+  _hasLower = false;
+  _hasUpper = false;
+
+  cache();
 }
 
 
@@ -116,6 +322,26 @@ void Decay3BodyMix::setMixing( const CoefExpr& z )
   push( _z = z );
 }
 
+void Decay3BodyMix::setResolution( const ParameterExpr& sigma )
+{
+  _hasResolution = true;
+  _perEventRes   = false;
+  push( _resolution = sigma );
+
+  cache();
+}
+
+
+void Decay3BodyMix::setPerEventResolution( const ParameterExpr& scale )
+{
+  _hasResolution = true;
+  _perEventRes   = true;
+  push( _resolution = scale );
+
+  cache();
+}
+
+
 void Decay3BodyMix::setCPV( const CoefExpr& qoverp )
 {
   if ( _hasCPV )
@@ -133,6 +359,8 @@ void Decay3BodyMix::setParExpr()
 
   if ( _hasMixing ) _z     .setPars( _parMap );
   if ( _hasCPV    ) _qoverp.setPars( _parMap );
+
+  if ( _hasResolution ) _resolution.setPars( _parMap );
 }
 
 
@@ -197,8 +425,10 @@ void Decay3BodyMix::cacheNormComponents()
   std::complex< double > ampDir;
   std::complex< double > ampCnj;
 
-  // Compute the integral on the grid.
-  for ( int binX = 0; binX < nBins; ++binX )
+  // Compute the integral on the grid. Every process integrates a subset of its rows.
+  const int rank  = Parallel::rank();
+  const int nProc = Parallel::size();
+  for ( int binX = rank; binX < nBins; binX += nProc )
     for ( int binY = 0; binY < nBins; ++binY )
     {
       mSq12 = min + step * ( binX + 0.5 );
@@ -219,6 +449,10 @@ void Decay3BodyMix::cacheNormComponents()
       }
     }
 
+  Parallel::sum( _nDir );
+  Parallel::sum( _nCnj );
+  Parallel::sum( _nXed );
+
   const double& stepSq = std::pow( step, 2 );
   _nDir *= stepSq;
   _nCnj *= stepSq;
@@ -229,33 +463,252 @@ void Decay3BodyMix::cacheNormComponents()
 
 
 
+const bool Decay3BodyMix::timeFixed() const
+{
+  typedef std::map< std::string, Parameter >::const_iterator pIter;
+
+  std::map< std::string, Parameter > pars = _width.getPars();
+  const std::map< std::string, Parameter >& zPars = _z.getPars();
+  pars.insert( zPars.begin(), zPars.end() );
+  if ( _hasResolution )
+  {
+    const std::map< std::string, Parameter >& resPars = _resolution.getPars();
+    pars.insert( resPars.begin(), resPars.end() );
+  }
+
+  for ( pIter par = pars.begin(); par != pars.end(); ++par )
+    if ( ! getPar( par->second ).isFixed() )
+      return false;
+
+  return true;
+}
+
+
+// The functions vanish outside the limits of the decay time. With a per-event
+//    resolution, every event is normalized with its own integrals of the functions.
+void Decay3BodyMix::timeFuncs( const double& t, const double& error,
+                               double& psip, double& psim, std::complex< double >& psii, double& norm ) const
+{
+  const double& tmin = lowerLimit();
+  const double& tmax = upperLimit();
+
+  const bool&   perEvent = _hasResolution && _perEventRes;
+  const double& sigma    = perEvent ? _resVal * error : _resVal;
+
+  const double&                 kp = ( 1.0 - _xVal ) * _gammaVal;
+  const double&                 km = ( 1.0 + _xVal ) * _gammaVal;
+  const std::complex< double >& ki = std::complex< double >( 1.0, - _yVal ) * _gammaVal;
+
+  norm = _norm;
+  if ( perEvent )
+    norm = _normp * std::real( integral( kp, tmin, tmax, sigma ) ) +
+           _normm * std::real( integral( km, tmin, tmax, sigma ) ) +
+           2.0 * std::real( _normi * integral( ki, tmin, tmax, sigma ) );
+
+  if ( ( t < tmin ) || ( t > tmax ) )
+  {
+    psip = 0.0;
+    psim = 0.0;
+    psii = 0.0;
+    return;
+  }
+
+  psip = std::real( decay( kp, t, sigma ) );
+  psim = std::real( decay( km, t, sigma ) );
+  psii =            decay( ki, t, sigma );
+}
+
+
+// The functions vanish outside the limits of the decay time.
+void Decay3BodyMix::timeFuncs( const double& gamma, const double& x, const double& y, const double& res,
+                               const double* t, const double* error, const std::size_t& n, double* funcs ) const
+{
+  const double& tmin = lowerLimit();
+  const double& tmax = upperLimit();
+
+  const bool&        perEvent = _hasResolution && _perEventRes;
+  const std::size_t& nFuncs   = nTimeFuncs();
+
+  const double&                 kp = ( 1.0 - x ) * gamma;
+  const double&                 km = ( 1.0 + x ) * gamma;
+  const std::complex< double >& ki = std::complex< double >( 1.0, - y ) * gamma;
+
+  std::vector< double > sigma( n, res );
+  if ( perEvent )
+    for ( std::size_t entry = 0; entry < n; ++entry )
+      sigma[ entry ] = res * error[ entry ];
+
+  std::vector< std::complex< double > > values( n );
+
+  decay( kp, t, sigma.data(), values.data(), n );
+  for ( std::size_t entry = 0; entry < n; ++entry )
+    funcs[ nFuncs * entry     ] = std::real( values[ entry ] );
+
+  decay( km, t, sigma.data(), values.data(), n );
+  for ( std::size_t entry = 0; entry < n; ++entry )
+    funcs[ nFuncs * entry + 1 ] = std::real( values[ entry ] );
+
+  decay( ki, t, sigma.data(), values.data(), n );
+  for ( std::size_t entry = 0; entry < n; ++entry )
+  {
+    funcs[ nFuncs * entry + 2 ] = std::real( values[ entry ] );
+    funcs[ nFuncs * entry + 3 ] = std::imag( values[ entry ] );
+  }
+
+  for ( std::size_t entry = 0; entry < n; ++entry )
+    if ( ( t[ entry ] < tmin ) || ( t[ entry ] > tmax ) )
+      std::fill( funcs + nFuncs * entry, funcs + nFuncs * entry + 4, 0.0 );
+
+  if ( ! perEvent )
+    return;
+
+  integral( kp, tmin, tmax, sigma.data(), values.data(), n );
+  for ( std::size_t entry = 0; entry < n; ++entry )
+    funcs[ nFuncs * entry + 4 ] = std::real( values[ entry ] );
+
+  integral( km, tmin, tmax, sigma.data(), values.data(), n );
+  for ( std::size_t entry = 0; entry < n; ++entry )
+    funcs[ nFuncs * entry + 5 ] = std::real( values[ entry ] );
+
+  integral( ki, tmin, tmax, sigma.data(), values.data(), n );
+  for ( std::size_t entry = 0; entry < n; ++entry )
+  {
+    funcs[ nFuncs * entry + 6 ] = std::real( values[ entry ] );
+    funcs[ nFuncs * entry + 7 ] = std::imag( values[ entry ] );
+  }
+}
+
+
+const std::vector< double > Decay3BodyMix::timePars() const
+{
+  std::vector< double > pars;
+  pars.push_back( _gammaVal     );
+  pars.push_back( _xVal         );
+  pars.push_back( _yVal         );
+  pars.push_back( _resVal       );
+  pars.push_back( lowerLimit()  );
+  pars.push_back( upperLimit()  );
+  pars.push_back( nTimeFuncs()  );
+
+  return pars;
+}
+
+
+
 void Decay3BodyMix::cache()
 {
+  // Resonances of the proposal for generation.
+  _sampler.update( _amp );
+
   // Compute the norm components, only if the amplitude
   //    is not fixed or they have not yet been computed.
   cacheNormComponents();
 
   _fixedAmp = _amp.isFixed();
 
-  // Calculate the norm.
-  const double&& xval = x();
-  const double&& yval = y();
-  const double&& xSq  = std::pow( xval, 2 );
-  const double&& ySq  = std::pow( yval, 2 );
+  // Width, mixing and CP violation parameters and resolution for all the evaluations
+  //    until the next call.
+  _gammaVal  = gamma();
+  _xVal      = x();
+  _yVal      = y();
+  _qoverpVal = _hasCPV        ? qoverp()     : 1.0;
+  _resVal    = _hasResolution ? resolution() : 0.0;
+
+  // Integrals over the Dalitz plot of the coefficients of the time evolution functions.
+  const double&                  nDir   = _nDir;
+  const double&&                 nCnj   = std::norm( _qoverpVal ) * _nCnj;
+  const std::complex< double >&& nXed   = _nXed * _qoverpVal;
+
+  _normp = ( nDir + nCnj + 2.0 * std::real( nXed ) ) / 4.0;
+  _normm = ( nDir + nCnj - 2.0 * std::real( nXed ) ) / 4.0;
+  _normi = std::complex< double >( nDir - nCnj, 2.0 * std::imag( nXed ) ) / 4.0;
+
+  // Integrals of the time evolution functions between the limits, in closed form. With
+  //    a per-event resolution, this is the norm of an ideal resolution, and every event
+  //    is normalized with its own integrals.
+  const double& tmin  = lowerLimit();
+  const double& tmax  = upperLimit();
+  const double& sigma = _perEventRes ? 0.0 : _resVal;
+
+  const double&&                 intp = std::real( integral( ( 1.0 - _xVal ) * _gammaVal, tmin, tmax, sigma ) );
+  const double&&                 intm = std::real( integral( ( 1.0 + _xVal ) * _gammaVal, tmin, tmax, sigma ) );
+  const std::complex< double >&& inti = integral( std::complex< double >( 1.0, - _yVal ) * _gammaVal, tmin, tmax, sigma );
 
-  const std::complex< double >&& qoverp = _qoverp.evaluate();
-  const double&& cpvp                   = ( 1.0 + std::norm( qoverp ) ) / 2.0;
-  const double&& cpvm                   = ( 1.0 - std::norm( qoverp ) ) / 2.0;
+  // Calculate the norm.
+  _norm = _normp * intp + _normm * intm + 2.0 * std::real( _normi * inti );
 
-  _norm  = ( _nDir * cpvp + xval * std::real( _nXed * qoverp ) ) / ( 1.0 - xSq );
-  _norm += ( _nDir * cpvm - yval * std::imag( _nXed * qoverp ) ) / ( 1.0 + ySq );
-  _norm /= gamma();
+  // The time evolution functions of the last block can still be used if they were
+  //    computed with these values.
+  _blockValid = ( timePars() == _blockPars );
 
   return;
 }
 
 
 
+// Cache the decay time and its error of every event or, if the time evolution does not
+//    depend on any floating parameter, the time evolution functions, with the Faddeeva
+//    function of all the events evaluated at once. The functions are computed with the
+//    limits and resolution at the time of caching. Otherwise, cacheBlock computes them
+//    from the cached times whenever the parameters change.
+const std::map< unsigned, std::vector< double > > Decay3BodyMix::cacheReal( const Dataset& data )
+{
+  std::map< unsigned, std::vector< double > > cached;
+
+  const std::size_t& size = data.size();
+
+  std::vector< double > times ( size );
+  std::vector< double > errors( size );
+  for ( std::size_t entry = 0; entry < size; ++entry )
+  {
+    times [ entry ] = data.value( _t, entry );
+    errors[ entry ] = data.error( _t, entry );
+  }
+
+  _cacheTimes = true;
+  _cacheFuncs = timeFixed();
+  _timeCache  = _cacheIdxReal;
+
+  // The functions of any previous block refer to other cached values.
+  _block      = 0;
+  _blockSize  = 0;
+  _blockValid = false;
+  _blockPars.clear();
+  _blockFuncs.clear();
+
+  if ( ! _cacheFuncs )
+  {
+    _cacheIdxReal += 2;
+
+    cached[ _timeCache     ] = times;
+    cached[ _timeCache + 1 ] = errors;
+
+    return cached;
+  }
+
+  const std::size_t& nFuncs = nTimeFuncs();
+  _cacheIdxReal += nFuncs;
+
+  // The parameters may have been set after the last call to cache, so their expressions
+  //    are updated from the parameters of the model and evaluated again.
+  setParExpr();
+
+  std::vector< double > funcs( nFuncs * size );
+  timeFuncs( gamma(), x(), y(), _hasResolution ? resolution() : 0.0, times.data(), errors.data(), size, funcs.data() );
+
+  for ( std::size_t func = 0; func < nFuncs; ++func )
+  {
+    std::vector< double >& values = cached[ _timeCache + func ];
+    values.resize( size );
+    for ( std::size_t entry = 0; entry < size; ++entry )
+      values[ entry ] = funcs[ nFuncs * entry + func ];
+  }
+
+  return cached;
+}
+
+
+
 const std::map< unsigned, std::vector< std::complex< double > > > Decay3BodyMix::cacheComplex( const Dataset& data )
 {
   // Determine whether the amplitudes should be cached, i.e. only if all their parameters are fixed.
@@ -290,33 +743,82 @@ const std::map< unsigned, std::vector< std::complex< double > > > Decay3BodyMix:
 }
 
 
+
+// Compute the time evolution functions of a block of entries in one pass over their
+//    cached times, unless they are already known for the current time parameters.
+//    In streaming mode, the block is a chunk of the data.
+void Decay3BodyMix::cacheBlock( const double* cacheR, const std::size_t& stride, const std::size_t& size )
+{
+  if ( ! _cacheTimes || _cacheFuncs || ! cacheR )
+    return;
+
+  const std::vector< double >& pars = timePars();
+  if ( ( cacheR == _block ) && ( stride == _blockStride ) && ( size == _blockSize ) && ( pars == _blockPars ) )
+  {
+    _blockValid = true;
+    return;
+  }
+
+  std::vector< double > times ( size );
+  std::vector< double > errors( size );
+  for ( std::size_t entry = 0; entry < size; ++entry )
+  {
+    times [ entry ] = cacheR[ stride * entry + _timeCache     ];
+    errors[ entry ] = cacheR[ stride * entry + _timeCache + 1 ];
+  }
+
+  _blockFuncs.resize( nTimeFuncs() * size );
+  timeFuncs( _gammaVal, _xVal, _yVal, _resVal, times.data(), errors.data(), size, _blockFuncs.data() );
+
+  _block       = cacheR;
+  _blockStride = stride;
+  _blockSize   = size;
+  _blockPars   = pars;
+  _blockValid  = true;
+}
+
+
 // Unnormalized evaluation. Calculate:
 // | A + Abar |^2            | A* - Abar* |^2                [ A + Abar   A* - Abar*            ]
 // | -------- |   psi_+(t) + | ---------- |   psi_-(t) + 2 Re[ -------- * ---------- * psi_i(t) ]
 // |    2     |              |     2      |                  [    2           2                 ]
-const double Decay3BodyMix::evaluateUnnorm( const double& mSq12, const double& mSq13, const double& mSq23, const double& t ) const
+const double Decay3BodyMix::ampSq( const std::complex< double >& ampDir, const std::complex< double >& ampCnj,
+                                   const double& psip, const double& psim, const std::complex< double >& psii ) const
 {
-  // Particle decay amplitude.
-  std::complex< double > ampDir = _amp.evaluate( _ps, mSq12, mSq13, mSq23 );
-  std::complex< double > ampCnj = _amp.evaluate( _ps, mSq13, mSq12, mSq23 );
-  if ( _hasCPV )
-    ampCnj *= _qoverp.evaluate();
+  const std::complex< double >&& ampCnjCP = ampCnj * _qoverpVal;
+
+  const std::complex< double >&& apb2 =          ( ampDir + ampCnjCP ) / 2.0;
+  const std::complex< double >&& amb2 = std::conj( ampDir - ampCnjCP ) / 2.0;
+
+  double value = 0.0;
+  value += std::norm( apb2 ) * psip;
+  value += std::norm( amb2 ) * psim;
+  value += 2.0 * std::real( apb2 * amb2 * psii );
+
+  return value;
+}
 
-  const std::complex< double >&& apb2 =          ( ampDir + ampCnj ) / 2.0;
-  const std::complex< double >&& amb2 = std::conj( ampDir - ampCnj ) / 2.0;
 
-  double ampSq = 0.0;
-  ampSq += std::norm( apb2 ) * psip( t );
-  ampSq += std::norm( amb2 ) * psim( t );
-  ampSq += 2.0 * std::real( apb2 * amb2 * psii( t ) );
+const double Decay3BodyMix::evaluateUnnorm( const double& mSq12, const double& mSq13, const double& mSq23,
+                                            const double& t    , const double& sigma                       ) const
+{
+  // Particle decay amplitude.
+  const std::complex< double >&& ampDir = _amp.evaluate( _ps, mSq12, mSq13, mSq23 );
+  const std::complex< double >&& ampCnj = _amp.evaluate( _ps, mSq13, mSq12, mSq23 );
 
-  return ampSq * evaluateFuncs( mSq12, mSq13, mSq23 );
+  return ampSq( ampDir, ampCnj, psip( t, sigma ), psim( t, sigma ), psii( t, sigma ) ) * evaluateFuncs( mSq12, mSq13, mSq23 );
 }
 
 
 const double Decay3BodyMix::evaluate( const double& mSq12, const double& mSq13, const double& mSq23, const double& t ) const
 {
-  return evaluateUnnorm( mSq12, mSq13, mSq23, t ) / _norm;
+  if ( _hasResolution && _perEventRes )
+    throw PdfException( "Decay3BodyMix: the resolution of every event is only known for cached datasets." );
+
+  if ( ( t < lowerLimit() ) || ( t > upperLimit() ) )
+    return 0.0;
+
+  return evaluateUnnorm( mSq12, mSq13, mSq23, t, _resVal ) / _norm;
 }
 
 
@@ -324,7 +826,7 @@ const double Decay3BodyMix::evaluate( const double& mSq12, const double& mSq13,
 {
   const double& mSq23 = _ps.mSqSum() - mSq12 - mSq13;
 
-  return evaluateUnnorm( mSq12, mSq13, mSq23, t ) / _norm;
+  return evaluate( mSq12, mSq13, mSq23, t );
 }
 
 
@@ -344,44 +846,58 @@ const double Decay3BodyMix::evaluate( const std::vector< double >& vars ) const
 
 
 const double Decay3BodyMix::evaluate( const std::vector< double >&                 vars  ,
-                                      const std::vector< double >&                 cacheR,
-                                      const std::vector< std::complex< double > >& cacheC ) const throw( PdfException )
+                                      const double*                                cacheR,
+                                      const std::complex< double >*                cacheC ) const throw( PdfException )
 {
-  if ( ! _cacheAmps )
+  if ( ! _cacheTimes )
     return evaluate( vars );
 
-  std::map< std::string, Variable >::const_iterator&& tpos = _varMap.find( _t );
-  if ( tpos == _varMap.end() )
-    throw PdfException( "Decay3BodyMix: model does not depend on required variable. This is a bug." );
+  const std::size_t& size = vars.size();
+  if ( ( size != 3 ) && ( size != 4 ) )
+    throw PdfException( "Decay3BodyMix can only take either 3 or 4 arguments." );
 
-  const double& t = vars[ std::distance( _varMap.begin(), tpos ) ];
+  const double&      mSq12 = vars[ 0 ];
+  const double&      mSq13 = vars[ 1 ];
+  const double&&     mSq23 = ( size == 4 ) ? vars[ 2 ] : _ps.mSqSum() - mSq12 - mSq13;
 
   // Particle decay amplitude.
-  std::complex< double > ampDir = cacheC[ _ampDirCache ];
-  std::complex< double > ampCnj = cacheC[ _ampCnjCache ];
-  if ( _hasCPV )
-    ampCnj *= _qoverp.evaluate();
+  const std::complex< double >&& ampDir = _cacheAmps ? cacheC[ _ampDirCache ] : _amp.evaluate( _ps, mSq12, mSq13, mSq23 );
+  const std::complex< double >&& ampCnj = _cacheAmps ? cacheC[ _ampCnjCache ] : _amp.evaluate( _ps, mSq13, mSq12, mSq23 );
+
+  // Time evolution functions of the event, either cached, computed for its block, or
+  //    computed from its decay time if it is not in the block. Norm for the resolution
+  //    of the event if it has its own.
+  const double* funcs = 0;
+  if ( _cacheFuncs )
+    funcs = cacheR + _timeCache;
+  else if ( _blockValid )
+  {
+    const std::size_t& offset = reinterpret_cast< std::uintptr_t >( cacheR ) - reinterpret_cast< std::uintptr_t >( _block );
+    const std::size_t& entry  = offset / ( _blockStride * sizeof( double ) );
+    if ( entry < _blockSize )
+      funcs = _blockFuncs.data() + nTimeFuncs() * entry;
+  }
 
-  const std::complex< double >&& apb2 =          ( ampDir + ampCnj ) / 2.0;
-  const std::complex< double >&& amb2 = std::conj( ampDir - ampCnj ) / 2.0;
+  double                 psip;
+  double                 psim;
+  std::complex< double > psii;
+  double                 norm;
+  if ( funcs )
+  {
+    psip = funcs[ 0 ];
+    psim = funcs[ 1 ];
+    psii = std::complex< double >( funcs[ 2 ], funcs[ 3 ] );
+    norm = ( _hasResolution && _perEventRes ) ?
+           _normp * funcs[ 4 ] + _normm * funcs[ 5 ] + 2.0 * std::real( _normi * std::complex< double >( funcs[ 6 ], funcs[ 7 ] ) ) :
+           _norm;
+  }
+  else
+    timeFuncs( cacheR[ _timeCache ], cacheR[ _timeCache + 1 ], psip, psim, psii, norm );
 
-  // Calculate the squared amplitude.
-  double ampSq = 0.0;
-  ampSq += std::norm( apb2 ) * psip( t );
-  ampSq += std::norm( amb2 ) * psim( t );
-  ampSq += 2.0 * std::real( apb2 * amb2 * psii( t ) );
+  const double& value = ampSq( ampDir, ampCnj, psip, psim, psii );
 
   // Evaluate the efficiency functions. Could be cached if necessary.
-  double funcs;
-  const std::size_t& size = vars.size();
-  if ( size == 3 )
-    funcs = evaluateFuncs( vars[ 0 ], vars[ 1 ] );
-  else if ( size == 4 )
-    funcs = evaluateFuncs( vars[ 0 ], vars[ 1 ], vars[ 2 ] );
-  else
-    throw PdfException( "Decay3BodyMix can only take either 3 or 4 arguments." );
-
-  return ampSq * funcs / _norm;
+  return value * evaluateFuncs( mSq12, mSq13, mSq23 ) / norm;
 }
 
 
@@ -464,69 +980,128 @@ const Decay3BodyMix operator*( const Function& left, Decay3BodyMix right )
 
 
 
-const std::map< std::string, double > Decay3BodyMix::generate() const throw( PdfException )
+const std::map< std::string, double > Decay3BodyMix::generate( RandomStream& stream ) const throw( PdfException )
 {
-  // Generate mSq12 and mSq13, and compute mSq23 from these.
-  const double& min12 = std::pow( _ps.m1()      + _ps.m2(), 2 );
-  const double& min13 = std::pow( _ps.m1()      + _ps.m3(), 2 );
-  const double& max12 = std::pow( _ps.mMother() - _ps.m3(), 2 );
-  const double& max13 = std::pow( _ps.mMother() - _ps.m2(), 2 );
+  return generateEvent( stream );
+}
 
-  // Maximum value of the pdf.
-  const double& max = _maxPdf * tau();
+
+// Accept-reject in batches: candidates are drawn from the proposal of the sampler for
+//    all the events left in the block, scaled by the inverse of the acceptance observed
+//    so far, and the pdf is evaluated for the whole batch before applying the decisions.
+void Decay3BodyMix::generateBlock( RandomStream&                            stream ,
+                                   const std::size_t&                       count  ,
+                                   const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* mSq12col = columns.at( _mSq12 );
+  double* mSq13col = columns.at( _mSq13 );
+  double* mSq23col = columns.at( _mSq23 );
+  double* timecol  = columns.at( _t     );
+
+  if ( _hasResolution && _perEventRes )
+    throw PdfException( "Decay3BodyMix: cannot generate events with a per-event resolution." );
 
   // Sum of squared invariant masses of all particles (mother and daughters).
   const double& mSqSum = _ps.mSqSum();
 
-  double mSq12  = 0.0;
-  double mSq13  = 0.0;
-  double mSq23  = 0.0;
-  double gammat = 0.0;
-  double time   = 0.0;
+  // Time is generated according to q(t) = e^[ - ( 1 - |x| ) Gamma t ].
+  const double& slope  = 1.0 - std::abs( x() );
+  const double& vgamma = gamma();
+  const double& vtau   = tau();
+
+  // With a resolution, the true time is generated from the pdf without resolution and
+  //    smeared afterwards, and events are kept if the smeared time is within the limits.
+  const std::function< double ( const double&, const double&, const double&, const double& ) > truePdf =
+    [ this ]( const double& mSq12, const double& mSq13, const double& mSq23, const double& t )
+    {
+      return this->_hasResolution ? this->evaluateUnnorm( mSq12, mSq13, mSq23, t, 0.0 ) / this->_norm :
+                                    this->evaluate      ( mSq12, mSq13, mSq23, t                    );
+    };
 
-  double pdfVal = 0.0;
+  // Ratio of p(t) to q(t), in units of tau, such that a maximum of the pdf set by hand
+  //    keeps its meaning.
+  const DalitzSampler::target_type target = [ &truePdf, mSqSum, slope, vgamma, vtau ]( RandomStream& stream, const double& mSq12, const double& mSq13 )
+  {
+    const double& gammat = - std::log( stream.flat() ) / slope;
+    return truePdf( mSq12, mSq13, mSqSum - mSq12 - mSq13, gammat / vgamma ) * std::exp( slope * gammat ) / vtau;
+  };
+
+  // Bound of the ratio of the pdf to the proposal. If a candidate exceeds it, the events
+  //    accepted so far in the block follow a distorted distribution, so the envelope of
+  //    the sampler is raised for all the blocks that follow and the block is generated
+  //    again.
+  double envelope = _sampler.envelope( target );
+
+  std::vector< double > mSq12;
+  std::vector< double > mSq13;
+  std::vector< double > gammat;
+  std::vector< double > time;
+  std::vector< double > ratio;
+
+  std::size_t filled   = 0;
+  std::size_t tried    = 0;
+  std::size_t accepted = 0;
 
   // Attempts to generate an event.
-  unsigned count = 10000;
+  std::size_t attempts = 0;
 
-  std::map< std::string, double > values;
-
-  while ( count-- )
+  while ( filled < count )
   {
-    // Generate uniform mSq12 and mSq13.
-    mSq12 = Random::flat( min12, max12 );
-    mSq13 = Random::flat( min13, max13 );
-    mSq23 = mSqSum - mSq12 - mSq13;
+    const std::size_t  batch = std::min( ( count - filled ) * ( tried + 1 ) / ( accepted + 1 ), maxBatch );
+
+    // Draw mSq12 and mSq13 from the proposal, keeping its density, and exponential time.
+    mSq12 .resize( batch );
+    mSq13 .resize( batch );
+    gammat.resize( batch );
+    time  .resize( batch );
+    ratio .resize( batch );
+    for ( std::size_t cand = 0; cand < batch; ++cand )
+    {
+      ratio [ cand ] = _sampler.propose( stream, mSq12[ cand ], mSq13[ cand ] );
+      gammat[ cand ] = - std::log( stream.flat() ) / slope;
+      time  [ cand ] = gammat[ cand ] / vgamma;
+      if ( _hasResolution )
+        time[ cand ] += stream.normal( 0.0, _resVal );
+    }
 
-    // Generate time according to q(t) = e^[ - ( 1 - |x| ) Gamma t ]
-    gammat = - std::log( Random::flat() ) / ( 1.0 - std::abs( x() ) );
-    time   = gammat / gamma();
+    // Prepare to run accept-reject on p(t) / q(t). Candidates outside the phase space,
+    //    or with a smeared time outside the limits, are marked with a negative value.
+    for ( std::size_t cand = 0; cand < batch; ++cand )
+    {
+      const double& mSq23 = mSqSum - mSq12[ cand ] - mSq13[ cand ];
+      ratio[ cand ] = ( _ps.contains( mSq12[ cand ], mSq13[ cand ], mSq23 ) &&
+                        ( time[ cand ] >= lowerLimit() ) && ( time[ cand ] <= upperLimit() ) ) ?
+                      truePdf( mSq12[ cand ], mSq13[ cand ], mSq23, gammat[ cand ] / vgamma ) *
+                      std::exp( slope * gammat[ cand ] ) / vtau / ratio[ cand ] : -1.0;
+    }
 
-    // Prepare to run accept-reject on p(t) / q(t).
-    pdfVal = this->evaluate( mSq12, mSq13, mSq23, time ) * std::exp( ( 1.0 - std::abs( x() ) ) * gammat );
+    for ( std::size_t cand = 0; ( cand < batch ) && ( filled < count ); ++cand )
+    {
+      ++tried;
+      ++attempts;
 
-    // Complain if the maximum value of the pdf was not properly estimated.
-    if ( pdfVal > max )
-      std::cout << "Problem: " << pdfVal << " > " << max
-                << " for ( " << mSq12 << ", " << mSq13 << ", " << mSq23 << ", " << time << " )" << std::endl;
+      if ( ratio[ cand ] > envelope )
+      {
+        envelope = _sampler.raise( ratio[ cand ] );
+        filled   = 0;
+        attempts = 0;
+        break;
+      }
 
-    // Apply the accept-reject decision.
-    if ( Random::flat( 0.0, max ) < pdfVal )
-    {
-      values[ _mSq12 ] = mSq12;
-      values[ _mSq13 ] = mSq13;
-      values[ _mSq23 ] = mSq23;
-      values[ _t     ] = time;
-      return values;
+      // Apply the accept-reject decision.
+      if ( ( ratio[ cand ] >= 0.0 ) && ( stream.flat( 0.0, envelope ) < ratio[ cand ] ) )
+      {
+        mSq12col[ filled ] = mSq12[ cand ];
+        mSq13col[ filled ] = mSq13[ cand ];
+        mSq23col[ filled ] = mSqSum - mSq12[ cand ] - mSq13[ cand ];
+        timecol [ filled ] = time[ cand ];
+        ++filled;
+        ++accepted;
+        attempts = 0;
+      }
+      else if ( attempts == 10000 )
+        throw PdfException( "Decay3BodyMix::generateBlock: too many attempts to generate an event." );
     }
   }
-
-  std::cout << "Problem: too many attempts" << std::endl;
-  values[ _mSq12 ] = 0.0;
-  values[ _mSq13 ] = 0.0;
-  values[ _mSq23 ] = 0.0;
-  values[ _t     ] = 0.0;
-
-  return values;
 }
 
@@ -60,6 +60,7 @@ void DoubleCrystalBall::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -69,6 +70,7 @@ void DoubleCrystalBall::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -80,6 +82,7 @@ void DoubleCrystalBall::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -88,6 +91,7 @@ void DoubleCrystalBall::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -96,6 +100,7 @@ void DoubleCrystalBall::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -105,6 +110,7 @@ void DoubleCrystalBall::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -168,6 +174,8 @@ const double DoubleCrystalBall::cumulativeNorm( const double& x ) const
 
 void DoubleCrystalBall::cache()
 {
+  invalidate();
+
   // Evaluate the area up to the lower limit (0 if it's -infinity).
   double areaLo = 0.0;
   if ( _hasLower )
@@ -296,8 +304,8 @@ const double DoubleCrystalBall::evaluate( const std::vector< double >& vars ) co
 
 
 const double DoubleCrystalBall::evaluate( const std::vector< double >&                 vars  ,
-                                          const std::vector< double >&                 cacheR,
-                                          const std::vector< std::complex< double > >& cacheC ) const throw( PdfException )
+                                          const double*                                cacheR,
+                                          const std::complex< double >*                cacheC ) const throw( PdfException )
 {
   if ( ! _doCache )
     return evaluate( vars );
@@ -328,8 +336,20 @@ const double DoubleCrystalBall::area( const double& min, const double& max ) con
 
 
 
-const std::map< std::string, double > DoubleCrystalBall::generate() const throw( PdfException )
+const std::map< std::string, double > DoubleCrystalBall::generate( RandomStream& stream ) const throw( PdfException )
+{
+  return generateEvent( stream );
+}
+
+
+// Inverse of the cumulative distribution, applied to a block of flat random numbers.
+void DoubleCrystalBall::generateBlock( RandomStream&                            stream ,
+                                       const std::size_t&                       count  ,
+                                       const std::map< std::string, double* >& columns ) const throw( PdfException )
 {
+  double* column = columns.at( getVar( 0 ).name() );
+
+  const double& vmu    = mu();
   const double& vn     = n();
   const double& vnm1   = vn - 1.0;
   const double& vm     = m();
@@ -351,28 +371,27 @@ const std::map< std::string, double > DoubleCrystalBall::generate() const throw(
   // Useful factor used in the generation of numbers in the upper tail.
   const double& coefHi = vsigma / ( vbeta * _norm ) * vm / vmm1 * std::exp( - std::pow( vbeta, 2 ) / 2.0 );
 
-  // Generate a flat random number.
-  std::uniform_real_distribution< double > dist( 0.0, 1.0 );
-  const double& unif = dist( Random::engine() ) + areaLo;
+  // Terms of the inverse of the core.
+  const double& coreCoef   = _norm / vsigma * std::sqrt( 2.0 / M_PI );
+  const double& coreOffset = std::erf( valpha / sqrt2 );
 
-  double genVal = 0.0;
+  // Generate flat random numbers.
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = stream.flat() + areaLo;
 
-  // If random number is below the lower tail-core threshold, generate the lower tail.
+  // If a random number is below the lower tail-core threshold, generate the lower tail.
   //    If it's above the upper tail-core threshold, generate the upper tail.
   //    Otherwise, generate the (Gaussian) core.
-  if ( unif < areaTh1 )
-    genVal = mu() - valpha * vsigma - vn * vsigma / valpha * ( std::pow( areaTh1 / unif                      , 1.0 / vnm1 ) - 1.0 );
-  else if ( unif > areaTh2 )
-    genVal = mu() + vbeta  * vsigma + vm * vsigma / vbeta  * ( std::pow( coefHi / ( areaTh2 + coefHi - unif ), 1.0 / vmm1 ) - 1.0 );
-  else
-    genVal = mu() + vsigma * sqrt2 * Math::inverf( _norm / vsigma * std::sqrt( 2.0 / M_PI ) * ( unif - areaTh1 ) -
-                                                   std::erf( valpha / sqrt2 ) );
-
-  // Fill the map with the generated value.
-  std::map< std::string, double > gen;
-  gen[ getVar( 0 ).name() ] = genVal;
-
-  return gen;
+  for ( std::size_t entry = 0; entry < count; ++entry )
+  {
+    const double& unif = column[ entry ];
+    if ( unif < areaTh1 )
+      column[ entry ] = vmu - valpha * vsigma - vn * vsigma / valpha * ( std::pow( areaTh1 / unif                      , 1.0 / vnm1 ) - 1.0 );
+    else if ( unif > areaTh2 )
+      column[ entry ] = vmu + vbeta  * vsigma + vm * vsigma / vbeta  * ( std::pow( coefHi / ( areaTh2 + coefHi - unif ), 1.0 / vmm1 ) - 1.0 );
+    else
+      column[ entry ] = vmu + vsigma * sqrt2 * Math::inverf( coreCoef * ( unif - areaTh1 ) - coreOffset );
+  }
 }
 
 
@@ -4,11 +4,13 @@
 
 #include <cfit/random.hh>
 
+#include <complex>
+
 ExpoGauss::ExpoGauss( const Variable&  x ,
                       const Parameter& gamma, const Parameter& mu, const Parameter& sigma )
   : _gamma( gamma ), _mu( mu ), _sigma( sigma ),
     _hasLower( false ), _hasUpper( false ), _lower( 0.0 ), _upper( 0.0 ),
-    _normExpo( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 )
+    _normExpo( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 ), _gammaVal( 0.0 ), _muVal( 0.0 ), _sigmaVal( 0.0 )
 {
   push( x );
 
@@ -24,7 +26,7 @@ ExpoGauss::ExpoGauss( const Variable&  x ,
                       const ParameterExpr& gamma, const ParameterExpr& mu, const ParameterExpr& sigma )
   : _gamma( gamma ), _mu( mu ), _sigma( sigma ),
     _hasLower( false ), _hasUpper( false ), _lower( 0.0 ), _upper( 0.0 ),
-    _normExpo( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 )
+    _normExpo( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 ), _gammaVal( 0.0 ), _muVal( 0.0 ), _sigmaVal( 0.0 )
 {
   push( x );
 
@@ -52,6 +54,7 @@ void ExpoGauss::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -61,6 +64,7 @@ void ExpoGauss::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -72,6 +76,7 @@ void ExpoGauss::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -80,6 +85,7 @@ void ExpoGauss::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -88,6 +94,7 @@ void ExpoGauss::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -97,70 +104,62 @@ void ExpoGauss::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
 
 void ExpoGauss::cache()
 {
+  invalidate();
+
+  _gammaVal = gamma();
+  _muVal    = mu();
+  _sigmaVal = sigma();
+
   // Evaluate the norm of the exponential.
-  _normExpo = 1.0 / gamma();
+  _normExpo = 1.0 / _gammaVal;
 
   // Evaluate the norm of the Gaussian.
-  _normGauss = sigma() * std::sqrt( 2.0 * M_PI );
+  _normGauss = _sigmaVal * std::sqrt( 2.0 * M_PI );
 
-  // If no lower or upper limit has been set, the pdf is already normalized to 1.
-  if ( ( ! _hasLower ) && ( ! _hasUpper ) )
-  {
-    _norm = 1.0;
-    return;
-  }
+  // The integral of the pdf is analytical, so the norm is its difference between the
+  //    limits, or 1 if no lower or upper limit has been set.
+  const double& lower = _hasLower ? cumulative( _lower ) : 0.0;
+  const double& upper = _hasUpper ? cumulative( _upper ) : 1.0;
 
-  // Fast references to mu and sigma gaussian parameters.
-  const double& vmu    = mu();
-  const double& vsigma = sigma();
+  _norm = upper - lower;
+}
 
-  // If the pdf has limits, define the integration technique.
-  const unsigned& nbin = 300;
 
-  // Approximate minus infinity to ( mu - 5 sigma ), which is 5 sigma away from the riseup of the pdf.
-  const double& minusInf = vmu - 5.0 * vsigma;
+// Exponential convolved with a Gaussian,
+//
+//    gamma exp( gamma^2 sigma^2 / 2 - gamma ( x - mu ) ) erfc( y ) / 2,
+//
+//    with y = ( gamma sigma - ( x - mu ) / sigma ) / sqrt( 2 ). Far on the left side of
+//    the Gaussian, the exponential overflows while erfc underflows, and the product is
+//    computed as exp( - ( x - mu )^2 / ( 2 sigma^2 ) ) w( i y ), with
+//    w( i y ) = exp( y^2 ) erfc( y ).
+const double ExpoGauss::tail( const double& x ) const
+{
+  const double& dx = x - _muVal;
+  const double& y  = ( _gammaVal * _sigmaVal - dx / _sigmaVal ) / std::sqrt( 2.0 );
 
-  // If an upper limit has been set, integrate from the lower limit and assume it's
-  //    mu - 5 sigma if it has not been set.
-  if ( _hasUpper )
-  {
-    const double& lower = _hasLower ? _lower : minusInf;
-    const double& dx    = ( _upper - lower ) / double( nbin );
+  if ( y > 20.0 )
+    return std::exp( - std::pow( dx / _sigmaVal, 2 ) / 2.0 ) * std::real( Math::faddeeva( std::complex< double >( 0.0, y ) ) ) / 2.0 / _normExpo;
 
-    _norm = 0.0;
-    for ( double x = lower; x < _upper; x += dx )
-      _norm += expogauss( x );
-    _norm *= dx;
+  return std::exp( std::pow( _gammaVal * _sigmaVal, 2 ) / 2.0 - _gammaVal * dx ) * std::erfc( y ) / 2.0 / _normExpo;
+}
 
-    return;
-  }
 
-  // If the pdf has a lower limit but not an upper limit, normalize by integrating from
-  //    5 sigmas from the left and subtract it from 1.
-  if ( _hasLower && ( ! _hasUpper ) )
-  {
-    // If the lower limit is very far away from the riseup of the pdf, the norm is 1.
-    if ( _lower < minusInf )
-    {
-      _norm = 1.0;
-      return;
-    }
-
-    // Otherwise, integrate from minus infinity to the lower limit.
-    const double& dx = ( _lower - minusInf ) / double( nbin );
-    _norm = 0.0;
-    for ( double x = minusInf; x < _lower; x += dx )
-      _norm += expogauss( x );
-    _norm = 1.0 - _norm * dx;
-
-    return;
-  }
+// The integral from minus infinity is the Gaussian cumulative distribution minus the
+//    pdf divided by gamma.
+const double ExpoGauss::cumulative( const double& x ) const
+{
+  if ( std::isinf( x ) )
+    return ( x > 0.0 ) ? 1.0 : 0.0;
+
+  return std::erfc( - ( x - _muVal ) / ( _sigmaVal * std::sqrt( 2.0 ) ) ) / 2.0 - tail( x ) * _normExpo;
 }
 
 
@@ -171,18 +170,7 @@ const double ExpoGauss::expogauss( const double& x ) const
   if ( _hasUpper && ( x > _upper ) )
     return 0.0;
 
-  const double& vgamma = gamma();
-  const double& vmu    = mu();
-  const double& vsigma = sigma();
-  const double& sqrt2  = std::sqrt( 2.0 );
-
-  const double& vgammaSq = std::pow( vgamma, 2 );
-  const double& vsigmaSq = std::pow( vsigma, 2 );
-
-  const double& expo    = std::exp( - vgamma * ( x - vmu ) + vgammaSq * vsigmaSq / 2.0 );
-  const double& erfFrac = ( 1.0 + std::erf( ( x - vmu - vgamma * vsigmaSq ) / ( vsigma * sqrt2 ) ) ) / 2.0;
-
-  return expo * erfFrac / _normExpo;
+  return tail( x );
 }
 
 
@@ -212,38 +200,43 @@ const double ExpoGauss::area( const double& min, const double& max ) const throw
   const double& xmin = _hasLower ? std::max( min, _lower ) : min;
   const double& xmax = _hasUpper ? std::min( max, _upper ) : max;
 
-  // Define the precision.
-  const unsigned& nbin = 300;
-  const double& dx = ( xmax - xmin ) / double( nbin );
-
-  // Do the integral.
-  double retval = 0.0;
-  for ( double x = xmin; x < xmax; x += dx )
-    retval += evaluate( x );
+  if ( ! ( xmax > xmin ) )
+    return 0.0;
 
-  return retval * dx;
+  return ( cumulative( xmax ) - cumulative( xmin ) ) / _norm;
 }
 
 
-const std::map< std::string, double > ExpoGauss::generate() const throw( PdfException )
+const std::map< std::string, double > ExpoGauss::generate( RandomStream& stream ) const throw( PdfException )
 {
-  double x = 0.0;
+  return generateEvent( stream );
+}
 
-  bool withinLimits = false;
-  while ( ! withinLimits )
-  {
-    // Add an Argus distributed variable and a Gaussian variable.
-    x = -std::log( Random::flat() ) / gamma() + Random::normal( mu(), sigma() );
 
-    // Check if the result is within limits, if any.
-    withinLimits = true;
-    withinLimits &= ( ! _hasLower ) || ( x > _lower );
-    withinLimits &= ( ! _hasUpper ) || ( x < _upper );
-  }
+// Generate candidates for all the entries left in the block, and keep those within the
+//    limits until the block is full.
+void ExpoGauss::generateBlock( RandomStream&                            stream ,
+                               const std::size_t&                       count  ,
+                               const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* column = columns.at( getVar( 0 ).name() );
 
-  // Fill a map with the generated value.
-  std::map< std::string, double > gen;
-  gen[ getVar( 0 ).name() ] = x;
+  const double& vgamma = gamma();
+  const double& vmu    = mu();
+  const double& vsigma = sigma();
 
-  return gen;
+  std::size_t filled = 0;
+  while ( filled < count )
+  {
+    // Add an exponentially distributed variable and a Gaussian variable.
+    for ( std::size_t entry = filled; entry < count; ++entry )
+      column[ entry ] = - std::log( stream.flat() ) / vgamma;
+    for ( std::size_t entry = filled; entry < count; ++entry )
+      column[ entry ] += stream.normal( vmu, vsigma );
+
+    // Keep the results within limits, if any.
+    for ( std::size_t entry = filled; entry < count; ++entry )
+      if ( ( ! _hasLower || ( column[ entry ] > _lower ) ) && ( ! _hasUpper || ( column[ entry ] < _upper ) ) )
+        column[ filled++ ] = column[ entry ];
+  }
 }
@@ -1,4 +1,6 @@
 
+#include <limits>
+
 #include <cfit/models/exponential.hh>
 #include <cfit/math.hh>
 
@@ -61,6 +63,7 @@ void Exponential::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -70,6 +73,7 @@ void Exponential::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -81,6 +85,7 @@ void Exponential::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -89,6 +94,7 @@ void Exponential::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -97,6 +103,7 @@ void Exponential::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -106,12 +113,15 @@ void Exponential::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
 
 void Exponential::cache()
 {
+  invalidate();
+
   // Compute the norm as ( exp( - gamma x_min ) - exp( - gamma x_max ) ) / gamma.
   // Within the standard range ( 0, +infinity ), the norm is 1/gamma.
   const double& vgamma = gamma();
@@ -124,7 +134,8 @@ void Exponential::cache()
   if ( _hasUpper )
     expmax = std::exp( - vgamma * _upper );
 
-  _norm = ( expmin - expmax ) / vgamma;
+  _norm    = ( expmin - expmax ) / vgamma;
+  _logNorm = std::log( _norm );
 }
 
 
@@ -153,6 +164,31 @@ const double Exponential::evaluate( const std::vector< double >& vars ) const th
 }
 
 
+const double Exponential::evaluateLog( const double& x ) const throw( PdfException )
+{
+  // Return -infinity if x is outside the upper or lower limits.
+  if ( _hasLower )
+  {
+    if ( x < _lower )
+      return - std::numeric_limits< double >::infinity();
+  }
+  else
+    if ( x < 0.0 )
+      return - std::numeric_limits< double >::infinity();
+
+  if ( _hasUpper && ( x > _upper ) )
+    return - std::numeric_limits< double >::infinity();
+
+  return - gamma() * x - _logNorm;
+}
+
+
+const double Exponential::evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+{
+  return evaluateLog( vars[ 0 ] );
+}
+
+
 void Exponential::setParExpr()
 {
   _gamma.setPars( _parMap );
@@ -165,9 +201,13 @@ const double Exponential::area( const double& min, const double& max ) const thr
   // Within the standard range ( 0, +infinity ), the norm is 1/gamma.
   const double& vgamma = gamma();
 
-  const double& xmin = _hasLower ? std::max( min, _lower ) : min;
+  // Without a lower limit, the pdf starts at zero.
+  const double  xmin = std::max( min, _hasLower ? _lower : 0.0 );
   const double& xmax = _hasUpper ? std::min( max, _upper ) : max;
 
+  if ( xmax <= xmin )
+    return 0.0;
+
   const double& expmin = std::exp( - vgamma * xmin );
   const double& expmax = std::exp( - vgamma * xmax );
 
@@ -175,18 +215,27 @@ const double Exponential::area( const double& min, const double& max ) const thr
 }
 
 
-const std::map< std::string, double > Exponential::generate() const throw( PdfException )
+const std::map< std::string, double > Exponential::generate( RandomStream& stream ) const throw( PdfException )
 {
-  // Generate a flat random number.
-  std::uniform_real_distribution< double > dist( 0.0, 1.0 );
-  const double& unif = dist( Random::engine() );
+  return generateEvent( stream );
+}
+
+
+// Inverse of the cumulative distribution, applied to a block of flat random numbers.
+void Exponential::generateBlock( RandomStream&                            stream ,
+                                 const std::size_t&                       count  ,
+                                 const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* column = columns.at( getVar( 0 ).name() );
+
+  // Generate flat random numbers.
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = stream.flat();
 
   const double& vgamma = gamma();
 
   const double& expmin = _hasLower ? std::exp( - vgamma * _lower ) : 1.0;
 
-  std::map< std::string, double > gen;
-  gen[ getVar( 0 ).name() ] = - 1.0 / vgamma * std::log( expmin - _norm * vgamma * unif );
-
-  return gen;
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = - 1.0 / vgamma * std::log( expmin - _norm * vgamma * column[ entry ] );
 }
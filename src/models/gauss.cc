@@ -1,4 +1,6 @@
 
+#include <limits>
+
 #include <cfit/models/gauss.hh>
 #include <cfit/math.hh>
 
@@ -79,6 +81,7 @@ void Gauss::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -88,6 +91,7 @@ void Gauss::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -99,6 +103,7 @@ void Gauss::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -107,6 +112,7 @@ void Gauss::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -115,6 +121,7 @@ void Gauss::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -124,12 +131,15 @@ void Gauss::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
 
 void Gauss::cache()
 {
+  invalidate();
+
   const double& vmu    = mu();
   const double& vsigma = sigma();
   const double& sqrt2  = std::sqrt( 2.0 );
@@ -143,7 +153,8 @@ void Gauss::cache()
     argmax = 1.0 + Math::erf( ( _upper - vmu ) / ( vsigma * sqrt2 ) );
 
   const double& factor = vsigma * std::sqrt( M_PI / 2.0 );
-  _norm = factor * ( argmax - argmin );
+  _norm    = factor * ( argmax - argmin );
+  _logNorm = std::log( _norm );
 }
 
 
@@ -183,8 +194,8 @@ const double Gauss::evaluate( const std::vector< double >& vars ) const throw( P
 
 
 const double Gauss::evaluate( const std::vector< double >&                 vars  ,
-                              const std::vector< double >&                 cacheR,
-                              const std::vector< std::complex< double > >& cacheC ) const throw( PdfException )
+                              const double*                                cacheR,
+                              const std::complex< double >*                cacheC ) const throw( PdfException )
 {
   if ( ! _doCache )
     return evaluate( vars );
@@ -193,6 +204,29 @@ const double Gauss::evaluate( const std::vector< double >&                 vars
 }
 
 
+const double Gauss::evaluateLog( const double& x ) const throw( PdfException )
+{
+  return - 0.5 * pow( x - mu(), 2 ) / pow( sigma(), 2 ) - _logNorm;
+}
+
+
+const double Gauss::evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+{
+  return evaluateLog( vars[ 0 ] );
+}
+
+
+const double Gauss::evaluateLog( const std::vector< double >&                 vars  ,
+                                 const double*                                cacheR,
+                                 const std::complex< double >*                cacheC ) const throw( PdfException )
+{
+  if ( ! _doCache )
+    return evaluateLog( vars );
+
+  return std::log( cacheR[ _cacheIdx ] );
+}
+
+
 void Gauss::setParExpr()
 {
   _mu   .setPars( _parMap );
@@ -218,11 +252,22 @@ const double Gauss::area( const double& min, const double& max ) const throw( Pd
 }
 
 
-const std::map< std::string, double > Gauss::generate() const throw( PdfException )
+const std::map< std::string, double > Gauss::generate( RandomStream& stream ) const throw( PdfException )
+{
+  return generateEvent( stream );
+}
+
+
+void Gauss::generateBlock( RandomStream&                            stream ,
+                           const std::size_t&                       count  ,
+                           const std::map< std::string, double* >& columns ) const throw( PdfException )
 {
-  std::normal_distribution< double > dist( mu(), sigma() );
-  std::map< std::string, double > gen;
-  gen[ getVar( 0 ).name() ] = dist( Random::engine() );
-  return gen;
+  double* column = columns.at( getVar( 0 ).name() );
+
+  const double& vmu    = mu();
+  const double& vsigma = sigma();
+
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = stream.normal( vmu, vsigma );
 }
 
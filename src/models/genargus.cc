@@ -1,4 +1,6 @@
 
+#include <limits>
+
 #include <cfit/models/genargus.hh>
 #include <cfit/math.hh>
 
@@ -49,6 +51,7 @@ void GenArgus::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -61,6 +64,7 @@ void GenArgus::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -78,6 +82,7 @@ void GenArgus::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -86,6 +91,7 @@ void GenArgus::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -94,6 +100,7 @@ void GenArgus::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -103,12 +110,15 @@ void GenArgus::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
 
 void GenArgus::cache()
 {
+  invalidate();
+
   const double& vc    = c();
   const double& cSq    = std::pow( c()  , 2 );
   const double& chiSq  = std::pow( chi(), 2 );
@@ -125,7 +135,8 @@ void GenArgus::cache()
   //    between upper and lower.
   if ( chiSq == 0.0 )
   {
-    _norm = cSq / ( 2.0 * pPlus1 ) * ( std::pow( argmax, pPlus1 ) - std::pow( argmin, pPlus1 ) );
+    _norm    = cSq / ( 2.0 * pPlus1 ) * ( std::pow( argmax, pPlus1 ) - std::pow( argmin, pPlus1 ) );
+    _logNorm = std::log( _norm );
     return;
   }
 
@@ -134,6 +145,8 @@ void GenArgus::cache()
   // Since gamma_p( a, x ) is normalized to Gamma( a ), multiply by Gamma( p + 1 ).
   _norm  = cSq / ( 2.0 * chiPow ) * Math::gamma( pPlus1 );
   _norm *= ( Math::gamma_p( pPlus1, chiSq * argmax ) - Math::gamma_p( pPlus1, chiSq * argmin ) );
+
+  _logNorm = std::log( _norm );
 }
 
 
@@ -168,6 +181,37 @@ const double GenArgus::evaluate( const std::vector< double >& vars ) const throw
 }
 
 
+const double GenArgus::evaluateLog( const double& x ) const throw( PdfException )
+{
+  const double& vc   = c();
+  const double& vchi = chi();
+
+  if ( _hasLower && ( x < _lower ) )
+    return - std::numeric_limits< double >::infinity();
+
+  if ( _hasUpper && ( x > _upper ) )
+    return - std::numeric_limits< double >::infinity();
+
+  if ( ( x < 0.0 ) || ( x > vc ) )
+    return - std::numeric_limits< double >::infinity();
+
+  const double& cSq   = std::pow( vc  , 2 );
+  const double& chiSq = std::pow( vchi, 2 );
+
+  const double& xSq = std::pow( x, 2 );
+
+  const double& diff = 1.0 - xSq / cSq;
+
+  return std::log( x ) + p() * std::log( diff ) - chiSq * diff - _logNorm;
+}
+
+
+const double GenArgus::evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+{
+  return evaluateLog( vars[ 0 ] );
+}
+
+
 
 void GenArgus::setParExpr()
 {
@@ -209,8 +253,19 @@ const double GenArgus::area( const double& min, const double& max ) const throw(
 }
 
 
-const std::map< std::string, double > GenArgus::generate() const throw( PdfException )
+const std::map< std::string, double > GenArgus::generate( RandomStream& stream ) const throw( PdfException )
 {
+  return generateEvent( stream );
+}
+
+
+// Inverse of the cumulative distribution, applied to a block of flat random numbers.
+void GenArgus::generateBlock( RandomStream&                            stream ,
+                              const std::size_t&                       count  ,
+                              const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  double* column = columns.at( getVar( 0 ).name() );
+
   const double& vc     = c();
   const double& cSq    = std::pow( c()  , 2 );
   const double& chiSq  = std::pow( chi(), 2 );
@@ -219,29 +274,25 @@ const std::map< std::string, double > GenArgus::generate() const throw( PdfExcep
   const double& lower  = _hasLower ? std::max( _lower, 0.0 ) : 0.0;
   const double& argmax = _hasLower ? 1.0 - std::pow( lower / vc, 2 ) : 1.0;
 
-  // Generate a flat random number.
-  const double& unif = Random::flat();
-
-  double genVal = 0.0;
-  std::map< std::string, double > gen;
+  // Generate flat random numbers.
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = stream.flat();
 
   // Deal with the special case where chi = 0.
   if ( chiSq == 0.0 )
   {
-    genVal = vc * std::sqrt( 1.0 - std::pow( argmax - _norm * unif * 2.0 * pPlus1 / cSq, 1.0 / pPlus1 ) );
-    gen[ getVar( 0 ).name() ] = genVal;
+    for ( std::size_t entry = 0; entry < count; ++entry )
+      column[ entry ] = vc * std::sqrt( 1.0 - std::pow( argmax - _norm * column[ entry ] * 2.0 * pPlus1 / cSq, 1.0 / pPlus1 ) );
 
-    return gen;
+    return;
   }
 
   // Define useful terms for the random number generation.
   const double& minTerm = Math::gamma_q( pPlus1, chiSq * argmax );
-  const double& rndTerm = _norm * unif * 2.0 * std::pow( chiSq, pPlus1 ) / cSq / std::tgamma( pPlus1 );
-
-  // Generate a random number.
-  genVal = vc * std::sqrt( 1.0 - Math::invgamma_q( pPlus1, minTerm + rndTerm ) / chiSq );
-  gen[ getVar( 0 ).name() ] = genVal;
+  const double& rndCoef = _norm * 2.0 * std::pow( chiSq, pPlus1 ) / cSq / std::tgamma( pPlus1 );
 
-  return gen;
+  // Generate the random numbers.
+  for ( std::size_t entry = 0; entry < count; ++entry )
+    column[ entry ] = vc * std::sqrt( 1.0 - Math::invgamma_q( pPlus1, minTerm + rndCoef * column[ entry ] ) / chiSq );
 }
 
@@ -11,7 +11,8 @@ GenArgusGauss::GenArgusGauss( const Variable&  x ,
                               const Parameter& mu, const Parameter& sigma )
   : _c( c ), _chi( chi ), _p( p ), _mu( mu ), _sigma( sigma ),
     _hasLower( false ), _hasUpper( false ), _lower( 0.0 ), _upper( 0.0 ),
-    _normGenArgus( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 ), _doCache( false ), _cacheIdx( 0 )
+    _normGenArgus( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 ), _cVal( 0.0 ), _muVal( 0.0 ), _sigmaVal( 0.0 ),
+    _degree( 0 ), _useGrid( false ), _gridMin( 0.0 ), _gridStep( 0.0 ), _doCache( false ), _cacheIdx( 0 )
 {
   push( x );
 
@@ -30,7 +31,8 @@ GenArgusGauss::GenArgusGauss( const Variable&  x ,
                               const ParameterExpr& mu, const ParameterExpr& sigma )
   : _c( c ), _chi( chi ), _p( p ), _mu( mu ), _sigma( sigma ),
     _hasLower( false ), _hasUpper( false ), _lower( 0.0 ), _upper( 0.0 ),
-    _normGenArgus( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 ), _doCache( false ), _cacheIdx( 0 )
+    _normGenArgus( 0.0 ), _normGauss( 0.0 ), _norm( 0.0 ), _cVal( 0.0 ), _muVal( 0.0 ), _sigmaVal( 0.0 ),
+    _degree( 0 ), _useGrid( false ), _gridMin( 0.0 ), _gridStep( 0.0 ), _doCache( false ), _cacheIdx( 0 )
 {
   push( x );
 
@@ -66,6 +68,7 @@ void GenArgusGauss::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   cache();
 }
 
@@ -78,6 +81,7 @@ void GenArgusGauss::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -95,6 +99,7 @@ void GenArgusGauss::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
@@ -103,6 +108,7 @@ void GenArgusGauss::unsetLowerLimit()
 {
   _hasLower = false;
 
+  invalidate();
   cache();
 }
 
@@ -111,6 +117,7 @@ void GenArgusGauss::unsetUpperLimit()
 {
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
@@ -120,14 +127,20 @@ void GenArgusGauss::unsetLimits()
   _hasLower = false;
   _hasUpper = false;
 
+  invalidate();
   cache();
 }
 
 
 void GenArgusGauss::cache()
 {
-  const double& vc     = c();
-  const double& cSq    = std::pow( vc   , 2 );
+  invalidate();
+
+  _cVal     = c();
+  _muVal    = mu();
+  _sigmaVal = sigma();
+
+  const double& cSq    = std::pow( _cVal, 2 );
   const double& chiSq  = std::pow( chi(), 2 );
   const double& pPlus1 = p() + 1.0;
 
@@ -136,19 +149,23 @@ void GenArgusGauss::cache()
   //    c^2 / ( 2 ( p + 1 ) ) ( 1 - x^2 / c^2 )^( p + 1 )
   //    between upper and lower.
   if ( chiSq == 0.0 )
-  {
     _normGenArgus = cSq / ( 2.0 * pPlus1 );
-    return;
+  else
+  {
+    const double& chiPow = std::pow( chiSq, pPlus1 );
+
+    // Since gamma_p( a, x ) is normalized to Gamma( a ), multiply by Gamma( p + 1 ).
+    _normGenArgus  = cSq / ( 2.0 * chiPow ) * Math::gamma( pPlus1 );
+    _normGenArgus *= ( Math::gamma_p( pPlus1, chiSq ) - Math::gamma_p( pPlus1, 0.0 ) );
   }
 
-  const double& chiPow = std::pow( chiSq, pPlus1 );
+  // Evaluate the norm of the Gaussian.
+  _normGauss = _sigmaVal * std::sqrt( 2.0 * M_PI );
 
-  // Since gamma_p( a, x ) is normalized to Gamma( a ), multiply by Gamma( p + 1 ).
-  _normGenArgus  = cSq / ( 2.0 * chiPow ) * Math::gamma( pPlus1 );
-  _normGenArgus *= ( Math::gamma_p( pPlus1, chiSq ) - Math::gamma_p( pPlus1, 0.0 ) );
+  cacheQuadrature();
 
-  // Evaluate the norm of the Gaussian.
-  _normGauss = sigma() * std::sqrt( 2.0 * M_PI );
+  if ( _useGrid )
+    cacheGrid();
 
   // If no lower or upper limit has been set, the pdf is already normalized to 1.
   if ( ( ! _hasLower ) && ( ! _hasUpper ) )
@@ -161,7 +178,7 @@ void GenArgusGauss::cache()
   _norm = 0.0;
   const unsigned& nbin = 300;
   const double& lower  = _hasLower ? std::max( _lower, 0.0 ) : 0.0;
-  const double& upper  = _hasUpper ? std::min( _upper, vc  ) : vc;
+  const double& upper  = _hasUpper ? std::min( _upper, _cVal ) : _cVal;
 
   const double& dx = ( upper - lower ) / double( nbin );
   for ( double x = lower; x < upper; x += dx )
@@ -171,7 +188,82 @@ void GenArgusGauss::cache()
 }
 
 
+// The roots and weights are only recomputed when the degree changes. The Argus core at
+//    the roots only depends on chi and p, so every point of the convolution then costs
+//    one exponential per root.
+void GenArgusGauss::cacheQuadrature()
+{
+  // Determine the required polynomial degree as the number of Gaussian sigmas
+  //    in the Argus range of definition (0,c).
+  const unsigned degree = 3.0 * _cVal / _sigmaVal;
+
+  if ( degree != _degree )
+  {
+    _degree = degree;
+    _roots  .clear();
+    _weights.clear();
+
+    // Determine the maximum relevant root to be used. For index k > degree/2,
+    //    the Chebyshev polynomial root is negative or zero, and the Argus pdf
+    //    evaluates to zero at these points. There's no need to evaluate it there.
+    for ( unsigned k = 1; k <= degree / 2; ++k )
+    {
+      _roots  .push_back(           std::cos( ( M_PI * k ) / ( degree + 1.0 ) )                                );
+      _weights.push_back( std::pow( std::sin( ( M_PI * k ) / ( degree + 1.0 ) ), 2 ) * M_PI / ( degree + 1.0 ) );
+    }
+  }
+
+  const double& cSq = std::pow( _cVal, 2 );
+
+  _terms.resize( _roots.size() );
+  for ( std::size_t k = 0; k < _roots.size(); ++k )
+    _terms[ k ] = cSq * _weights[ k ] * genarguscore( _roots[ k ] ) / _normGauss;
+}
+
+
+// The grid covers the limits, or the range where the convolution is not negligible if
+//    there are none, with 8 points per sigma of the Gaussian and at most 10000 points.
+void GenArgusGauss::gridRange( double& min, double& max, unsigned& size ) const
+{
+  min = _hasLower ? _lower : _muVal - 6.0 * _sigmaVal;
+  max = _hasUpper ? _upper : _muVal + 6.0 * _sigmaVal + _cVal;
+
+  const double& points = 8.0 * ( max - min ) / _sigmaVal;
+
+  size = ( points < 10000.0 ) ? unsigned( std::max( points, 0.0 ) ) + 2 : 10000;
+}
+
+
+void GenArgusGauss::cacheGrid()
+{
+  double   min;
+  double   max;
+  unsigned size;
+  gridRange( min, max, size );
+
+  // Only recompute the grid when the parameters or the range have changed.
+  std::vector< double > pars;
+  for ( unsigned par = 0; par < 5; ++par )
+    pars.push_back( getPar( par ).value() );
+  pars.push_back( min );
+  pars.push_back( max );
+
+  if ( ( pars == _gridPars ) && ( _gridValues.size() == size ) )
+    return;
+
+  _gridPars = pars;
+  _gridMin  = min;
+  _gridStep = ( max - min ) / ( size - 1 );
+
+  _gridValues.resize( size );
+  _gridDerivs.resize( size );
+  for ( unsigned point = 0; point < size; ++point )
+    genargusgauss( min + point * _gridStep, _gridValues[ point ], _gridDerivs[ point ] );
+}
+
+
 // Cache the values of the pdf at every point in the dataset, if the parameters are fixed.
+//    Otherwise, tabulate the convolution on a grid if it has fewer points than the dataset.
 const std::map< unsigned, std::vector< double > > GenArgusGauss::cacheReal( const Dataset& data )
 {
   // Determine whether the amplitudes should be cached, i.e. only if all their parameters are fixed.
@@ -182,7 +274,18 @@ const std::map< unsigned, std::vector< double > > GenArgusGauss::cacheReal( cons
   std::map< unsigned, std::vector< double > > cached;
 
   if ( ! _doCache )
+  {
+    double   min;
+    double   max;
+    unsigned size;
+    gridRange( min, max, size );
+
+    _useGrid = size < data.size();
+    if ( _useGrid )
+      cacheGrid();
+
     return cached;
+  }
 
   // Get an index for the cached complex amplitudes.
   _cacheIdx = _cacheIdxReal++;
@@ -237,47 +340,58 @@ const double GenArgusGauss::genarguscore( const double& x ) const
 }
 
 
-const double GenArgusGauss::gauss( const double& x ) const
-{
-  return std::exp( - 0.5 * pow( x - mu(), 2 ) / pow( sigma(), 2 ) ) / _normGauss;
-}
-
-
 const double GenArgusGauss::genargusgauss( const double& x ) const
 {
   // Evaluate the convolution of the generalized Argus pdf with a Gaussian
   //    using Gauss-Chebyshev quadrature.
-  const double& vc  = c();
-  const double& cSq = std::pow( vc, 2.0 );
+  double integ = 0.0;
+  for ( std::size_t k = 0; k < _terms.size(); ++k )
+    integ += _terms[ k ] * std::exp( - 0.5 * std::pow( ( x - _roots[ k ] * _cVal - _muVal ) / _sigmaVal, 2 ) );
 
-  // Determine the required polynomial degree as the number of Gaussian sigmas
-  //    in the Argus range of definition (0,c).
-  const unsigned& degree = 3.0 * vc / sigma();
+  return integ;
+}
 
-  // Determine the maximum relevant root to be used. For index k > degree/2,
-  //    the Chebyshev polynomial root is negative or zero, and the Argus pdf
-  //    evaluates to zero at these points. There's no need to evaluate it there.
-  const unsigned& maxRoot = degree / 2;
 
-  double root   = 0.0;
-  double weight = 0.0;
-  double integ  = 0.0;
-  for ( unsigned k = 1; k <= maxRoot; ++k )
+void GenArgusGauss::genargusgauss( const double& x, double& value, double& deriv ) const
+{
+  const double& sigmaSq = std::pow( _sigmaVal, 2 );
+
+  value = 0.0;
+  deriv = 0.0;
+  for ( std::size_t k = 0; k < _terms.size(); ++k )
   {
-    // Evaluate the polynomial roots and weights.
-    root   =           std::cos( ( M_PI * k ) / ( degree + 1.0 ) );
-    weight = std::pow( std::sin( ( M_PI * k ) / ( degree + 1.0 ) ), 2 ) * M_PI / ( degree + 1.0 );
+    const double& diff = x - _roots[ k ] * _cVal - _muVal;
+    const double& term = _terms[ k ] * std::exp( - 0.5 * std::pow( diff, 2 ) / sigmaSq );
 
-    // Accumulate the value of the integral.
-    integ += weight * genarguscore( root ) * gauss( x - root * vc );
+    value += term;
+    deriv -= term * diff / sigmaSq;
   }
-  integ *= cSq;
-
-  return integ;
 }
 
 
+// With 8 points per sigma, the relative error of the interpolation is of a few parts
+//    per million of the maximum of the convolution. Outside the grid, the convolution
+//    is evaluated by quadrature.
+const double GenArgusGauss::interpolate( const double& x ) const
+{
+  const double& position = ( x - _gridMin ) / _gridStep;
+  const unsigned  size     = _gridValues.size();
+
+  if ( ( position < 0.0 ) || ( position > size - 1 ) )
+    return genargusgauss( x );
+
+  const unsigned  point = std::min( unsigned( position ), size - 2 );
+  const double&   t     = position - point;
+  const double&   tSq   = t * t;
+  const double&   u     = 1.0 - t;
+  const double&   uSq   = u * u;
 
+  const double& value = ( 1.0 + 2.0 * t ) * uSq * _gridValues[ point     ] + t   * uSq * _gridStep * _gridDerivs[ point     ]
+                      + ( 1.0 + 2.0 * u ) * tSq * _gridValues[ point + 1 ] - tSq * u   * _gridStep * _gridDerivs[ point + 1 ];
+
+  // Remove the negative overshoots in the tails.
+  return std::max( value, 0.0 );
+}
 
 
 const double GenArgusGauss::evaluate( const double& x ) const throw( PdfException )
@@ -293,13 +407,16 @@ const double GenArgusGauss::evaluate( const std::vector< double >& vars ) const
 
 
 const double GenArgusGauss::evaluate( const std::vector< double >&                 vars  ,
-                                      const std::vector< double >&                 cacheR,
-                                      const std::vector< std::complex< double > >& cacheC ) const throw( PdfException )
+                                      const double*                                cacheR,
+                                      const std::complex< double >*                cacheC ) const throw( PdfException )
 {
-  if ( ! _doCache )
-    return evaluate( vars );
+  if ( _doCache )
+    return cacheR[ _cacheIdx ];
 
-  return cacheR[ _cacheIdx ];
+  if ( _useGrid )
+    return interpolate( vars[ 0 ] ) / _norm;
+
+  return evaluate( vars );
 }
 
 void GenArgusGauss::setParExpr()
@@ -309,20 +426,11 @@ void GenArgusGauss::setParExpr()
   _p    .setPars( _parMap );
   _mu   .setPars( _parMap );
   _sigma.setPars( _parMap );
-
-  // When parameters are set, no cached values are valid anymore.
-  _areas.clear();
 }
 
 
 const double GenArgusGauss::area( const double& min, const double& max ) const throw( PdfException )
 {
-  std::pair< double, double > range = std::make_pair( min, max );
-
-  // If any cached value can be used, use it.
-  if ( _areas.count( range ) )
-    return _areas.at( range );
-
   // Set the limits of integration.
   const double& xmin = _hasLower ? std::max( min, _lower ) : min;
   const double& xmax = _hasUpper ? std::min( max, _upper ) : max;
@@ -336,55 +444,55 @@ const double GenArgusGauss::area( const double& min, const double& max ) const t
   for ( double x = xmin; x < xmax; x += dx )
     retval += evaluate( x );
 
-  // Cache the calculation of the area for this range.
-  _areas[ range ] = retval * dx;
-
   return retval * dx;
 }
 
 
-const double GenArgusGauss::generateArgus() const
+const std::map< std::string, double > GenArgusGauss::generate( RandomStream& stream ) const throw( PdfException )
 {
-  const double& vc     = c();
-  const double& chiSq  = std::pow( chi(), 2 );
-  const double& pPlus1 = p() + 1.0;
-
-  // Generate a flat random number.
-  const double& unif = Random::flat();
-
-  std::map< std::string, double > gen;
-
-  // Deal with the special case where chi = 0.
-  if ( chiSq == 0.0 )
-    return vc * std::sqrt( 1.0 - std::pow( unif, 1.0 / pPlus1 ) );
-
-  // Define a useful term for the random number generation.
-  const double& rndTerm = 1.0 - unif * Math::gamma_p( pPlus1, chiSq );
-
-  // Generate a random number.
-  return vc * std::sqrt( 1.0 - Math::invgamma_q( pPlus1, rndTerm ) / chiSq );
+  return generateEvent( stream );
 }
 
 
-const std::map< std::string, double > GenArgusGauss::generate() const throw( PdfException )
+// Generate candidates for all the entries left in the block, and keep those within the
+//    limits until the block is full.
+void GenArgusGauss::generateBlock( RandomStream&                            stream ,
+                                   const std::size_t&                       count  ,
+                                   const std::map< std::string, double* >& columns ) const throw( PdfException )
 {
-  double x = 0.0;
+  double* column = columns.at( getVar( 0 ).name() );
 
-  bool withinLimits = false;
-  while ( ! withinLimits )
-  {
-    // Add an Argus distributed variable and a Gaussian variable.
-    x = generateArgus() + Random::normal( mu(), sigma() );
-
-    // Check if the result is within limits, if any.
-    withinLimits = true;
-    withinLimits &= ( ! _hasLower ) || ( x > _lower );
-    withinLimits &= ( ! _hasUpper ) || ( x < _upper );
-  }
+  const double& vc     = c();
+  const double& chiSq  = std::pow( chi(), 2 );
+  const double& pPlus1 = p() + 1.0;
+  const double& vmu    = mu();
+  const double& vsigma = sigma();
 
-  // Fill a map with the generated value.
-  std::map< std::string, double > gen;
-  gen[ getVar( 0 ).name() ] = x;
+  // Define a useful term for the generation of the Argus variable.
+  const double& rndCoef = ( chiSq == 0.0 ) ? 0.0 : Math::gamma_p( pPlus1, chiSq );
 
-  return gen;
+  std::size_t filled = 0;
+  while ( filled < count )
+  {
+    // Generate flat random numbers.
+    for ( std::size_t entry = filled; entry < count; ++entry )
+      column[ entry ] = stream.flat();
+
+    // Generate the Argus variable, dealing with the special case where chi = 0.
+    if ( chiSq == 0.0 )
+      for ( std::size_t entry = filled; entry < count; ++entry )
+        column[ entry ] = vc * std::sqrt( 1.0 - std::pow( column[ entry ], 1.0 / pPlus1 ) );
+    else
+      for ( std::size_t entry = filled; entry < count; ++entry )
+        column[ entry ] = vc * std::sqrt( 1.0 - Math::invgamma_q( pPlus1, 1.0 - column[ entry ] * rndCoef ) / chiSq );
+
+    // Add a Gaussian variable.
+    for ( std::size_t entry = filled; entry < count; ++entry )
+      column[ entry ] += stream.normal( vmu, vsigma );
+
+    // Keep the results within limits, if any.
+    for ( std::size_t entry = filled; entry < count; ++entry )
+      if ( ( ! _hasLower || ( column[ entry ] > _lower ) ) && ( ! _hasUpper || ( column[ entry ] < _upper ) ) )
+        column[ filled++ ] = column[ entry ];
+  }
 }
@@ -99,6 +99,7 @@ void Polynomial::setLowerLimit( const double& lower )
   _hasLower = true;
   _lower    = lower;
 
+  invalidate();
   // Run cache if both upper and lower limits are defined.
   if ( _hasUpper )
     cache();
@@ -110,6 +111,7 @@ void Polynomial::setUpperLimit( const double& upper )
   _hasUpper = true;
   _upper    = upper;
 
+  invalidate();
   // Run cache if both upper and lower limits are defined.
   if ( _hasLower )
     cache();
@@ -123,12 +125,15 @@ void Polynomial::setLimits( const double& lower, const double& upper )
   _lower    = lower;
   _upper    = upper;
 
+  invalidate();
   cache();
 }
 
 
 void Polynomial::cache()
 {
+  invalidate();
+
   if ( ! _hasLower || ! _hasUpper )
     throw PdfException( "Cannot evaluate polynomial without upper and lower limits defined." );
 
@@ -3,111 +3,178 @@
 
 #include <vector>
 #include <string>
-
-#ifdef MPI_ON
-#include <mpi.h>
-#endif
+#include <cmath>
+#include <limits>
 
 #include <cfit/variable.hh>
 #include <cfit/dataset.hh>
 #include <cfit/pdfmodel.hh>
+#include <cfit/parallel.hh>
 #include <cfit/nll.hh>
 
 
 Nll::Nll( const PdfModel& pdf, const Dataset& data )
-  : Minimizer( pdf, data )
+  : Minimizer( pdf, data ), _weightScale( 1.0 )
 {
   _up = 1.0;
 }
 
 
 Nll::Nll( const PdfExpr& pdf, const Dataset& data )
-  : Minimizer( pdf, data )
+  : Minimizer( pdf, data ), _weightScale( 1.0 )
+{
+  _up = 1.0;
+}
+
+
+Nll::Nll( const PdfModel& pdf, const Dataset& data, const std::size_t& chunkSize, const std::string& scratch )
+  : Minimizer( pdf, data, chunkSize, scratch ), _weightScale( 1.0 )
+{
+  _up = 1.0;
+}
+
+
+Nll::Nll( const PdfExpr& pdf, const Dataset& data, const std::size_t& chunkSize, const std::string& scratch )
+  : Minimizer( pdf, data, chunkSize, scratch ), _weightScale( 1.0 )
 {
   _up = 1.0;
 }
 
 
 Nll::Nll( const Nll& nll )
-  : Minimizer( nll )
+  : Minimizer( nll ), _weightScale( nll._weightScale )
 {}
 
 
-double Nll::operator()( const std::vector<double>& pars ) const throw( PdfException )
+void Nll::sumW2Correction( const bool& val )
 {
-  if ( pars.size() != _pdf->nPars() )
-    throw PdfException( "Number of parameters passed does not match number of required arguments." );
+  _weightScale = 1.0;
 
-  _pdf->setPars( pars );
+  if ( ! val )
+    return;
 
-  // Before evaluating the pdf at all data points, cache anything common to
-  //    all points (usually compute the norm).
-  _pdf->cache();
+  double sums[ 2 ] = { _data.sumWeights(), _data.sumWeights2() };
+
+  // The sums must run over the entries in all the processes.
+  Parallel::sum( sums, 2 );
 
+  if ( sums[ 1 ] > 0.0 )
+    _weightScale = sums[ 0 ] / sums[ 1 ];
+}
+
+
+// Terms of the nll of the entries [ first, last ).
+double Nll::terms( const std::size_t& first, const std::size_t& last ) const throw( PdfException )
+{
   // Get the vector of variable names that the pdf depends on.
   std::vector< std::string > varNames = _pdf->varNames();
 
-  typedef std::vector< std::string                                     >::const_iterator vIter;
-  typedef std::map   < unsigned, std::vector< double >                 >::const_iterator mrIter;
-  typedef std::map   < unsigned, std::vector< std::complex< double > > >::const_iterator mcIter;
+  typedef std::vector< std::string >::const_iterator vIter;
 
-  // Vector of values of the variables that the pdf must be evaluated at, and vectors of cached values.
-  std::vector< double                 > vars;
-  std::vector< double                 > cacheR;
-  std::vector< std::complex< double > > cacheC;
-
-  // Allocate memory for the vectors of cached variables.
-  cacheR.reserve( _pdf->nCachedReal()    );
-  cacheC.reserve( _pdf->nCachedComplex() );
+  // Vector of values of the variables that the pdf must be evaluated at.
+  std::vector< double > vars;
+  vars.reserve( varNames.size() );
 
   // Initialize the value of the nll.
   double nll = 0.;
 
   double value = 0.;
 
+  // Compute the logarithm of the pdf directly if it is supported, to avoid
+  //    computing log( exp( ... ) ) and underflows in the tails of the pdf.
+  const bool& useLog = _pdf->hasLog();
+
   // Sum of the terms of the nll.
-  for ( std::size_t n = 0; n < _data.size(); ++n )
+  for ( std::size_t n = first; n < last; ++n )
   {
-    // Reset the vector of values of the variables and the previously cached values.
-    vars  .clear();
-    cacheR.clear();
-    cacheC.clear();
+    // Reset the vector of values of the variables.
+    vars.clear();
 
-    // Fill the vector of values and sum the terms of the variance.
+    // Fill the vector of values of the variables.
     for ( vIter var = varNames.begin(); var != varNames.end(); ++var )
       vars.push_back( _data.value( *var, n ) );
 
-    for ( mrIter cached = _cacheR.begin(); cached != _cacheR.end(); ++cached )
-      cacheR[ cached->first ] = cached->second[ n ];
-
-    for ( mcIter cached = _cacheC.begin(); cached != _cacheC.end(); ++cached )
-      cacheC[ cached->first ] = cached->second[ n ];
-
     // Add the term to the nll.
-    value = _pdf->evaluate( vars, cacheR, cacheC );
+    if ( useLog )
+    {
+      // A pdf that evaluates to zero is not taken into account, as in the linear case.
+      value = _pdf->evaluateLog( vars, cachedReal( n ), cachedComplex( n ) );
+      if ( value != - std::numeric_limits< double >::infinity() )
+        nll += - 2. * _data.weight( n ) * value;
+      continue;
+    }
+
+    value = _pdf->evaluate( vars, cachedReal( n ), cachedComplex( n ) );
 
     if ( value )
-      nll += - 2. * log( value );
+      nll += - 2. * _data.weight( n ) * log( value );
 //       else
 // 	std::cout << "Warning: pdf evaluates to zero for entry " << n
 // 		  << ". Not taking this entry into account for the nll." << std::endl;
   }
 
-  nll += 2.0 * _pdf->yield();
+  return nll;
+}
 
-#ifdef MPI_ON
-  // If running with MPI, each process has only computed a piece of the chi2.
+
+double Nll::local( const std::vector<double>& pars ) const throw( PdfException )
+{
+  if ( pars.size() != _pdf->nPars() )
+    throw PdfException( "Number of parameters passed does not match number of required arguments." );
+
+  _pdf->setPars( pars );
+
+  // Before evaluating the pdf at all data points, cache anything common to
+  //    all points (usually compute the norm).
+  _pdf->cache();
+
+  const std::function< double ( const std::size_t&, const std::size_t& ) >& nllTerms =
+    [ this ]( const std::size_t& first, const std::size_t& last ) { return terms( first, last ); };
+
+  const std::size_t& size = _data.size();
+
+  double nll = 0.;
+
+  // In streaming mode, the next chunk is read ahead while the current one is
+  //    evaluated, and the current one is dropped from memory once it is done.
+  if ( _chunkSize )
+  {
+    prefetch( 0, _chunkSize );
+    for ( std::size_t first = 0; first < size; first += _chunkSize )
+    {
+      const std::size_t last = std::min( first + _chunkSize, size );
+
+      prefetch( last, last + _chunkSize );
+      cacheBlock( first, last );
+      nll += sum( nllTerms, first, last );
+      release( first, last );
+    }
+  }
+  else
+  {
+    cacheBlock( 0, size );
+    nll = sum( nllTerms, 0, size );
+  }
+
+  // The yield term is only added by one process, since the pieces are added up.
+  if ( Parallel::rank() == 0 )
+    nll += 2.0 * _pdf->yield();
+  nll *= _weightScale;
+
+  return nll;
+}
+
+
+double Nll::operator()( const std::vector<double>& pars ) const throw( PdfException )
+{
+  double nll = local( pars );
+
+  // If running with MPI, each process has only computed a piece of the nll.
   //    Add all the pieces up and broadcast them to all the processes.
-  double result = 0.0;
-  MPI::Comm& world = MPI::COMM_WORLD;
-  world.Allreduce( &nll, &result, 1, MPI::DOUBLE, MPI::SUM );
+  Parallel::sum( nll );
 
-  return result;
-#else
-  if ( _verbose )
+  if ( _verbose && ( Parallel::rank() == 0 ) )
     std::cout << "nll = " << nll << std::endl;
 
   return nll;
-#endif
 }
-
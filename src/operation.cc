@@ -6,6 +6,7 @@
 
 #include <cfit/pdfmodel.hh>
 #include <cfit/pdfexpr.hh>
+#include <cfit/convolution.hh>
 
 #include <cfit/parameter.hh>
 #include <cfit/parameterexpr.hh>
@@ -1008,6 +1009,41 @@ const PdfExpr operator*( const PdfExpr& left, const PdfModel& right )
   return PdfExpr( left, right, Operation::mult );
 }
 
+// Convolution of two pdfs. The grid covers the limits set to the variable of the left
+//    pdf, or otherwise to the one of the right pdf.
+const PdfExpr operator^( const PdfExpr& left, const PdfExpr& right ) throw( PdfException )
+{
+  const std::vector< std::string >& vars = left.commonVars();
+  if ( ( vars.size() != 1 ) || ( vars != right.commonVars() ) )
+    throw PdfException( "Cannot convolve two pdfs that do not depend on the same single variable." );
+
+  typedef std::map< std::string, std::pair< double, double > >::const_iterator lIter;
+  lIter limits = left._limits.find( vars[ 0 ] );
+  if ( limits == left._limits.end() )
+  {
+    limits = right._limits.find( vars[ 0 ] );
+    if ( limits == right._limits.end() )
+      throw PdfException( "Cannot convolve two pdfs without limits of the variable " + vars[ 0 ] + "." );
+  }
+
+  return PdfExpr( Convolution( left, right, limits->second.first, limits->second.second ) );
+}
+
+const PdfExpr operator^( const PdfModel& left, const PdfModel& right ) throw( PdfException )
+{
+  return PdfExpr( left ) ^ PdfExpr( right );
+}
+
+const PdfExpr operator^( const PdfModel& left, const PdfExpr& right ) throw( PdfException )
+{
+  return PdfExpr( left ) ^ right;
+}
+
+const PdfExpr operator^( const PdfExpr& left, const PdfModel& right ) throw( PdfException )
+{
+  return left ^ PdfExpr( right );
+}
+
 // Operations with two pdf expressions.
 const PdfExpr operator+( const PdfExpr& left, const PdfExpr& right )
 {
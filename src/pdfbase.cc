@@ -2,13 +2,19 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <exception>
 
 #include <cfit/pdfbase.hh>
+#include <cfit/dataset.hh>
+#include <cfit/threadpool.hh>
 
 
 unsigned PdfBase::_cacheIdxReal    = 0;
 unsigned PdfBase::_cacheIdxComplex = 0;
 
+// Number of events generated with the same stream in batch generation.
+static const std::size_t generateBlockSize = 4096;
+
 
 void PdfBase::fix( const std::string& name ) throw( PdfException )
 {
@@ -35,3 +41,88 @@ const std::vector< std::string > PdfBase::varNames() const
   return varNames;
 }
 
+
+
+void PdfBase::generateBlock( RandomStream&                            stream ,
+                             const std::size_t&                       count  ,
+                             const std::map< std::string, double* >& columns ) const throw( PdfException )
+{
+  typedef std::map< std::string, double* >::const_iterator cIter;
+  for ( std::size_t entry = 0; entry < count; ++entry )
+  {
+    const std::map< std::string, double >& event = generate( stream );
+    for ( cIter column = columns.begin(); column != columns.end(); ++column )
+    {
+      const std::map< std::string, double >::const_iterator& value = event.find( column->first );
+      if ( value == event.end() )
+        throw PdfException( "Generate error: variable " + column->first + " has not been generated." );
+
+      column->second[ entry ] = value->second;
+    }
+  }
+}
+
+
+const std::map< std::string, double > PdfBase::generateEvent( RandomStream& stream ) const throw( PdfException )
+{
+  std::map< std::string, double  > event;
+  std::map< std::string, double* > columns;
+
+  typedef std::map< std::string, Variable >::const_iterator vIter;
+  for ( vIter var = _varMap.begin(); var != _varMap.end(); ++var )
+    columns[ var->first ] = &event[ var->first ];
+
+  generateBlock( stream, 1, columns );
+
+  return event;
+}
+
+
+const Dataset PdfBase::generate( const std::size_t& n, RandomStream& stream, const unsigned& nThreads ) const throw( PdfException )
+{
+  const std::vector< std::string >& names = varNames();
+
+  std::vector< std::vector< double > > values( names.size(), std::vector< double >( n ) );
+
+  const std::size_t   nBlocks = ( n + generateBlockSize - 1 ) / generateBlockSize;
+  const std::uint64_t first   = stream();
+
+  ThreadPool pool( std::min< std::size_t >( nThreads ? nThreads : std::thread::hardware_concurrency(),
+                                            std::max< std::size_t >( nBlocks, 1 ) ) );
+
+  // Exceptions cannot leave the threads, so they are thrown again from the calling one.
+  std::vector< std::exception_ptr > errors( pool.size() );
+
+  pool.run( [ & ]( const unsigned& thread )
+  {
+    try
+    {
+      std::map< std::string, double* > columns;
+      for ( std::size_t block = thread; block < nBlocks; block += pool.size() )
+      {
+        const std::size_t& begin = block * generateBlockSize;
+        const std::size_t  count = std::min( generateBlockSize, n - begin );
+
+        for ( std::size_t var = 0; var < names.size(); ++var )
+          columns[ names[ var ] ] = values[ var ].data() + begin;
+
+        RandomStream blockStream( stream.seed(), first + block );
+        generateBlock( blockStream, count, columns );
+      }
+    }
+    catch ( ... )
+    {
+      errors[ thread ] = std::current_exception();
+    }
+  } );
+
+  for ( std::vector< std::exception_ptr >::const_iterator error = errors.begin(); error != errors.end(); ++error )
+    if ( *error )
+      std::rethrow_exception( *error );
+
+  Dataset data;
+  for ( std::size_t var = 0; var < names.size(); ++var )
+    data.push( names[ var ], values[ var ] );
+
+  return data;
+}
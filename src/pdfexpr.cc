@@ -3,6 +3,7 @@
 #include <vector>
 #include <stack>
 #include <cmath>
+#include <limits>
 #include <random>
 
 #include <Minuit/FunctionMinimum.h>
@@ -362,7 +363,7 @@ void PdfExpr::cache()
 
 
 
-const std::map< std::string, double > PdfExpr::generate() const throw( PdfException )
+const std::map< std::string, double > PdfExpr::generate( RandomStream& stream ) const throw( PdfException )
 {
   std::map< std::string, double > genVals;
   double val = 0.0;
@@ -376,7 +377,7 @@ const std::map< std::string, double > PdfExpr::generate() const throw( PdfExcept
   while ( ! valid )
   {
     valid = true;
-    genVals = generateFull();
+    genVals = generateFull( stream );
     for ( lIter lim = _limits.begin(); valid && ( lim != _limits.end() ); ++lim )
     {
       val = genVals[ lim->first ];
@@ -394,7 +395,7 @@ const std::map< std::string, double > PdfExpr::generate() const throw( PdfExcept
 
 // Generate over the full range of definition of all the models. It may happen that
 //    some variable gets generated outside of its specified range.
-const std::map< std::string, double > PdfExpr::generateFull() const throw( PdfException )
+const std::map< std::string, double > PdfExpr::generateFull( RandomStream& stream ) const throw( PdfException )
 {
   std::stack< double >                                values;
   std::stack< std::pair< std::size_t, std::size_t > > ranges;
@@ -483,7 +484,7 @@ const std::map< std::string, double > PdfExpr::generateFull() const throw( PdfEx
               if ( ( x < 0 ) || ( y > 0 ) )
                 throw PdfException( "Generation error: negative coefficient multiplying a pdf." );
 
-            rnd = Random::uniform( 0, x + std::fabs( y ) );
+            rnd = stream.uniform( 0, x + std::fabs( y ) );
 
             // Choose one of the two distributions.
             if ( rnd < x )
@@ -514,7 +515,7 @@ const std::map< std::string, double > PdfExpr::generateFull() const throw( PdfEx
   for ( unsigned pdf = 0; pdf < _pdfs.size(); ++pdf )
     if ( keep[ pdf ] )
     {
-      partial = _pdfs[ pdf ]->generate();
+      partial = _pdfs[ pdf ]->generate( stream );
       entry.insert( partial.begin(), partial.end() );
     }
 
@@ -546,6 +547,14 @@ const std::map< unsigned, std::vector< std::complex< double > > > PdfExpr::cache
 
 
 
+void PdfExpr::cacheBlock( const double* cacheR, const std::size_t& stride, const std::size_t& size )
+{
+  for ( std::vector< PdfModel* >::iterator pdf = _pdfs.begin(); pdf != _pdfs.end(); ++pdf )
+    (*pdf)->cacheBlock( cacheR, stride, size );
+}
+
+
+
 const double PdfExpr::evaluate( const std::vector< double >& vars ) const throw( PdfException )
 {
   if ( _varMap.size() != vars.size() )
@@ -620,8 +629,8 @@ const double PdfExpr::evaluate( const std::vector< double >& vars ) const throw(
 
 
 const double PdfExpr::evaluate( const std::vector< double                 >& vars  ,
-                                const std::vector< double                 >& cacheR,
-                                const std::vector< std::complex< double > >& cacheC  ) const throw( PdfException )
+                                const double*                                cacheR,
+                                const std::complex< double >*                cacheC  ) const throw( PdfException )
 {
   if ( _varMap.size() != vars.size() )
     throw PdfException( "PdfExpr::evaluate: Number of arguments passed does not match number of required arguments." );
@@ -693,6 +702,175 @@ const double PdfExpr::evaluate( const std::vector< double                 >& var
 }
 
 
+const bool PdfExpr::hasLog() const
+{
+  for ( std::vector< PdfModel* >::const_iterator pdf = _pdfs.begin(); pdf != _pdfs.end(); ++pdf )
+    if ( ! (*pdf)->hasLog() )
+      return false;
+
+  return true;
+}
+
+
+
+const double PdfExpr::evaluateLog( const std::vector< double >& vars ) const throw( PdfException )
+{
+  if ( _varMap.size() != vars.size() )
+    throw PdfException( "PdfExpr::evaluateLog: Number of arguments passed does not match number of required arguments." );
+
+  // Dictionary of the variable names with the values passed.
+  std::map< std::string, double > localVars;
+  std::vector< double > modelVars;
+
+  // Set the local values of the variables.
+  int index = 0;
+  typedef std::map< std::string, Variable >::const_iterator vIter;
+  for ( vIter var = _varMap.begin(); var != _varMap.end(); ++var )
+    localVars[ var->first ] = vars[ index++ ];
+
+  // Every value in the stack is represented by the logarithm of its absolute value and its sign.
+  std::stack< Operation::LogValue > values;
+
+  Operation::LogValue x;
+  Operation::LogValue y;
+  std::vector< PdfModel*     >::const_iterator pdf = _pdfs .begin();
+  std::vector< Parameter     >::const_iterator par = _parms.begin();
+  std::vector< double        >::const_iterator ctt = _ctnts.begin();
+  std::vector< Operation::Op >::const_iterator ops = _opers.begin();
+
+  typedef std::string::const_iterator eIter;
+  for ( eIter ch = _expression.begin(); ch != _expression.end(); ++ch )
+    if ( *ch == 'm' )
+    {
+      // Determine the variables that the pdf depends on.
+      modelVars.clear();
+      std::map< std::string, Variable >& pdfVars = (*pdf)->_varMap;
+      for ( vIter var = pdfVars.begin(); var != pdfVars.end(); ++var )
+        modelVars.push_back( localVars.find( var->second.name() )->second );
+
+      // Evaluate the logarithm of the function at the given point.
+      values.push( Operation::LogValue( (*pdf++)->evaluateLog( modelVars ), 1.0 ) );
+    }
+    else if ( *ch == 'p' )
+      values.push( Operation::toLog( _parMap.find( par++->name() )->second.value() ) );
+    else if ( *ch == 'c' )
+      values.push( Operation::toLog( *ctt++ ) );
+    else
+    {
+      if ( *ch == 'b' )
+      {
+        if ( values.size() < 2 )
+          throw PdfException( "Parse error: not enough values in the stack." );
+        y = values.top();
+        values.pop();
+        x = values.top();
+        values.pop();
+        values.push( Operation::operateLog( x, y, *ops++ ) );
+      }
+      else if ( *ch == 'u' )
+      {
+        if ( values.empty() )
+          throw PdfException( "Parse error: not enough values in the stack." );
+        x = values.top();
+        values.pop();
+        values.push( Operation::operateLog( x, *ops++ ) );
+      }
+      else
+        throw PdfException( std::string( "Parse error: unknown operation " ) + *ch + "." );
+    }
+
+  if ( values.size() != 1 )
+    throw PdfException( "PdfExpr parse error: too many values have been supplied." );
+
+  // The logarithm of a negative pdf is not defined.
+  if ( values.top().second < 0.0 )
+    return std::numeric_limits< double >::quiet_NaN();
+
+  return values.top().first;
+}
+
+
+
+const double PdfExpr::evaluateLog( const std::vector< double                 >& vars  ,
+                                   const double*                                cacheR,
+                                   const std::complex< double >*                cacheC  ) const throw( PdfException )
+{
+  if ( _varMap.size() != vars.size() )
+    throw PdfException( "PdfExpr::evaluateLog: Number of arguments passed does not match number of required arguments." );
+
+  // Dictionary of the variable names with the values passed.
+  std::map< std::string, double > localVars;
+  std::vector< double > modelVars;
+
+  // Set the local values of the variables.
+  int index = 0;
+  typedef std::map< std::string, Variable >::const_iterator vIter;
+  for ( vIter var = _varMap.begin(); var != _varMap.end(); ++var )
+    localVars[ var->first ] = vars[ index++ ];
+
+  // Every value in the stack is represented by the logarithm of its absolute value and its sign.
+  std::stack< Operation::LogValue > values;
+
+  Operation::LogValue x;
+  Operation::LogValue y;
+  std::vector< PdfModel*     >::const_iterator pdf = _pdfs .begin();
+  std::vector< Parameter     >::const_iterator par = _parms.begin();
+  std::vector< double        >::const_iterator ctt = _ctnts.begin();
+  std::vector< Operation::Op >::const_iterator ops = _opers.begin();
+
+  typedef std::string::const_iterator eIter;
+  for ( eIter ch = _expression.begin(); ch != _expression.end(); ++ch )
+    if ( *ch == 'm' )
+    {
+      // Determine the variables that the pdf depends on.
+      modelVars.clear();
+      std::map< std::string, Variable >& pdfVars = (*pdf)->_varMap;
+      for ( vIter var = pdfVars.begin(); var != pdfVars.end(); ++var )
+        modelVars.push_back( localVars.find( var->second.name() )->second );
+
+      // Evaluate the logarithm of the function at the given point.
+      values.push( Operation::LogValue( (*pdf++)->evaluateLog( modelVars, cacheR, cacheC ), 1.0 ) );
+    }
+    else if ( *ch == 'p' )
+      values.push( Operation::toLog( _parMap.find( par++->name() )->second.value() ) );
+    else if ( *ch == 'c' )
+      values.push( Operation::toLog( *ctt++ ) );
+    else
+    {
+      if ( *ch == 'b' )
+      {
+        if ( values.size() < 2 )
+          throw PdfException( "Parse error: not enough values in the stack." );
+        y = values.top();
+        values.pop();
+        x = values.top();
+        values.pop();
+        values.push( Operation::operateLog( x, y, *ops++ ) );
+      }
+      else if ( *ch == 'u' )
+      {
+        if ( values.empty() )
+          throw PdfException( "Parse error: not enough values in the stack." );
+        x = values.top();
+        values.pop();
+        values.push( Operation::operateLog( x, *ops++ ) );
+      }
+      else
+        throw PdfException( std::string( "Parse error: unknown operation " ) + *ch + "." );
+    }
+
+  if ( values.size() != 1 )
+    throw PdfException( "PdfExpr parse error: too many values have been supplied." );
+
+  // The logarithm of a negative pdf is not defined.
+  if ( values.top().second < 0.0 )
+    return std::numeric_limits< double >::quiet_NaN();
+
+  return values.top().first;
+}
+
+
+
 void PdfExpr::setLimits( const Variable& var, const double& min, const double& max )
 {
   const double& totalArea = this->area();
@@ -719,21 +897,23 @@ std::vector< std::string > PdfExpr::commonVars() const throw( PdfException )
   // Stack for partial calculations.
   std::stack< std::vector< std::string > > calcs;
 
-  // Iterator over the models that the pdf depends on.
-  std::vector< PdfModel* >::const_iterator models = _pdfs.begin();
+  // Iterators over the models and operations that the pdf depends on.
+  std::vector< PdfModel*     >::const_iterator models = _pdfs .begin();
+  std::vector< Operation::Op >::const_iterator ops    = _opers.begin();
 
   typedef std::string::const_iterator eIter;
-  std::vector< std::string > varNames;
   for ( eIter ch = _expression.begin(); ch != _expression.end(); ++ch )
   {
     if ( *ch == 'm' )
+      calcs.push( (*models++)->varNames() );
+    else if ( ( *ch == 'p' ) || ( *ch == 'c' ) )
+      calcs.push( voidVec );
+    else if ( *ch == 'u' )
     {
-      std::map< std::string, Variable >& vars = (*models++)->_varMap;
-      std::transform( vars.begin(), vars.end(), std::back_inserter( varNames ), Select1st() );
-      calcs.push( varNames );
+      if ( calcs.empty() )
+        throw PdfException( "Parse error computing convolution: not enough values in the stack." );
+      ++ops;
     }
-    else if ( *ch == 'p' )
-      calcs.push( voidVec );
     else
       if ( calcs.size() < 2 )
         throw PdfException( "Parse error computing convolution: not enough values in the stack." );
@@ -745,9 +925,11 @@ std::vector< std::string > PdfExpr::commonVars() const throw( PdfException )
         calcs.pop();
         z.clear();
 
-        if ( *ch == '+' )
+        // Sums keep the variables of all their terms, and products and quotients by
+        //    parameters and constants the ones of the pdf.
+        if ( *ops++ == Operation::plus )
           std::set_intersection( x.begin(), x.end(), y.begin(), y.end(), std::back_inserter( z ) );
-        else if ( *ch == '*' )
+        else
           std::set_union       ( x.begin(), x.end(), y.begin(), y.end(), std::back_inserter( z ) );
 
         calcs.push( z );
@@ -778,7 +960,7 @@ double PdfExpr::area( const std::string& var, const double& min, const double& m
     if ( *ch == 'm' )
     {
       if ( (*pdf)->dependsOn( var ) )
-        values.push( (*pdf++)->area( min, max ) );
+        values.push( (*pdf++)->area( var, min, max ) );
       else
       {
         values.push( 1.0 );
@@ -1,6 +1,8 @@
 
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 #include <Minuit/FunctionMinimum.h>
@@ -13,6 +15,38 @@
 
 
 
+PdfModel::PdfModel()
+  : _version( 1 ), _areas( 256, CachedArea{ 0.0, 0.0, 0, 0.0 } )
+{}
+
+
+PdfModel::PdfModel( const PdfModel& model )
+  : PdfBase( model ), _version( model._version ), _varOrder( model._varOrder ), _parOrder( model._parOrder )
+{
+  std::lock_guard< std::mutex > lock( model._areasMutex );
+  _areas = model._areas;
+}
+
+
+PdfModel& PdfModel::operator=( const PdfModel& model )
+{
+  if ( this == &model )
+    return *this;
+
+  std::lock( _areasMutex, model._areasMutex );
+  std::lock_guard< std::mutex > lockThis ( _areasMutex      , std::adopt_lock );
+  std::lock_guard< std::mutex > lockOther( model._areasMutex, std::adopt_lock );
+
+  PdfBase::operator=( model );
+  _version  = model._version;
+  _areas    = model._areas;
+  _varOrder = model._varOrder;
+  _parOrder = model._parOrder;
+
+  return *this;
+}
+
+
 // Add a variable to the variables map.
 void PdfModel::push( const Variable& var )
 {
@@ -130,8 +164,12 @@ void PdfModel::setParMap( const std::vector< double >& pars )
 
   typedef std::map< std::string, Parameter >::iterator pIter;
   int index = 0;
-  for ( pIter par = _parMap.begin(); par != _parMap.end(); ++par )
-    par->second.setValue( pars[ index++ ] );
+  for ( pIter par = _parMap.begin(); par != _parMap.end(); ++par, ++index )
+  {
+    if ( par->second.value() != pars[ index ] )
+      invalidate();
+    par->second.setValue( pars[ index ] );
+  }
 }
 
 
@@ -141,7 +179,11 @@ void PdfModel::setParMap( const std::map< std::string, Parameter >& pars )
   typedef std::map< const std::string, Parameter >::iterator pIter;
   for ( pIter par = _parMap.begin(); par != _parMap.end(); ++par )
     if ( pars.count( par->first ) )
+    {
+      if ( par->second.value() != pars.at( par->first ).value() )
+        invalidate();
       par->second.setValue( pars.at( par->first ).value() );
+    }
 }
 
 
@@ -161,7 +203,11 @@ void PdfModel::setParMap( const FunctionMinimum& min )
   typedef std::vector< MinuitParameter >::const_iterator pIter;
   for ( pIter par = pars.begin(); par != pars.end(); ++par )
     if ( _parMap.count( par->name() ) )
+    {
+      if ( _parMap[ par->name() ].value() != par->value() )
+        invalidate();
       _parMap[ par->name() ].set( par->value(), par->error() );
+    }
 }
 
 
@@ -171,6 +217,8 @@ void PdfModel::setPar( const std::string& name, const double& val, const double&
   if ( ! _parMap.count( name ) )
     throw PdfException( "Cannot set unexisting parameter " + name + "." );
 
+  if ( _parMap[ name ].value() != val )
+    invalidate();
   _parMap[ name ].set( val, err );
 }
 
@@ -207,3 +255,36 @@ const double PdfModel::area( const double& min, const double& max ) const throw(
 {
   throw PdfException( "You are trying to find the area of a model that does not have this property." );
 }
+
+
+// Memoized area along a variable. The table is only locked to look up and store the
+//    area, so that it is computed without holding the lock.
+double PdfModel::area( const std::string& var, const double& min, const double& max ) const throw( PdfException )
+{
+  if ( ! dependsOn( var ) )
+    return 1.0;
+
+  std::uint64_t minBits;
+  std::uint64_t maxBits;
+  std::memcpy( &minBits, &min, sizeof( double ) );
+  std::memcpy( &maxBits, &max, sizeof( double ) );
+
+  const std::uint64_t hash = ( minBits * 0x9E3779B97F4A7C15ULL ) ^ ( maxBits * 0xC2B2AE3D27D4EB4FULL );
+  const std::size_t   slot = hash >> 56;
+
+  unsigned long version;
+  {
+    std::lock_guard< std::mutex > lock( _areasMutex );
+    const CachedArea& cached = _areas[ slot ];
+    if ( ( cached.version == _version ) && ( cached.min == min ) && ( cached.max == max ) )
+      return cached.value;
+    version = _version;
+  }
+
+  const double value = area( min, max );
+
+  std::lock_guard< std::mutex > lock( _areasMutex );
+  _areas[ slot ] = CachedArea{ min, max, version, value };
+
+  return value;
+}
@@ -1,8 +1,114 @@
 
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
 #include <cfit/random.hh>
 
-std::mt19937_64                          Random::_engine  = std::mt19937_64();
 
-std::uniform_real_distribution< double > Random::_uniform = std::uniform_real_distribution< double >();
-std::normal_distribution      < double > Random::_normal  = std::normal_distribution      < double >();
+// Multipliers and key increments of Philox4x32.
+static const std::uint32_t philoxM0 = 0xD2511F53;
+static const std::uint32_t philoxM1 = 0xCD9E8D57;
+static const std::uint32_t philoxW0 = 0x9E3779B9;
+static const std::uint32_t philoxW1 = 0xBB67AE85;
+
+
+// Ten rounds of Philox4x32 on the counter ( position, stream ), with the seed as key.
+void RandomStream::refill()
+{
+  std::uint32_t ctr[ 4 ] = { std::uint32_t( _counter ), std::uint32_t( _counter >> 32 ),
+                             std::uint32_t( _stream  ), std::uint32_t( _stream  >> 32 ) };
+  std::uint32_t key[ 2 ] = { std::uint32_t( _seed    ), std::uint32_t( _seed    >> 32 ) };
+
+  for ( unsigned round = 0; round < 10; ++round )
+  {
+    const std::uint64_t& prod0 = std::uint64_t( philoxM0 ) * ctr[ 0 ];
+    const std::uint64_t& prod1 = std::uint64_t( philoxM1 ) * ctr[ 2 ];
+
+    const std::uint32_t next[ 4 ] = { std::uint32_t( prod1 >> 32 ) ^ ctr[ 1 ] ^ key[ 0 ], std::uint32_t( prod1 ),
+                                      std::uint32_t( prod0 >> 32 ) ^ ctr[ 3 ] ^ key[ 1 ], std::uint32_t( prod0 ) };
+    std::copy( next, next + 4, ctr );
+
+    key[ 0 ] += philoxW0;
+    key[ 1 ] += philoxW1;
+  }
+
+  _block[ 0 ] = ( std::uint64_t( ctr[ 1 ] ) << 32 ) | ctr[ 0 ];
+  _block[ 1 ] = ( std::uint64_t( ctr[ 3 ] ) << 32 ) | ctr[ 2 ];
+  _next       = 0;
+  ++_counter;
+}
+
+
+void RandomStream::discard( std::uint64_t n )
+{
+  // Use what is left of the current block, then jump over whole blocks.
+  while ( n && ( _next < 2 ) )
+  {
+    ++_next;
+    --n;
+  }
+
+  if ( ! n )
+    return;
+
+  _counter += ( n - 1 ) / 2;
+  refill();
+  _next = ( n - 1 ) % 2 + 1;
+}
+
+
+// Box-Muller transform, keeping the second deviate for the next call.
+const double RandomStream::normal( const double& mu, const double& sigma )
+{
+  if ( _hasSpare )
+  {
+    _hasSpare = false;
+    return mu + sigma * _spare;
+  }
+
+  // Use 1 - u to avoid log( 0 ).
+  const double& radius = std::sqrt( -2.0 * std::log( 1.0 - flat() ) );
+  const double& angle  = 2.0 * M_PI * flat();
+
+  _spare    = radius * std::sin( angle );
+  _hasSpare = true;
+
+  return mu + sigma * radius * std::cos( angle );
+}
+
+
+std::uint64_t Random::_seed = 0;
+
+// Next stream to assign to a thread, and number of times the seed has been set, such
+//    that the default streams of all threads are recreated after a new seed.
+static std::atomic< std::uint64_t > nextStream( 0 );
+static std::atomic< unsigned      > seedVersion( 0 );
+
+
+RandomStream& Random::stream()
+{
+  thread_local RandomStream local;
+  thread_local unsigned     version = 0;
+  thread_local bool         assigned = false;
+
+  if ( ! assigned || ( version != seedVersion ) )
+  {
+    local    = RandomStream( _seed, nextStream++ );
+    version  = seedVersion;
+    assigned = true;
+  }
+
+  return local;
+}
+
+
+// Must not be called while other threads are using their default streams.
+void Random::setSeed( const unsigned& seed )
+{
+  _seed      = seed;
+  nextStream = 0;
+  ++seedVersion;
 
+  stream();
+}
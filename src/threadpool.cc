@@ -0,0 +1,70 @@
+
+#include <cfit/threadpool.hh>
+
+
+ThreadPool::ThreadPool( const unsigned& nThreads )
+  : _task( 0 ), _generation( 0 ), _pending( 0 ), _stop( false )
+{
+  unsigned size = nThreads ? nThreads : std::thread::hardware_concurrency();
+  if ( ! size )
+    size = 1;
+
+  for ( unsigned index = 0; index + 1 < size; ++index )
+    _threads.push_back( std::thread( &ThreadPool::work, this, index ) );
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard< std::mutex > lock( _mutex );
+    _stop = true;
+  }
+  _start.notify_all();
+
+  for ( std::vector< std::thread >::iterator thread = _threads.begin(); thread != _threads.end(); ++thread )
+    thread->join();
+}
+
+
+// Wait for every new task and run it with the index of this thread.
+void ThreadPool::work( const unsigned index )
+{
+  unsigned generation = 0;
+  while ( true )
+  {
+    const std::function< void ( const unsigned& ) >* task;
+    {
+      std::unique_lock< std::mutex > lock( _mutex );
+      _start.wait( lock, [ & ]() { return _stop || ( _generation != generation ); } );
+      if ( _stop )
+        return;
+
+      generation = _generation;
+      task       = _task;
+    }
+
+    ( *task )( index );
+
+    std::lock_guard< std::mutex > lock( _mutex );
+    if ( ! --_pending )
+      _done.notify_one();
+  }
+}
+
+
+void ThreadPool::run( const std::function< void ( const unsigned& ) >& task )
+{
+  {
+    std::lock_guard< std::mutex > lock( _mutex );
+    _task    = &task;
+    _pending = _threads.size();
+    ++_generation;
+  }
+  _start.notify_all();
+
+  task( _threads.size() );
+
+  std::unique_lock< std::mutex > lock( _mutex );
+  _done.wait( lock, [ this ]() { return ! _pending; } );
+}
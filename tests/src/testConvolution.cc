@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <ctime>
+
+#include <cfit/parameter.hh>
+#include <cfit/variable.hh>
+#include <cfit/pdfexpr.hh>
+#include <cfit/convolution.hh>
+
+#include <cfit/models/exponential.hh>
+#include <cfit/models/gauss.hh>
+#include <cfit/models/expogauss.hh>
+
+#define MIN   ( -1.0 )
+#define MAX   (  8.0 )
+#define NCALL ( 100  )
+
+
+// Largest difference between the convolution and the analytical pdf.
+double maxDiff( const PdfExpr& conv, const ExpoGauss& pdf )
+{
+  std::vector< double > vars( 1 );
+
+  double diff = 0.0;
+  for ( double x = MIN; x <= MAX; x += 0.001 )
+  {
+    vars[ 0 ] = x;
+    diff = std::max( diff, std::fabs( conv.evaluate( vars ) - pdf.evaluate( x ) ) );
+  }
+
+  return diff;
+}
+
+
+
+int main( int argc, char** argv )
+{
+  // Variables the model depends on.
+  Variable t( "t" );
+
+  // Parameters of the model.
+  Parameter gamma( "gamma", 1.3 , 0.01 );
+  Parameter mu   ( "mu"   , 0.05, 0.01 );
+  Parameter sigma( "sigma", 0.2 , 0.01 );
+
+  // Exponential convolved with a Gaussian resolution, numerically and analytically.
+  Exponential expo ( t, gamma     );
+  Gauss       gauss( t, mu, sigma );
+  ExpoGauss   exact( t, gamma, mu, sigma );
+  exact.setLimits( MIN, MAX );
+
+  // The grid covers the limits of the variable of the left pdf.
+  PdfExpr signal( expo );
+  signal.setLimits( t, MIN, MAX );
+
+  PdfExpr conv = signal ^ gauss;
+  conv.cache();
+
+  std::cout << std::scientific << std::setprecision( 2 );
+  std::cout << "Largest difference to the analytical pdf: " << maxDiff( conv, exact ) << std::endl;
+
+  // Changing the parameters recomputes the grid.
+  std::map< std::string, Parameter > pars = conv.getPars();
+  pars[ "gamma" ].setValue( 0.9 );
+  pars[ "sigma" ].setValue( 0.4 );
+  conv .setPars( pars );
+  exact.setPars( pars );
+  conv .cache();
+  exact.cache();
+  std::cout << "After changing the parameters:            " << maxDiff( conv, exact ) << std::endl;
+
+  // Time per call, with the parameters changing or not.
+  clock_t start = clock();
+  for ( unsigned call = 0; call < NCALL; ++call )
+  {
+    pars[ "sigma" ].setValue( 0.3 + call * 1.0e-4 );
+    conv.setPars( pars );
+    conv.cache();
+  }
+  const double& changed = double( clock() - start ) / CLOCKS_PER_SEC / NCALL;
+
+  start = clock();
+  for ( unsigned call = 0; call < NCALL; ++call )
+  {
+    conv.setPars( pars );
+    conv.cache();
+  }
+  const double& unchanged = double( clock() - start ) / CLOCKS_PER_SEC / NCALL;
+
+  std::cout << "Seconds per call, new parameters:         " << changed   << std::endl;
+  std::cout << "Seconds per call, same parameters:        " << unchanged << std::endl;
+
+  return 0;
+}
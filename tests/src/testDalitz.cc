@@ -42,10 +42,13 @@ void readData ( std::string fileName, Dataset& data )
 
 int main( int argc, char** argv )
 {
-  // If working with MPI, initialize it.
+  // If working with MPI, initialize it. Only the main thread of each process
+  //    calls MPI, while the threads of the minimizer evaluate the events.
 #ifdef MPI_ON
-  MPI::Init( argc, argv );
-  const int rank = MPI::COMM_WORLD.Get_rank();
+  int provided;
+  MPI_Init_thread( &argc, &argv, MPI_THREAD_FUNNELED, &provided );
+  int rank;
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
 #endif
 
   clock_t initClock = clock();
@@ -278,7 +281,7 @@ int main( int argc, char** argv )
       std::cerr << "Processing time: " << double( clock() - initClock ) / double( CLOCKS_PER_SEC ) << " s" << std::endl;
     }
 
-  MPI::Finalize();
+  MPI_Finalize();
 #else
   std::cout << minimum << std::endl;
   std::cerr << "Processing time: " << double( clock() - initClock ) / double( CLOCKS_PER_SEC ) << " s" << std::endl;
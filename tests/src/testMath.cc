@@ -0,0 +1,165 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <ctime>
+
+#include <cfit/math.hh>
+
+#define NPOINTS ( 200000 )
+#define NREPEAT (     50 )
+
+
+// Values of the Faddeeva function computed in quadruple precision, from the Taylor
+//    series of erfc for | z | < 4 and from the Laplace continued fraction otherwise.
+static const double reference[][ 4 ] = {
+  //   x       y                       Re w(z)                   Im w(z)
+  {  0.0 ,  0.0 ,  1.00000000000000000e+00,  0.00000000000000000e+00 },
+  {  0.5 ,  0.5 ,  5.33156707912174954e-01,  2.30488231384458397e-01 },
+  {  1.0 ,  0.0 ,  3.67879441171442334e-01,  6.07157705841393724e-01 },
+  {  1.0 ,  1.0 ,  3.04744205256912593e-01,  2.08218938202831633e-01 },
+  {  0.0 ,  2.0 ,  2.55395676310505748e-01,  0.00000000000000000e+00 },
+  {  2.5 ,  0.3 ,  3.82265062606852168e-02,  2.43042008530977571e-01 },
+  {  3.0 ,  3.0 ,  9.64025055830445426e-02,  9.12363260042187568e-02 },
+  {  5.0 ,  0.5 ,  1.19003255225939488e-02,  1.13972718631886724e-01 },
+  {  0.3 ,  5.0 ,  1.10342091129807418e-01,  6.37956918315268386e-03 },
+  {  6.0 ,  6.0 ,  4.73352711333960147e-02,  4.66827448697319722e-02 },
+  {  8.0 ,  0.1 ,  9.02912628938292361e-04,  7.10765451448752139e-02 },
+  { 10.0 ,  2.0 ,  1.10015567057335159e-02,  5.44718170986565123e-02 },
+  { 19.9 ,  1.0 ,  1.42648163765098546e-03,  2.83152119440059635e-02 },
+  { 39.7 ,  5.0 ,  1.76351086721269297e-03,  1.39935229526299519e-02 },
+  {  0.5 , 20.6 ,  2.73396752810837231e-02,  6.62030656128856842e-04 },
+  { -1.0 , -0.2 ,  3.32182490447329393e-01, -7.77202474447166836e-01 },
+  { -3.0 , -0.2 , -1.55336834634038495e-02, -1.99907997076519128e-01 },
+  {  1.0 , -0.6 ,  3.64879924016025328e-02,  1.29144429723312926e+00 },
+  { -2.0 , -1.0 , -2.05325580646587513e-01, -1.46855485030167404e-01 },
+  {  4.0 , -0.2 , -7.82374238081237280e-03,  1.45513592869485092e-01 }
+};
+
+
+// Largest relative difference between two sets of values.
+template < class T >
+double maxDiff( const std::vector< T >& a, const std::vector< T >& b )
+{
+  double diff = 0.0;
+  for ( std::size_t i = 0; i < a.size(); ++i )
+    if ( std::abs( b[ i ] ) > 0.0 )
+      diff = std::max( diff, std::abs( a[ i ] - b[ i ] ) / std::abs( b[ i ] ) );
+
+  return diff;
+}
+
+
+double seconds( clock_t start ) { return double( clock() - start ) / CLOCKS_PER_SEC; }
+
+
+
+int main( int argc, char** argv )
+{
+  std::cout << std::scientific << std::setprecision( 2 );
+
+  // Accuracy of the Faddeeva function, scalar and batch.
+  const std::size_t& nRef = sizeof( reference ) / sizeof( reference[ 0 ] );
+
+  std::vector< std::complex< double > > refZ( nRef );
+  std::vector< std::complex< double > > refW( nRef );
+  for ( std::size_t i = 0; i < nRef; ++i )
+  {
+    refZ[ i ] = std::complex< double >( reference[ i ][ 0 ], reference[ i ][ 1 ] );
+    refW[ i ] = std::complex< double >( reference[ i ][ 2 ], reference[ i ][ 3 ] );
+  }
+
+  std::vector< std::complex< double > > batchW( nRef );
+  Math::faddeeva( refZ.data(), batchW.data(), nRef );
+
+  std::cout << "Relative error of the Faddeeva function:" << std::endl;
+  std::cout << "      x       y      scalar     batch" << std::endl;
+  for ( std::size_t i = 0; i < nRef; ++i )
+    std::cout << std::fixed      << std::setprecision( 1 )
+              << std::setw( 7 )  << reference[ i ][ 0 ] << " "
+              << std::setw( 7 )  << reference[ i ][ 1 ] << "  "
+              << std::scientific << std::setprecision( 2 )
+              << std::setw( 9 )  << std::abs( Math::faddeeva( refZ[ i ] ) - refW[ i ] ) / std::abs( refW[ i ] ) << " "
+              << std::setw( 9 )  << std::abs( batchW[ i ]                  - refW[ i ] ) / std::abs( refW[ i ] ) << std::endl;
+
+  // Points for the comparison of the batch and scalar versions.
+  std::vector< double >                 x( NPOINTS );
+  std::vector< std::complex< double > > z( NPOINTS );
+  for ( std::size_t i = 0; i < NPOINTS; ++i )
+  {
+    x[ i ] = -10.0 + 20.0 * ( i + 0.5 ) / NPOINTS;
+    z[ i ] = std::complex< double >( x[ i ], 0.01 + 0.3 * std::fabs( x[ i ] ) );
+  }
+
+  std::vector< double >                 scalar ( NPOINTS );
+  std::vector< double >                 batch  ( NPOINTS );
+  std::vector< std::complex< double > > scalarW( NPOINTS );
+  std::vector< std::complex< double > > batchW2( NPOINTS );
+
+  double  tScalar;
+  double  tBatch;
+  clock_t start;
+
+  std::cout << std::endl << "Batch against scalar versions, " << NPOINTS << " points:" << std::endl;
+  std::cout << "  function    max diff   scalar (s)  batch (s)" << std::endl;
+
+  start = clock();
+  for ( unsigned rep = 0; rep < NREPEAT; ++rep )
+    for ( std::size_t i = 0; i < NPOINTS; ++i )
+      scalar[ i ] = Math::erf( x[ i ] );
+  tScalar = seconds( start );
+  start = clock();
+  for ( unsigned rep = 0; rep < NREPEAT; ++rep )
+    Math::erf( x.data(), batch.data(), NPOINTS );
+  tBatch = seconds( start );
+  std::cout << "  erf       " << std::setw( 10 ) << maxDiff( batch, scalar ) << "  "
+            << std::fixed << std::setw( 10 ) << tScalar << " " << std::setw( 10 ) << tBatch << std::scientific << std::endl;
+
+  start = clock();
+  for ( unsigned rep = 0; rep < NREPEAT; ++rep )
+    for ( std::size_t i = 0; i < NPOINTS; ++i )
+      scalar[ i ] = Math::erfc( x[ i ] );
+  tScalar = seconds( start );
+  start = clock();
+  for ( unsigned rep = 0; rep < NREPEAT; ++rep )
+    Math::erfc( x.data(), batch.data(), NPOINTS );
+  tBatch = seconds( start );
+  std::cout << "  erfc      " << std::setw( 10 ) << maxDiff( batch, scalar ) << "  "
+            << std::fixed << std::setw( 10 ) << tScalar << " " << std::setw( 10 ) << tBatch << std::scientific << std::endl;
+
+  start = clock();
+  for ( unsigned rep = 0; rep < NREPEAT; ++rep )
+    for ( std::size_t i = 0; i < NPOINTS; ++i )
+      scalarW[ i ] = Math::faddeeva( z[ i ] );
+  tScalar = seconds( start );
+  start = clock();
+  for ( unsigned rep = 0; rep < NREPEAT; ++rep )
+    Math::faddeeva( z.data(), batchW2.data(), NPOINTS );
+  tBatch = seconds( start );
+  std::cout << "  faddeeva  " << std::setw( 10 ) << maxDiff( batchW2, scalarW ) << "  "
+            << std::fixed << std::setw( 10 ) << tScalar << " " << std::setw( 10 ) << tBatch << std::scientific << std::endl;
+
+  // The inverse error function and the incomplete gamma integrals are evaluated point
+  //    by point, so their batch versions must agree exactly.
+  for ( std::size_t i = 0; i < NPOINTS; ++i )
+    x[ i ] = -0.999 + 1.998 * ( i + 0.5 ) / NPOINTS;
+  for ( std::size_t i = 0; i < NPOINTS; ++i )
+    scalar[ i ] = Math::inverf( x[ i ] );
+  Math::inverf( x.data(), batch.data(), NPOINTS );
+  std::cout << "  inverf    " << std::setw( 10 ) << maxDiff( batch, scalar ) << std::endl;
+
+  for ( std::size_t i = 0; i < NPOINTS; ++i )
+    x[ i ] = 20.0 * ( i + 0.5 ) / NPOINTS;
+  for ( std::size_t i = 0; i < NPOINTS; ++i )
+    scalar[ i ] = Math::gamma_p( 2.5, x[ i ] );
+  Math::gamma_p( 2.5, x.data(), batch.data(), NPOINTS );
+  std::cout << "  gamma_p   " << std::setw( 10 ) << maxDiff( batch, scalar ) << std::endl;
+
+  for ( std::size_t i = 0; i < NPOINTS; ++i )
+    scalar[ i ] = Math::gamma_q( 2.5, x[ i ] );
+  Math::gamma_q( 2.5, x.data(), batch.data(), NPOINTS );
+  std::cout << "  gamma_q   " << std::setw( 10 ) << maxDiff( batch, scalar ) << std::endl;
+
+  return 0;
+}